@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "codegen.h"
+#include "diagnostic.h"
+#include "json.h"
+#include "lexer.h"
+#include "parser.h"
+#include "sema.h"
+#include "source.h"
+#include "tokenbuffer.h"
+#include "type.h"
+#include "version.h"
+#include "workload.h"
+
+// Display usage information
+void printUsage(const char* progName) {
+    std::cerr << "dsLang front-end benchmarks (dsbench)\n\n";
+    std::cerr << "Usage: " << progName << " [options]\n";
+    std::cerr << "Options:\n";
+    std::cerr << "  --filter=<text>   Run only benchmarks and workloads whose name contains text\n";
+    std::cerr << "  --scale=<n>       Multiply the size of every workload (default: 1)\n";
+    std::cerr << "  --min-time=<s>    Repeat each measurement for at least this long (default: 1)\n";
+    std::cerr << "  -O<level>         Optimization level of the codegen benchmark (default: 0)\n";
+    std::cerr << "  --json=<file>     Also write the results as JSON ('-' for stdout)\n";
+    std::cerr << "  --emit=<dir>      Write the workloads as .ds files and exit\n";
+    std::cerr << "  -h, --help        Display this help message\n";
+}
+
+// Benchmarks store results here so that the work is not optimized away
+volatile size_t resultSink;
+
+// Options of one benchmark run
+struct BenchOptions {
+    std::string filter;
+    double minTime = 1.0;
+    unsigned optLevel = 0;
+};
+
+// One measurement: how fast a benchmark got through a workload
+struct BenchResult {
+    std::string benchmark;
+    std::string workload;
+    unsigned runs = 0;
+    double seconds = 0;         // Fastest run
+    size_t items = 0;           // Work done per run, in `unit`
+    std::string unit;
+    size_t lines = 0;           // Source lines per run, if the work is a program
+};
+
+// Time a function until `minTime` has passed, at least three times, and
+// return the fastest run. The fastest run is the one least disturbed by
+// the rest of the machine, so it is the most stable figure to compare.
+double measure(double minTime, unsigned* runs, const std::function<void()>& run) {
+    using Clock = std::chrono::steady_clock;
+    double fastest = 0;
+    double total = 0;
+    *runs = 0;
+    while (*runs < 3 || total < minTime) {
+        Clock::time_point start = Clock::now();
+        run();
+        std::chrono::duration<double> elapsed = Clock::now() - start;
+        fastest = *runs == 0 ? elapsed.count() : std::min(fastest, elapsed.count());
+        total += elapsed.count();
+        ++*runs;
+    }
+    return fastest;
+}
+
+// Check whether a benchmark or workload was selected with --filter
+bool selected(const BenchOptions& options, const std::string& benchmark, const std::string& workload) {
+    return options.filter.empty() || benchmark.find(options.filter) != std::string::npos ||
+           workload.find(options.filter) != std::string::npos;
+}
+
+// Lex a workload, reporting into `diag`
+std::unique_ptr<dsLang::TokenBuffer> tokenize(const dsLang::Workload& workload,
+                                              dsLang::DiagnosticReporter& diag) {
+    dsLang::Lexer lexer(dsLang::SourceBuffer::FromString(workload.source, workload.name + ".ds"));
+    lexer.SetDiagnosticReporter(&diag);
+    return dsLang::TokenBuffer::Tokenize(lexer);
+}
+
+// Warn once per workload that does not compile cleanly, since its timings
+// then include error recovery
+void warnOnErrors(const dsLang::Workload& workload, const dsLang::DiagnosticReporter& diag,
+                  const char* phase) {
+    if (diag.HasErrors()) {
+        std::cerr << "Warning: " << workload.name << " has " << phase
+                  << " errors; its timings include error recovery\n";
+    }
+}
+
+// Lexer: source text to tokens
+void benchLexer(const dsLang::Workload& workload, const BenchOptions& options,
+                std::vector<BenchResult>& results) {
+    if (!selected(options, "lexer", workload.name)) {
+        return;
+    }
+
+    dsLang::DiagnosticReporter diag(false);
+    size_t tokenCount = tokenize(workload, diag)->GetSize();
+    warnOnErrors(workload, diag, "lexical");
+
+    // The lexer reads straight from the buffer, so share one across runs
+    auto buffer = dsLang::SourceBuffer::FromString(workload.source, workload.name + ".ds");
+    BenchResult result{"lexer", workload.name, 0, 0, tokenCount, "tokens", workload.lines};
+    result.seconds = measure(options.minTime, &result.runs, [&] {
+        dsLang::DiagnosticReporter runDiag(false);
+        dsLang::Lexer lexer(buffer);
+        lexer.SetDiagnosticReporter(&runDiag);
+        dsLang::TokenBuffer::Tokenize(lexer);
+    });
+    results.push_back(result);
+}
+
+// Parser: tokens to AST
+void benchParser(const dsLang::Workload& workload, const BenchOptions& options,
+                 std::vector<BenchResult>& results) {
+    if (!selected(options, "parser", workload.name)) {
+        return;
+    }
+
+    dsLang::DiagnosticReporter diag(false);
+    auto tokens = tokenize(workload, diag);
+    {
+        dsLang::TypeContext types;
+        dsLang::Parser(*tokens, diag, types).Parse();
+        warnOnErrors(workload, diag, "parse");
+    }
+
+    BenchResult result{"parser", workload.name, 0, 0, tokens->GetSize(), "tokens", workload.lines};
+    result.seconds = measure(options.minTime, &result.runs, [&] {
+        dsLang::DiagnosticReporter runDiag(false);
+        dsLang::TypeContext types;
+        dsLang::Parser(*tokens, runDiag, types).Parse();
+    });
+    results.push_back(result);
+}
+
+// CodeGenerator: analyzed AST to optimized LLVM IR. Code generation only
+// reads the AST, so one parse serves every run.
+void benchCodegen(const dsLang::Workload& workload, const BenchOptions& options,
+                  std::vector<BenchResult>& results) {
+    if (!selected(options, "codegen", workload.name)) {
+        return;
+    }
+
+    dsLang::DiagnosticReporter diag(false);
+    dsLang::TypeContext types;
+    auto tokens = tokenize(workload, diag);
+    auto program = dsLang::Parser(*tokens, diag, types).Parse();
+    dsLang::CreateSemanticAnalyzer(diag)->Analyze(program.get());
+
+    // Like the driver, never generate code for a program with errors
+    if (diag.HasErrors()) {
+        std::cerr << "Warning: " << workload.name << " does not compile; skipping codegen\n";
+        return;
+    }
+
+    BenchResult result{"codegen", workload.name, 0, 0, tokens->GetSize(), "tokens", workload.lines};
+    result.seconds = measure(options.minTime, &result.runs, [&] {
+        dsLang::CodeGenerator codegen(workload.name, "x86_64-elf", options.optLevel);
+        codegen.Generate(program.get());
+    });
+    results.push_back(result);
+}
+
+// Type::IsEqual over every pair of a mix of interned types: primitives,
+// struct types, and pointer, array and function types built on them
+void benchTypeEqual(const BenchOptions& options, std::vector<BenchResult>& results) {
+    if (!selected(options, "type_equal", "types")) {
+        return;
+    }
+
+    dsLang::TypeContext types;
+    std::vector<dsLang::Type*> pool = {types.GetIntType(), types.GetCharType(), types.GetLongType()};
+    for (int i = 0; i < 16; i++) {
+        pool.push_back(types.GetStructType("Record" + std::to_string(i)));
+    }
+    for (size_t i = 0; pool.size() < 1024; i++) {
+        dsLang::Type* base = pool[i];
+        switch (i % 3) {
+            case 0:
+                pool.push_back(types.GetPointerType(base));
+                break;
+            case 1:
+                pool.push_back(types.GetArrayType(base, i % 64 + 1));
+                break;
+            default:
+                pool.push_back(types.GetFunctionType(base, {base, pool[i / 2]}));
+                break;
+        }
+    }
+
+    BenchResult result{"type_equal", "types", 0, 0, pool.size() * pool.size(), "compares", 0};
+    result.seconds = measure(options.minTime, &result.runs, [&] {
+        size_t equal = 0;
+        for (const dsLang::Type* a : pool) {
+            for (const dsLang::Type* b : pool) {
+                equal += a->IsEqual(b);
+            }
+        }
+        resultSink = equal;
+    });
+    results.push_back(result);
+}
+
+// Print the results as a table
+void printResults(const std::vector<BenchResult>& results) {
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-11s %-17s %6s %12s %20s %12s\n",
+                  "Benchmark", "Workload", "Runs", "Time (ms)", "Throughput", "Klines/s");
+    std::cout << line;
+    for (const auto& result : results) {
+        char throughput[64];
+        std::snprintf(throughput, sizeof(throughput), "%.2f M%s/s",
+                      result.items / result.seconds / 1e6, result.unit.c_str());
+        char lines[32] = "-";
+        if (result.lines) {
+            std::snprintf(lines, sizeof(lines), "%.1f", result.lines / result.seconds / 1e3);
+        }
+        std::snprintf(line, sizeof(line), "%-11s %-17s %6u %12.3f %20s %12s\n",
+                      result.benchmark.c_str(), result.workload.c_str(), result.runs,
+                      result.seconds * 1000, throughput, lines);
+        std::cout << line;
+    }
+}
+
+// Get the results as JSON, for comparing runs by script
+dsLang::JsonValue resultsToJson(const std::vector<BenchResult>& results, unsigned scale,
+                                const BenchOptions& options) {
+    dsLang::JsonValue entries = dsLang::JsonValue::Array();
+    for (const auto& result : results) {
+        dsLang::JsonValue entry = dsLang::JsonValue::Object();
+        entry.Set("benchmark", result.benchmark);
+        entry.Set("workload", result.workload);
+        entry.Set("runs", result.runs);
+        entry.Set("seconds", result.seconds);
+        entry.Set(result.unit, static_cast<double>(result.items));
+        entry.Set(result.unit + "_per_second", result.items / result.seconds);
+        if (result.lines) {
+            entry.Set("lines", static_cast<double>(result.lines));
+            entry.Set("lines_per_second", result.lines / result.seconds);
+        }
+        entries.Push(std::move(entry));
+    }
+
+    dsLang::JsonValue json = dsLang::JsonValue::Object();
+    json.Set("version", DSLANG_VERSION);
+    json.Set("scale", scale);
+    json.Set("opt_level", options.optLevel);
+    json.Set("results", std::move(entries));
+    return json;
+}
+
+// Benchmark entry point
+int main(int argc, char** argv) {
+    BenchOptions options;
+    unsigned scale = 1;
+    std::string jsonFilename;
+    std::string emitDir;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+
+        if (arg.compare(0, 9, "--filter=") == 0) {
+            options.filter = arg.substr(9);
+        } else if (arg.compare(0, 8, "--scale=") == 0) {
+            std::string count = arg.substr(8);
+            char* end = nullptr;
+            long value = std::strtol(count.c_str(), &end, 10);
+            if (count.empty() || *end != '\0' || value < 1 || value > 1000) {
+                std::cerr << "Invalid scale: " << count << "\n";
+                return 1;
+            }
+            scale = static_cast<unsigned>(value);
+        } else if (arg.compare(0, 11, "--min-time=") == 0) {
+            std::string time = arg.substr(11);
+            char* end = nullptr;
+            double value = std::strtod(time.c_str(), &end);
+            if (time.empty() || *end != '\0' || value < 0) {
+                std::cerr << "Invalid minimum time: " << time << "\n";
+                return 1;
+            }
+            options.minTime = value;
+        } else if (arg.size() == 3 && arg.compare(0, 2, "-O") == 0 && arg[2] >= '0' && arg[2] <= '3') {
+            options.optLevel = static_cast<unsigned>(arg[2] - '0');
+        } else if (arg.compare(0, 7, "--json=") == 0) {
+            jsonFilename = arg.substr(7);
+        } else if (arg.compare(0, 7, "--emit=") == 0) {
+            emitDir = arg.substr(7);
+        } else if (arg == "-h" || arg == "--help") {
+            printUsage(argv[0]);
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << "\n";
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    std::vector<dsLang::Workload> workloads = dsLang::GenerateWorkloads(scale);
+
+    // Emitted workloads let dscc itself be timed end to end
+    if (!emitDir.empty()) {
+        std::error_code ec;
+        std::filesystem::create_directories(emitDir, ec);
+        for (const auto& workload : workloads) {
+            std::string filename = emitDir + "/" + workload.name + ".ds";
+            std::ofstream out(filename);
+            out << workload.source;
+            if (!out) {
+                std::cerr << "Error: could not write " << filename << "\n";
+                return 1;
+            }
+            std::cout << filename << ": " << workload.lines << " lines\n";
+        }
+        return 0;
+    }
+
+    std::vector<BenchResult> results;
+    for (const auto& workload : workloads) {
+        benchLexer(workload, options, results);
+        benchParser(workload, options, results);
+        benchCodegen(workload, options, results);
+    }
+    benchTypeEqual(options, results);
+
+    printResults(results);
+
+    if (!jsonFilename.empty()) {
+        std::string json = resultsToJson(results, scale, options).Serialize();
+        if (jsonFilename == "-") {
+            std::cout << json << "\n";
+        } else {
+            std::ofstream out(jsonFilename);
+            out << json << "\n";
+            if (!out) {
+                std::cerr << "Error: could not write " << jsonFilename << "\n";
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+/**
+ * workload.cpp - Synthetic Benchmark Programs Implementation for dsLang
+ *
+ * This file implements the workload generators. Every program follows the
+ * grammar in docs/Language.md and declares everything before using it.
+ */
+
+#include "workload.h"
+#include <algorithm>
+#include <cstdint>
+
+namespace dsLang {
+
+namespace {
+
+/**
+ * Random - Small deterministic generator (xorshift64)
+ *
+ * The standard distributions are not guaranteed to give the same sequence
+ * everywhere, so workloads would differ between standard libraries.
+ */
+class Random {
+public:
+    explicit Random(uint64_t seed) : state_(seed ? seed : 1) {}
+
+    /**
+     * Next - Get a number in [0, bound)
+     */
+    unsigned Next(unsigned bound) {
+        state_ ^= state_ << 13;
+        state_ ^= state_ >> 7;
+        state_ ^= state_ << 17;
+        return static_cast<unsigned>(state_ % bound);
+    }
+
+private:
+    uint64_t state_;        // Generator state, never zero
+};
+
+/**
+ * AppendOperand - Append a parameter or a small literal
+ */
+void AppendOperand(std::string& out, Random& random) {
+    static const char* const operands[] = {"a", "b", "c"};
+    if (random.Next(3) == 0) {
+        out += std::to_string(1 + random.Next(100));
+    } else {
+        out += operands[random.Next(3)];
+    }
+}
+
+/**
+ * AppendOperator - Append a binary operator that cannot trap
+ */
+void AppendOperator(std::string& out, Random& random) {
+    static const char* const operators[] = {" + ", " - ", " * ", " & ", " | ", " ^ "};
+    out += operators[random.Next(6)];
+}
+
+/**
+ * AppendStringContent - Append words and escapes for a string literal
+ */
+void AppendStringContent(std::string& out, Random& random, unsigned word_count) {
+    static const char* const words[] = {
+        "page", "frame", "fault", "kernel", "scheduler", "interrupt", "driver", "buffer",
+        "queue", "process", "thread", "mutex", "timer", "vector", "segment", "descriptor"
+    };
+    for (unsigned i = 0; i < word_count; i++) {
+        if (i > 0) {
+            out += random.Next(8) == 0 ? "\\t" : " ";
+        }
+        out += words[random.Next(16)];
+    }
+    if (random.Next(4) == 0) {
+        out += ": \\\"%d\\\"";
+    }
+    out += "\\n";
+}
+
+/**
+ * Record - Name of the index'th struct of the large types workload
+ */
+std::string Record(unsigned index) {
+    return "Record" + std::to_string(index);
+}
+
+} // anonymous namespace
+
+/**
+ * GenerateDeepExpressions - Functions returning one deeply nested expression
+ *
+ * Even functions nest to the left, "((a + b) * c) ...", and odd functions
+ * to the right, "a + (b * (c ...))", since parsers recurse differently on
+ * the two.
+ */
+std::string GenerateDeepExpressions(unsigned function_count, unsigned depth) {
+    Random random(0x5eed0001);
+    std::string out = "// Deeply nested expressions\n\n";
+
+    for (unsigned f = 0; f < function_count; f++) {
+        out += "int deep" + std::to_string(f) + "(int a, int b, int c) {\n    return ";
+        if (f % 2 == 0) {
+            out.append(depth, '(');
+            AppendOperand(out, random);
+            for (unsigned i = 0; i < depth; i++) {
+                AppendOperator(out, random);
+                AppendOperand(out, random);
+                out += ')';
+            }
+        } else {
+            for (unsigned i = 0; i < depth; i++) {
+                AppendOperand(out, random);
+                AppendOperator(out, random);
+                out += '(';
+            }
+            AppendOperand(out, random);
+            out.append(depth, ')');
+        }
+        out += ";\n}\n\n";
+    }
+    return out;
+}
+
+/**
+ * GenerateManyFunctions - Many small functions with loops, branches and calls
+ */
+std::string GenerateManyFunctions(unsigned function_count) {
+    Random random(0x5eed0002);
+    std::string out = "// Many small functions\n\n";
+
+    for (unsigned f = 0; f < function_count; f++) {
+        std::string name = "work" + std::to_string(f);
+        out += "int " + name + "(int n) {\n";
+        out += "    int total = " + std::to_string(random.Next(1000)) + ";\n";
+        out += "    for (int k = 0; k < n; k++) {\n";
+        out += "        if (k % " + std::to_string(2 + random.Next(7)) + " == 0) {\n";
+        if (f > 0) {
+            // Call an earlier function, so the call graph is deep but acyclic
+            out += "            total += work" + std::to_string(random.Next(f)) + "(k);\n";
+        } else {
+            out += "            total += k;\n";
+        }
+        out += "        } else {\n";
+        out += "            total -= k * " + std::to_string(1 + random.Next(9)) + ";\n";
+        out += "        }\n";
+        out += "    }\n";
+        out += "    while (total > " + std::to_string(1000 + random.Next(9000)) + ") {\n";
+        out += "        total = total / 2;\n";
+        out += "    }\n";
+        out += "    return total;\n";
+        out += "}\n\n";
+    }
+    return out;
+}
+
+/**
+ * GenerateLargeTypes - Wide structs and enums, and functions using them
+ *
+ * Each struct points to the previous one, so type lookups cross structs.
+ */
+std::string GenerateLargeTypes(unsigned type_count, unsigned member_count) {
+    static const char* const field_types[] = {
+        "int", "long", "short", "unsigned int", "char*", "int[4]", "unsigned char"
+    };
+    Random random(0x5eed0003);
+    std::string out = "// Large struct and enum declarations\n\n";
+
+    for (unsigned t = 0; t < type_count; t++) {
+        std::string record = Record(t);
+        out += "struct " + record + " {\n";
+        for (unsigned m = 0; m < member_count; m++) {
+            std::string type = field_types[random.Next(7)];
+            if (t > 0 && m % 16 == 15) {
+                type = "struct " + Record(t - 1) + "*";
+            }
+            // Every struct starts with an int, for the accessor below
+            if (m == 0) {
+                type = "int";
+            }
+            out += "    " + type + " field" + std::to_string(m) + ";\n";
+        }
+        out += "};\n\n";
+
+        std::string kind = "Kind" + std::to_string(t);
+        out += "enum " + kind + " {\n";
+        for (unsigned m = 0; m < member_count; m++) {
+            out += "    " + kind + "_" + std::to_string(m);
+            if (random.Next(4) == 0) {
+                out += " = " + std::to_string(m * 4);
+            }
+            out += m + 1 < member_count ? ",\n" : "\n";
+        }
+        out += "};\n\n";
+
+        // Touch the first field through the whole chain of structs
+        out += "int get" + record + "(struct " + record + "* r) {\n";
+        out += "    int sum = r->field0;\n";
+        for (unsigned m = 15; m < member_count && t > 0; m += 16) {
+            out += "    if (r->field" + std::to_string(m) + ") {\n";
+            out += "        sum += get" + Record(t - 1) + "(r->field" + std::to_string(m) + ");\n";
+            out += "    }\n";
+        }
+        out += "    return sum + " + kind + "_" + std::to_string(member_count - 1) + ";\n";
+        out += "}\n\n";
+    }
+    return out;
+}
+
+/**
+ * GenerateStringTables - Long tables of string globals and their lookups
+ *
+ * Half the strings are globals looked up by index, in functions of 64
+ * cases each; the other half are literals passed straight to calls.
+ */
+std::string GenerateStringTables(unsigned string_count) {
+    constexpr unsigned kCasesPerFunction = 64;
+    Random random(0x5eed0004);
+    std::string out = "// Long string tables\n\nextern void puts(const char* str);\n\n";
+
+    unsigned global_count = string_count / 2;
+    for (unsigned s = 0; s < global_count; s++) {
+        out += "const char* message" + std::to_string(s) + " = \"";
+        AppendStringContent(out, random, 2 + random.Next(12));
+        out += "\";\n";
+    }
+    out += "\n";
+
+    for (unsigned first = 0; first < global_count; first += kCasesPerFunction) {
+        out += "const char* lookup" + std::to_string(first / kCasesPerFunction) + "(int i) {\n";
+        unsigned last = std::min(first + kCasesPerFunction, global_count);
+        for (unsigned s = first; s < last; s++) {
+            out += "    if (i == " + std::to_string(s) + ") {\n";
+            out += "        return message" + std::to_string(s) + ";\n";
+            out += "    }\n";
+        }
+        out += "    return null;\n}\n\n";
+    }
+
+    unsigned literal_count = string_count - global_count;
+    for (unsigned first = 0; first < literal_count; first += kCasesPerFunction) {
+        out += "void report" + std::to_string(first / kCasesPerFunction) + "() {\n";
+        unsigned last = std::min(first + kCasesPerFunction, literal_count);
+        for (unsigned s = first; s < last; s++) {
+            out += "    puts(\"";
+            AppendStringContent(out, random, 2 + random.Next(12));
+            out += "\");\n";
+        }
+        out += "}\n\n";
+    }
+    return out;
+}
+
+/**
+ * GenerateMessageSends - Code made almost entirely of message sends
+ *
+ * Messages compile to calls of the functions named by their selectors, so
+ * those are declared first.
+ */
+std::string GenerateMessageSends(unsigned function_count, unsigned sends_per_function) {
+    Random random(0x5eed0005);
+    std::string out = "// Message sends\n\n";
+    out += "int value(int obj) {\n    return obj * 3;\n}\n\n";
+    out += "int add(int obj, int x) {\n    return obj + x;\n}\n\n";
+    out += "int setValue_withName(int obj, int v, const char* name) {\n    return obj ^ v;\n}\n\n";
+    out += "int scale_by_offset(int obj, int a, int b, int c) {\n    return obj * a + b - c;\n}\n\n";
+
+    for (unsigned f = 0; f < function_count; f++) {
+        out += "int send" + std::to_string(f) + "(int obj) {\n";
+        out += "    int x = [obj value];\n";
+        for (unsigned s = 0; s < sends_per_function; s++) {
+            switch (random.Next(4)) {
+                case 0:
+                    out += "    x = [x add:[obj value]];\n";
+                    break;
+                case 1:
+                    out += "    x = [x setValue:x withName:\"name" + std::to_string(s) + "\"];\n";
+                    break;
+                case 2:
+                    out += "    x = [[x add:" + std::to_string(random.Next(100)) +
+                           "] scale:2 by:x offset:[[obj value] value]];\n";
+                    break;
+                default:
+                    out += "    x = [[[x value] add:obj] add:[x add:" +
+                           std::to_string(random.Next(100)) + "]];\n";
+                    break;
+            }
+        }
+        out += "    return x;\n}\n\n";
+    }
+    return out;
+}
+
+/**
+ * GenerateWorkloads - Generate every workload
+ */
+std::vector<Workload> GenerateWorkloads(unsigned scale) {
+    std::vector<Workload> workloads = {
+        {"deep_expressions", GenerateDeepExpressions(64 * scale, 256)},
+        {"many_functions", GenerateManyFunctions(2000 * scale)},
+        {"large_types", GenerateLargeTypes(16 * scale, 512)},
+        {"string_tables", GenerateStringTables(5000 * scale)},
+        {"message_sends", GenerateMessageSends(200 * scale, 32)},
+    };
+    for (auto& workload : workloads) {
+        workload.lines = static_cast<size_t>(
+            std::count(workload.source.begin(), workload.source.end(), '\n'));
+    }
+    return workloads;
+}
+
+} // namespace dsLang
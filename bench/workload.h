@@ -0,0 +1,78 @@
+/**
+ * workload.h - Synthetic Benchmark Programs for dsLang
+ *
+ * This file declares the generators of the synthetic programs the
+ * benchmarks compile. Each workload stresses one part of the front end:
+ * deeply nested expressions, thousands of functions, huge struct and enum
+ * declarations, long string tables, and code made of message sends.
+ *
+ * Generation is deterministic, so the same scale always gives the same
+ * program and timings from different builds can be compared.
+ */
+
+#ifndef DSLANG_BENCH_WORKLOAD_H
+#define DSLANG_BENCH_WORKLOAD_H
+
+#include <string>
+#include <vector>
+
+namespace dsLang {
+
+/**
+ * Workload - One generated program
+ */
+struct Workload {
+    std::string name;           // Short name, also the file name when emitted
+    std::string source;         // Program text
+    size_t lines = 0;           // Number of source lines
+};
+
+/**
+ * GenerateDeepExpressions - Functions returning one deeply nested expression
+ *
+ * @param function_count Number of functions
+ * @param depth Nesting depth of each expression
+ */
+std::string GenerateDeepExpressions(unsigned function_count, unsigned depth);
+
+/**
+ * GenerateManyFunctions - Many small functions with loops, branches and calls
+ *
+ * @param function_count Number of functions
+ */
+std::string GenerateManyFunctions(unsigned function_count);
+
+/**
+ * GenerateLargeTypes - Wide structs and enums, and functions using them
+ *
+ * @param type_count Number of structs, and of enums
+ * @param member_count Fields per struct, and values per enum
+ */
+std::string GenerateLargeTypes(unsigned type_count, unsigned member_count);
+
+/**
+ * GenerateStringTables - Long tables of string globals and their lookups
+ *
+ * @param string_count Number of strings
+ */
+std::string GenerateStringTables(unsigned string_count);
+
+/**
+ * GenerateMessageSends - Code made almost entirely of message sends
+ *
+ * @param function_count Number of functions sending messages
+ * @param sends_per_function Message sends in each of them
+ */
+std::string GenerateMessageSends(unsigned function_count, unsigned sends_per_function);
+
+/**
+ * GenerateWorkloads - Generate every workload
+ *
+ * @param scale Size multiplier; 1 gives programs of a few thousand to a
+ *              few tens of thousands of lines
+ */
+std::vector<Workload> GenerateWorkloads(unsigned scale);
+
+} // namespace dsLang
+
+#endif // DSLANG_BENCH_WORKLOAD_H
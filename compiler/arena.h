@@ -0,0 +1,177 @@
+/**
+ * arena.h - Bump Allocation for AST Nodes
+ *
+ * This file defines the ASTArena class, a bump allocator that owns every node
+ * of a compilation unit, and NodeList, a non-owning view of a child list
+ * stored in an arena.
+ */
+
+#ifndef DSLANG_ARENA_H
+#define DSLANG_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace dsLang {
+
+/**
+ * NodeList - Non-owning, immutable view of an array of node pointers
+ *
+ * The elements live in an ASTArena, so a NodeList is only valid for as long
+ * as the arena that holds it. It is cheap to copy and is passed by value.
+ */
+template <typename T>
+class NodeList {
+public:
+    using iterator = T* const*;
+
+    NodeList() : data_(nullptr), size_(0) {}
+    NodeList(T* const* data, size_t size) : data_(data), size_(size) {}
+
+    iterator begin() const { return data_; }
+    iterator end() const { return data_ + size_; }
+
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    T* operator[](size_t index) const { return data_[index]; }
+    T* front() const { return data_[0]; }
+    T* back() const { return data_[size_ - 1]; }
+
+private:
+    T* const* data_;    // First element
+    size_t size_;       // Number of elements
+};
+
+/**
+ * ASTArena - Bump allocator owning all nodes of a compilation unit
+ *
+ * Nodes are placement-constructed into large slabs. Nodes whose types have
+ * non-trivial destructors are recorded so they can be destroyed in reverse
+ * order of creation; everything else is released in one sweep when the
+ * arena is destroyed.
+ */
+class ASTArena {
+public:
+    /**
+     * Constructor
+     *
+     * @param slab_size The size of each slab in bytes
+     */
+    explicit ASTArena(size_t slab_size = 64 * 1024)
+        : slab_size_(slab_size), cur_(nullptr), end_(nullptr),
+          destructors_(nullptr), bytes_allocated_(0) {}
+
+    /**
+     * Destructor - Destroy all non-trivial nodes and release the slabs
+     */
+    ~ASTArena() {
+        for (DestructorRecord* rec = destructors_; rec; rec = rec->next) {
+            rec->destroy(rec->object);
+        }
+        for (void* slab : slabs_) {
+            std::free(slab);
+        }
+    }
+
+    ASTArena(const ASTArena&) = delete;
+    ASTArena& operator=(const ASTArena&) = delete;
+
+    /**
+     * Allocate - Allocate raw, uninitialized memory
+     *
+     * @param size The number of bytes
+     * @param align The required alignment
+     * @return The allocated memory
+     */
+    void* Allocate(size_t size, size_t align) {
+        uintptr_t p = (reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(uintptr_t)(align - 1);
+        if (!cur_ || p + size > reinterpret_cast<uintptr_t>(end_)) {
+            NewSlab(size + align);
+            p = (reinterpret_cast<uintptr_t>(cur_) + align - 1) & ~(uintptr_t)(align - 1);
+        }
+        cur_ = reinterpret_cast<char*>(p + size);
+        bytes_allocated_ += size;
+        return reinterpret_cast<void*>(p);
+    }
+
+    /**
+     * Create - Construct a node in the arena
+     *
+     * @param args The constructor arguments
+     * @return The new node, owned by the arena
+     */
+    template <typename T, typename... Args>
+    T* Create(Args&&... args) {
+        T* obj = new (Allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+        if (!std::is_trivially_destructible<T>::value) {
+            auto* rec = new (Allocate(sizeof(DestructorRecord), alignof(DestructorRecord)))
+                DestructorRecord{&Destroy<T>, obj, destructors_};
+            destructors_ = rec;
+        }
+        return obj;
+    }
+
+    /**
+     * CopyList - Copy a list of node pointers into the arena
+     *
+     * @param nodes The nodes to copy
+     * @return A view of the copied list
+     */
+    template <typename T, typename U>
+    NodeList<T> CopyList(const std::vector<U*>& nodes) {
+        if (nodes.empty()) {
+            return NodeList<T>();
+        }
+        T** data = static_cast<T**>(Allocate(sizeof(T*) * nodes.size(), alignof(T*)));
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            data[i] = nodes[i];
+        }
+        return NodeList<T>(data, nodes.size());
+    }
+
+    /**
+     * GetBytesAllocated - Get the number of bytes handed out so far
+     */
+    size_t GetBytesAllocated() const { return bytes_allocated_; }
+
+private:
+    struct DestructorRecord {
+        void (*destroy)(void*);
+        void* object;
+        DestructorRecord* next;
+    };
+
+    template <typename T>
+    static void Destroy(void* object) {
+        static_cast<T*>(object)->~T();
+    }
+
+    void NewSlab(size_t min_size) {
+        size_t size = min_size > slab_size_ ? min_size : slab_size_;
+        char* slab = static_cast<char*>(std::malloc(size));
+        if (!slab) {
+            // Fail the way operator new does
+            throw std::bad_alloc();
+        }
+        slabs_.push_back(slab);
+        cur_ = slab;
+        end_ = slab + size;
+    }
+
+    size_t slab_size_;                  // Default slab size
+    char* cur_;                         // Next free byte in the current slab
+    char* end_;                         // End of the current slab
+    std::vector<void*> slabs_;          // All slabs, freed on destruction
+    DestructorRecord* destructors_;     // Nodes needing destruction, newest first
+    size_t bytes_allocated_;            // Total bytes handed out
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_ARENA_H
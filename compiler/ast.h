@@ -8,6 +8,8 @@
 #ifndef DSLANG_AST_H
 #define DSLANG_AST_H
 
+#include "arena.h"
+#include "symbol.h"
 #include <memory>
 #include <string>
 #include <vector>
@@ -17,9 +19,13 @@ namespace dsLang {
 // Forward declarations
 class ASTVisitor;
 class Type;
+class StructType;
 
 /**
  * Node - Base class for all AST nodes
+ * 
+ * Nodes are allocated in the ASTArena of their CompilationUnit and refer to
+ * their children through raw, non-owning pointers and NodeLists.
  */
 class Node {
 public:
@@ -40,12 +46,41 @@ public:
  */
 class Expr : public Node {
 public:
+    /**
+     * Kind - The concrete class of an expression
+     */
+    enum class Kind {
+        BINARY,         // BinaryExpr
+        UNARY,          // UnaryExpr
+        LITERAL,        // LiteralExpr
+        VAR,            // VarExpr
+        ASSIGN,         // AssignExpr
+        CALL,           // CallExpr
+        MESSAGE,        // MessageExpr
+        SUBSCRIPT,      // SubscriptExpr
+        CAST            // CastExpr
+    };
+    
     virtual ~Expr() = default;
     
+    /**
+     * GetKind - Get the concrete class of the expression
+     */
+    Kind GetKind() const { return kind_; }
+    
     /**
      * GetType - Get the type of the expression
      */
-    virtual std::shared_ptr<Type> GetType() const = 0;
+    virtual Type* GetType() const = 0;
+    
+protected:
+    /**
+     * Constructor
+     */
+    explicit Expr(Kind kind) : kind_(kind) {}
+    
+private:
+    Kind kind_;     // The concrete class
 };
 
 /**
@@ -77,8 +112,8 @@ public:
     /**
      * Constructor
      */
-    BinaryExpr(Op op, std::shared_ptr<Expr> left, std::shared_ptr<Expr> right, std::shared_ptr<Type> type)
-        : op_(op), left_(left), right_(right), type_(type) {}
+    BinaryExpr(Op op, Expr* left, Expr* right, Type* type)
+        : Expr(Kind::BINARY), op_(op), left_(left), right_(right), type_(type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -93,23 +128,23 @@ public:
     /**
      * GetLeft - Get the left operand
      */
-    std::shared_ptr<Expr> GetLeft() const { return left_; }
+    Expr* GetLeft() const { return left_; }
     
     /**
      * GetRight - Get the right operand
      */
-    std::shared_ptr<Expr> GetRight() const { return right_; }
+    Expr* GetRight() const { return right_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return type_; }
+    Type* GetType() const override { return type_; }
     
 private:
-    Op op_;                        // The operator
-    std::shared_ptr<Expr> left_;   // The left operand
-    std::shared_ptr<Expr> right_;  // The right operand
-    std::shared_ptr<Type> type_;   // The result type
+    Op op_;                       // The operator
+    Expr* left_;                  // The left operand
+    Expr* right_;                 // The right operand
+    Type* type_;                  // The result type
 };
 
 /**
@@ -132,8 +167,8 @@ public:
     /**
      * Constructor
      */
-    UnaryExpr(Op op, std::shared_ptr<Expr> operand, std::shared_ptr<Type> type)
-        : op_(op), operand_(operand), type_(type) {}
+    UnaryExpr(Op op, Expr* operand, Type* type)
+        : Expr(Kind::UNARY), op_(op), operand_(operand), type_(type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -148,17 +183,17 @@ public:
     /**
      * GetOperand - Get the operand
      */
-    std::shared_ptr<Expr> GetOperand() const { return operand_; }
+    Expr* GetOperand() const { return operand_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return type_; }
+    Type* GetType() const override { return type_; }
     
 private:
     Op op_;                       // The operator
-    std::shared_ptr<Expr> operand_; // The operand
-    std::shared_ptr<Type> type_;  // The result type
+    Expr* operand_;               // The operand
+    Type* type_;                  // The result type
 };
 
 /**
@@ -178,38 +213,38 @@ public:
     /**
      * Constructor for bool literals
      */
-    LiteralExpr(bool value, std::shared_ptr<Type> type)
-        : kind_(Kind::BOOL), bool_value_(value), type_(type) {}
+    LiteralExpr(bool value, Type* type)
+        : Expr(Expr::Kind::LITERAL), kind_(Kind::BOOL), bool_value_(value), type_(type) {}
     
     /**
      * Constructor for int literals
      */
-    LiteralExpr(int64_t value, std::shared_ptr<Type> type)
-        : kind_(Kind::INT), int_value_(value), type_(type) {}
+    LiteralExpr(int64_t value, Type* type)
+        : Expr(Expr::Kind::LITERAL), kind_(Kind::INT), int_value_(value), type_(type) {}
     
     /**
      * Constructor for float literals
      */
-    LiteralExpr(double value, std::shared_ptr<Type> type)
-        : kind_(Kind::FLOAT), float_value_(value), type_(type) {}
+    LiteralExpr(double value, Type* type)
+        : Expr(Expr::Kind::LITERAL), kind_(Kind::FLOAT), float_value_(value), type_(type) {}
     
     /**
      * Constructor for char literals
      */
-    LiteralExpr(char value, std::shared_ptr<Type> type)
-        : kind_(Kind::CHAR), char_value_(value), type_(type) {}
+    LiteralExpr(char value, Type* type)
+        : Expr(Expr::Kind::LITERAL), kind_(Kind::CHAR), char_value_(value), type_(type) {}
     
     /**
      * Constructor for string literals
      */
-    LiteralExpr(const std::string& value, std::shared_ptr<Type> type)
-        : kind_(Kind::STRING), string_value_(value), type_(type) {}
+    LiteralExpr(const std::string& value, Type* type)
+        : Expr(Expr::Kind::LITERAL), kind_(Kind::STRING), string_value_(value), type_(type) {}
     
     /**
      * Constructor for null pointer literals
      */
-    LiteralExpr(std::shared_ptr<Type> type)
-        : kind_(Kind::NULL_PTR), type_(type) {}
+    LiteralExpr(Type* type)
+        : Expr(Expr::Kind::LITERAL), kind_(Kind::NULL_PTR), type_(type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -249,7 +284,7 @@ public:
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return type_; }
+    Type* GetType() const override { return type_; }
     
 private:
     Kind kind_;                   // The kind of literal
@@ -260,7 +295,7 @@ private:
         char char_value_;         // Char value
     };
     std::string string_value_;    // String value
-    std::shared_ptr<Type> type_;  // The type
+    Type* type_;                  // The type
 };
 
 /**
@@ -271,8 +306,8 @@ public:
     /**
      * Constructor
      */
-    VarExpr(const std::string& name, std::shared_ptr<Type> type)
-        : name_(name), type_(type) {}
+    VarExpr(Symbol name, Type* type)
+        : Expr(Kind::VAR), name_(name), type_(type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -282,16 +317,21 @@ public:
     /**
      * GetName - Get the variable name
      */
-    const std::string& GetName() const { return name_; }
+    const std::string& GetName() const { return name_.GetName(); }
+    
+    /**
+     * GetSymbol - Get the interned variable name
+     */
+    Symbol GetSymbol() const { return name_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return type_; }
+    Type* GetType() const override { return type_; }
     
 private:
-    std::string name_;            // The variable name
-    std::shared_ptr<Type> type_;  // The type
+    Symbol name_;                 // The variable name
+    Type* type_;                  // The type
 };
 
 /**
@@ -302,14 +342,14 @@ public:
     /**
      * Constructor
      */
-    AssignExpr(std::shared_ptr<Expr> target, std::shared_ptr<Expr> value)
-        : target_(target), value_(value) {}
+    AssignExpr(Expr* target, Expr* value)
+        : Expr(Kind::ASSIGN), target_(target), value_(value) {}
 
     /**
      * Constructor with type
      */
-    AssignExpr(std::shared_ptr<Expr> target, std::shared_ptr<Expr> value, std::shared_ptr<Type> type)
-        : target_(target), value_(value), type_(type) {}
+    AssignExpr(Expr* target, Expr* value, Type* type)
+        : Expr(Kind::ASSIGN), target_(target), value_(value), type_(type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -319,24 +359,24 @@ public:
     /**
      * GetTarget - Get the assignment target
      */
-    std::shared_ptr<Expr> GetTarget() const { return target_; }
+    Expr* GetTarget() const { return target_; }
     
     /**
      * GetValue - Get the assigned value
      */
-    std::shared_ptr<Expr> GetValue() const { return value_; }
+    Expr* GetValue() const { return value_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { 
+    Type* GetType() const override { 
         return type_ ? type_ : target_->GetType(); 
     }
     
 private:
-    std::shared_ptr<Expr> target_; // The assignment target
-    std::shared_ptr<Expr> value_;  // The assigned value
-    std::shared_ptr<Type> type_;   // Optional explicit type
+    Expr* target_;                // The assignment target
+    Expr* value_;                 // The assigned value
+    Type* type_;                  // Optional explicit type
 };
 
 /**
@@ -347,10 +387,10 @@ public:
     /**
      * Constructor
      */
-    CallExpr(const std::string& callee, 
-             std::vector<std::shared_ptr<Expr>> args,
-             std::shared_ptr<Type> return_type)
-        : callee_(callee), args_(args), return_type_(return_type) {}
+    CallExpr(Symbol callee,
+             NodeList<Expr> args,
+             Type* return_type)
+        : Expr(Kind::CALL), callee_(callee), args_(args), return_type_(return_type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -360,22 +400,27 @@ public:
     /**
      * GetCallee - Get the function name
      */
-    const std::string& GetCallee() const { return callee_; }
+    const std::string& GetCallee() const { return callee_.GetName(); }
+    
+    /**
+     * GetCalleeSymbol - Get the interned function name
+     */
+    Symbol GetCalleeSymbol() const { return callee_; }
     
     /**
      * GetArgs - Get the arguments
      */
-    const std::vector<std::shared_ptr<Expr>>& GetArgs() const { return args_; }
+    NodeList<Expr> GetArgs() const { return args_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return return_type_; }
+    Type* GetType() const override { return return_type_; }
     
 private:
-    std::string callee_;                         // The function name
-    std::vector<std::shared_ptr<Expr>> args_;    // The arguments
-    std::shared_ptr<Type> return_type_;          // The return type
+    Symbol callee_;                      // The function name
+    NodeList<Expr> args_;                // The arguments
+    Type* return_type_;                  // The return type
 };
 
 /**
@@ -386,11 +431,11 @@ public:
     /**
      * Constructor
      */
-    MessageExpr(std::shared_ptr<Expr> receiver, 
-                const std::string& selector,
-                std::vector<std::shared_ptr<Expr>> args,
-                std::shared_ptr<Type> return_type)
-        : receiver_(receiver), selector_(selector), args_(args), return_type_(return_type) {}
+    MessageExpr(Expr* receiver, 
+                Symbol selector,
+                NodeList<Expr> args,
+                Type* return_type)
+        : Expr(Kind::MESSAGE), receiver_(receiver), selector_(selector), args_(args), return_type_(return_type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -400,28 +445,33 @@ public:
     /**
      * GetReceiver - Get the receiver object
      */
-    std::shared_ptr<Expr> GetReceiver() const { return receiver_; }
+    Expr* GetReceiver() const { return receiver_; }
     
     /**
      * GetSelector - Get the selector (method name)
      */
-    const std::string& GetSelector() const { return selector_; }
+    const std::string& GetSelector() const { return selector_.GetName(); }
+    
+    /**
+     * GetSelectorSymbol - Get the interned selector
+     */
+    Symbol GetSelectorSymbol() const { return selector_; }
     
     /**
      * GetArgs - Get the arguments
      */
-    const std::vector<std::shared_ptr<Expr>>& GetArgs() const { return args_; }
+    NodeList<Expr> GetArgs() const { return args_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return return_type_; }
+    Type* GetType() const override { return return_type_; }
     
 private:
-    std::shared_ptr<Expr> receiver_;             // The receiver object
-    std::string selector_;                       // The selector (method name)
-    std::vector<std::shared_ptr<Expr>> args_;    // The arguments
-    std::shared_ptr<Type> return_type_;          // The return type
+    Expr* receiver_;                     // The receiver object
+    Symbol selector_;                    // The selector (method name)
+    NodeList<Expr> args_;                // The arguments
+    Type* return_type_;                  // The return type
 };
 
 /**
@@ -432,10 +482,10 @@ public:
     /**
      * Constructor
      */
-    SubscriptExpr(std::shared_ptr<Expr> array, 
-                  std::shared_ptr<Expr> index,
-                  std::shared_ptr<Type> elem_type)
-        : array_(array), index_(index), elem_type_(elem_type) {}
+    SubscriptExpr(Expr* array, 
+                  Expr* index,
+                  Type* elem_type)
+        : Expr(Kind::SUBSCRIPT), array_(array), index_(index), elem_type_(elem_type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -445,22 +495,22 @@ public:
     /**
      * GetArray - Get the array expression
      */
-    std::shared_ptr<Expr> GetArray() const { return array_; }
+    Expr* GetArray() const { return array_; }
     
     /**
      * GetIndex - Get the index expression
      */
-    std::shared_ptr<Expr> GetIndex() const { return index_; }
+    Expr* GetIndex() const { return index_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return elem_type_; }
+    Type* GetType() const override { return elem_type_; }
     
 private:
-    std::shared_ptr<Expr> array_;   // The array expression
-    std::shared_ptr<Expr> index_;   // The index expression
-    std::shared_ptr<Type> elem_type_; // The element type
+    Expr* array_;                      // The array expression
+    Expr* index_;                      // The index expression
+    Type* elem_type_;                  // The element type
 };
 
 /**
@@ -471,8 +521,8 @@ public:
     /**
      * Constructor
      */
-    CastExpr(std::shared_ptr<Expr> expr, std::shared_ptr<Type> type)
-        : expr_(expr), type_(type) {}
+    CastExpr(Expr* expr, Type* type)
+        : Expr(Kind::CAST), expr_(expr), type_(type) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -482,16 +532,16 @@ public:
     /**
      * GetExpr - Get the expression being cast
      */
-    std::shared_ptr<Expr> GetExpr() const { return expr_; }
+    Expr* GetExpr() const { return expr_; }
     
     /**
      * GetType - Get the type of the expression
      */
-    std::shared_ptr<Type> GetType() const override { return type_; }
+    Type* GetType() const override { return type_; }
     
 private:
-    std::shared_ptr<Expr> expr_;    // The expression being cast
-    std::shared_ptr<Type> type_;    // The target type
+    Expr* expr_;                  // The expression being cast
+    Type* type_;                  // The target type
 };
 
 //===----------------------------------------------------------------------===//
@@ -514,7 +564,7 @@ public:
     /**
      * Constructor
      */
-    ExprStmt(std::shared_ptr<Expr> expr)
+    ExprStmt(Expr* expr)
         : expr_(expr) {}
     
     /**
@@ -525,10 +575,10 @@ public:
     /**
      * GetExpr - Get the expression
      */
-    std::shared_ptr<Expr> GetExpr() const { return expr_; }
+    Expr* GetExpr() const { return expr_; }
     
 private:
-    std::shared_ptr<Expr> expr_;   // The expression
+    Expr* expr_;  // The expression
 };
 
 /**
@@ -539,7 +589,7 @@ public:
     /**
      * Constructor
      */
-    BlockStmt(std::vector<std::shared_ptr<Stmt>> stmts)
+    BlockStmt(NodeList<Stmt> stmts)
         : stmts_(stmts) {}
     
     /**
@@ -550,10 +600,10 @@ public:
     /**
      * GetStmts - Get the statements in the block
      */
-    const std::vector<std::shared_ptr<Stmt>>& GetStmts() const { return stmts_; }
+    NodeList<Stmt> GetStmts() const { return stmts_; }
     
 private:
-    std::vector<std::shared_ptr<Stmt>> stmts_;  // The statements in the block
+    NodeList<Stmt> stmts_;  // The statements in the block
 };
 
 /**
@@ -564,9 +614,9 @@ public:
     /**
      * Constructor
      */
-    IfStmt(std::shared_ptr<Expr> cond,
-           std::shared_ptr<Stmt> then_stmt,
-           std::shared_ptr<Stmt> else_stmt = nullptr)
+    IfStmt(Expr* cond,
+           Stmt* then_stmt,
+           Stmt* else_stmt = nullptr)
         : cond_(cond), then_(then_stmt), else_(else_stmt) {}
     
     /**
@@ -577,22 +627,22 @@ public:
     /**
      * GetCond - Get the condition expression
      */
-    std::shared_ptr<Expr> GetCond() const { return cond_; }
+    Expr* GetCond() const { return cond_; }
     
     /**
      * GetThen - Get the then statement
      */
-    std::shared_ptr<Stmt> GetThen() const { return then_; }
+    Stmt* GetThen() const { return then_; }
     
     /**
      * GetElse - Get the else statement
      */
-    std::shared_ptr<Stmt> GetElse() const { return else_; }
+    Stmt* GetElse() const { return else_; }
     
 private:
-    std::shared_ptr<Expr> cond_;  // The condition expression
-    std::shared_ptr<Stmt> then_;  // The then statement
-    std::shared_ptr<Stmt> else_;  // The else statement
+    Expr* cond_;  // The condition expression
+    Stmt* then_;  // The then statement
+    Stmt* else_;  // The else statement
 };
 
 /**
@@ -603,8 +653,8 @@ public:
     /**
      * Constructor
      */
-    WhileStmt(std::shared_ptr<Expr> cond,
-              std::shared_ptr<Stmt> body)
+    WhileStmt(Expr* cond,
+              Stmt* body)
         : cond_(cond), body_(body) {}
     
     /**
@@ -615,16 +665,16 @@ public:
     /**
      * GetCond - Get the condition expression
      */
-    std::shared_ptr<Expr> GetCond() const { return cond_; }
+    Expr* GetCond() const { return cond_; }
     
     /**
      * GetBody - Get the body statement
      */
-    std::shared_ptr<Stmt> GetBody() const { return body_; }
+    Stmt* GetBody() const { return body_; }
     
 private:
-    std::shared_ptr<Expr> cond_;  // The condition expression
-    std::shared_ptr<Stmt> body_;  // The body statement
+    Expr* cond_;  // The condition expression
+    Stmt* body_;  // The body statement
 };
 
 /**
@@ -635,10 +685,10 @@ public:
     /**
      * Constructor
      */
-    ForStmt(std::shared_ptr<Stmt> init,
-            std::shared_ptr<Expr> cond,
-            std::shared_ptr<Expr> inc,
-            std::shared_ptr<Stmt> body)
+    ForStmt(Stmt* init,
+            Expr* cond,
+            Expr* inc,
+            Stmt* body)
         : init_(init), cond_(cond), inc_(inc), body_(body) {}
     
     /**
@@ -649,28 +699,28 @@ public:
     /**
      * GetInit - Get the initialization statement
      */
-    std::shared_ptr<Stmt> GetInit() const { return init_; }
+    Stmt* GetInit() const { return init_; }
     
     /**
      * GetCond - Get the condition expression
      */
-    std::shared_ptr<Expr> GetCond() const { return cond_; }
+    Expr* GetCond() const { return cond_; }
     
     /**
      * GetInc - Get the increment expression
      */
-    std::shared_ptr<Expr> GetInc() const { return inc_; }
+    Expr* GetInc() const { return inc_; }
     
     /**
      * GetBody - Get the body statement
      */
-    std::shared_ptr<Stmt> GetBody() const { return body_; }
+    Stmt* GetBody() const { return body_; }
     
 private:
-    std::shared_ptr<Stmt> init_;  // The initialization statement
-    std::shared_ptr<Expr> cond_;  // The condition expression
-    std::shared_ptr<Expr> inc_;   // The increment expression
-    std::shared_ptr<Stmt> body_;  // The body statement
+    Stmt* init_;  // The initialization statement
+    Expr* cond_;  // The condition expression
+    Expr* inc_;   // The increment expression
+    Stmt* body_;  // The body statement
 };
 
 /**
@@ -713,7 +763,7 @@ public:
     /**
      * Constructor
      */
-    ReturnStmt(std::shared_ptr<Expr> expr = nullptr)
+    ReturnStmt(Expr* expr = nullptr)
         : expr_(expr) {}
     
     /**
@@ -724,10 +774,10 @@ public:
     /**
      * GetExpr - Get the return expression
      */
-    std::shared_ptr<Expr> GetExpr() const { return expr_; }
+    Expr* GetExpr() const { return expr_; }
     
 private:
-    std::shared_ptr<Expr> expr_;  // The return expression
+    Expr* expr_;  // The return expression
 };
 
 /**
@@ -738,7 +788,7 @@ public:
     /**
      * Constructor
      */
-    DeclStmt(std::shared_ptr<Node> decl)
+    DeclStmt(Node* decl)
         : decl_(decl) {}
     
     /**
@@ -749,10 +799,10 @@ public:
     /**
      * GetDecl - Get the declaration
      */
-    std::shared_ptr<Node> GetDecl() const { return decl_; }
+    Node* GetDecl() const { return decl_; }
     
 private:
-    std::shared_ptr<Node> decl_;  // The declaration
+    Node* decl_;  // The declaration
 };
 
 //===----------------------------------------------------------------------===//
@@ -770,6 +820,11 @@ public:
      * GetName - Get the name of the declaration
      */
     virtual const std::string& GetName() const = 0;
+    
+    /**
+     * GetSymbol - Get the interned name of the declaration
+     */
+    virtual Symbol GetSymbol() const = 0;
 };
 
 /**
@@ -780,9 +835,9 @@ public:
     /**
      * Constructor
      */
-    VarDecl(const std::string& name,
-            std::shared_ptr<Type> type,
-            std::shared_ptr<Expr> init = nullptr)
+    VarDecl(Symbol name,
+            Type* type,
+            Expr* init = nullptr)
         : name_(name), type_(type), init_(init) {}
     
     /**
@@ -793,22 +848,27 @@ public:
     /**
      * GetName - Get the name of the variable
      */
-    const std::string& GetName() const override { return name_; }
+    const std::string& GetName() const override { return name_.GetName(); }
+    
+    /**
+     * GetSymbol - Get the interned name of the variable
+     */
+    Symbol GetSymbol() const override { return name_; }
     
     /**
      * GetType - Get the type of the variable
      */
-    std::shared_ptr<Type> GetType() const { return type_; }
+    Type* GetType() const { return type_; }
     
     /**
      * GetInit - Get the initializer expression
      */
-    std::shared_ptr<Expr> GetInit() const { return init_; }
+    Expr* GetInit() const { return init_; }
     
 private:
-    std::string name_;            // The variable name
-    std::shared_ptr<Type> type_;  // The variable type
-    std::shared_ptr<Expr> init_;  // The initializer expression
+    Symbol name_;                 // The variable name
+    Type* type_;                  // The variable type
+    Expr* init_;                  // The initializer expression
 };
 
 /**
@@ -819,7 +879,7 @@ public:
     /**
      * Constructor
      */
-    ParamDecl(const std::string& name, std::shared_ptr<Type> type)
+    ParamDecl(Symbol name, Type* type)
         : name_(name), type_(type) {}
     
     /**
@@ -830,16 +890,21 @@ public:
     /**
      * GetName - Get the name of the parameter
      */
-    const std::string& GetName() const override { return name_; }
+    const std::string& GetName() const override { return name_.GetName(); }
+    
+    /**
+     * GetSymbol - Get the interned name of the parameter
+     */
+    Symbol GetSymbol() const override { return name_; }
     
     /**
      * GetType - Get the type of the parameter
      */
-    std::shared_ptr<Type> GetType() const { return type_; }
+    Type* GetType() const { return type_; }
     
 private:
-    std::string name_;            // The parameter name
-    std::shared_ptr<Type> type_;  // The parameter type
+    Symbol name_;                 // The parameter name
+    Type* type_;                  // The parameter type
 };
 
 /**
@@ -850,10 +915,10 @@ public:
     /**
      * Constructor
      */
-    FuncDecl(const std::string& name,
-             std::shared_ptr<Type> type,
-             std::vector<std::shared_ptr<ParamDecl>> params,
-             std::shared_ptr<Stmt> body = nullptr)
+    FuncDecl(Symbol name,
+             Type* type,
+             NodeList<ParamDecl> params,
+             Stmt* body = nullptr)
         : name_(name), type_(type), params_(params), body_(body) {}
     
     /**
@@ -864,28 +929,33 @@ public:
     /**
      * GetName - Get the name of the function
      */
-    const std::string& GetName() const override { return name_; }
+    const std::string& GetName() const override { return name_.GetName(); }
+    
+    /**
+     * GetSymbol - Get the interned name of the function
+     */
+    Symbol GetSymbol() const override { return name_; }
     
     /**
      * GetType - Get the function type
      */
-    std::shared_ptr<Type> GetType() const { return type_; }
+    Type* GetType() const { return type_; }
     
     /**
      * GetParams - Get the function parameters
      */
-    const std::vector<std::shared_ptr<ParamDecl>>& GetParams() const { return params_; }
+    NodeList<ParamDecl> GetParams() const { return params_; }
     
     /**
      * GetBody - Get the function body
      */
-    std::shared_ptr<Stmt> GetBody() const { return body_; }
+    Stmt* GetBody() const { return body_; }
     
 private:
-    std::string name_;                                // The function name
-    std::shared_ptr<Type> type_;                      // The function type
-    std::vector<std::shared_ptr<ParamDecl>> params_;  // The function parameters
-    std::shared_ptr<Stmt> body_;                      // The function body
+    Symbol name_;                 // The function name
+    Type* type_;                  // The function type
+    NodeList<ParamDecl> params_;  // The function parameters
+    Stmt* body_;                  // The function body
 };
 
 /**
@@ -896,11 +966,11 @@ public:
     /**
      * Constructor
      */
-    MethodDecl(const std::string& name,
-               std::shared_ptr<Type> type,
-               std::shared_ptr<Type> receiver_type,
-               std::vector<std::shared_ptr<ParamDecl>> params,
-               std::shared_ptr<Stmt> body = nullptr)
+    MethodDecl(Symbol name,
+               Type* type,
+               Type* receiver_type,
+               NodeList<ParamDecl> params,
+               Stmt* body = nullptr)
         : name_(name), type_(type), receiver_type_(receiver_type), params_(params), body_(body) {}
     
     /**
@@ -911,34 +981,39 @@ public:
     /**
      * GetName - Get the name of the method
      */
-    const std::string& GetName() const override { return name_; }
+    const std::string& GetName() const override { return name_.GetName(); }
+    
+    /**
+     * GetSymbol - Get the interned name of the method
+     */
+    Symbol GetSymbol() const override { return name_; }
     
     /**
      * GetType - Get the method type
      */
-    std::shared_ptr<Type> GetType() const { return type_; }
+    Type* GetType() const { return type_; }
     
     /**
      * GetReceiverType - Get the receiver type
      */
-    std::shared_ptr<Type> GetReceiverType() const { return receiver_type_; }
+    Type* GetReceiverType() const { return receiver_type_; }
     
     /**
      * GetParams - Get the method parameters
      */
-    const std::vector<std::shared_ptr<ParamDecl>>& GetParams() const { return params_; }
+    NodeList<ParamDecl> GetParams() const { return params_; }
     
     /**
      * GetBody - Get the method body
      */
-    std::shared_ptr<Stmt> GetBody() const { return body_; }
+    Stmt* GetBody() const { return body_; }
     
 private:
-    std::string name_;                                // The method name
-    std::shared_ptr<Type> type_;                      // The method type
-    std::shared_ptr<Type> receiver_type_;             // The receiver type
-    std::vector<std::shared_ptr<ParamDecl>> params_;  // The method parameters
-    std::shared_ptr<Stmt> body_;                      // The method body
+    Symbol name_;                          // The method name
+    Type* type_;                           // The method type
+    Type* receiver_type_;                  // The receiver type
+    NodeList<ParamDecl> params_;           // The method parameters
+    Stmt* body_;                           // The method body
 };
 
 /**
@@ -949,9 +1024,10 @@ public:
     /**
      * Constructor
      */
-    StructDecl(const std::string& name,
-               std::vector<std::shared_ptr<VarDecl>> fields)
-        : name_(name), fields_(fields) {}
+    StructDecl(Symbol name,
+               StructType* type,
+               NodeList<VarDecl> fields)
+        : name_(name), type_(type), fields_(fields) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -961,16 +1037,27 @@ public:
     /**
      * GetName - Get the name of the struct
      */
-    const std::string& GetName() const override { return name_; }
+    const std::string& GetName() const override { return name_.GetName(); }
+    
+    /**
+     * GetSymbol - Get the interned name of the struct
+     */
+    Symbol GetSymbol() const override { return name_; }
+    
+    /**
+     * GetType - Get the struct type
+     */
+    StructType* GetType() const { return type_; }
     
     /**
      * GetFields - Get the struct fields
      */
-    const std::vector<std::shared_ptr<VarDecl>>& GetFields() const { return fields_; }
+    NodeList<VarDecl> GetFields() const { return fields_; }
     
 private:
-    std::string name_;                              // The struct name
-    std::vector<std::shared_ptr<VarDecl>> fields_;  // The struct fields
+    Symbol name_;               // The struct name
+    StructType* type_;          // The struct type, holding the fields too
+    NodeList<VarDecl> fields_;  // The struct fields
 };
 
 /**
@@ -981,8 +1068,8 @@ public:
     /**
      * Constructor
      */
-    EnumDecl(const std::string& name,
-             std::shared_ptr<Type> base_type,
+    EnumDecl(Symbol name,
+             Type* base_type,
              std::vector<std::pair<std::string, int64_t>> values)
         : name_(name), base_type_(base_type), values_(values) {}
     
@@ -994,12 +1081,17 @@ public:
     /**
      * GetName - Get the name of the enum
      */
-    const std::string& GetName() const override { return name_; }
+    const std::string& GetName() const override { return name_.GetName(); }
+    
+    /**
+     * GetSymbol - Get the interned name of the enum
+     */
+    Symbol GetSymbol() const override { return name_; }
     
     /**
      * GetBaseType - Get the base type of the enum
      */
-    std::shared_ptr<Type> GetBaseType() const { return base_type_; }
+    Type* GetBaseType() const { return base_type_; }
     
     /**
      * GetValues - Get the enum values
@@ -1007,21 +1099,35 @@ public:
     const std::vector<std::pair<std::string, int64_t>>& GetValues() const { return values_; }
     
 private:
-    std::string name_;                                  // The enum name
-    std::shared_ptr<Type> base_type_;                   // The base type
+    Symbol name_;                                       // The enum name
+    Type* base_type_;                                   // The base type
     std::vector<std::pair<std::string, int64_t>> values_; // The enum values
 };
 
 /**
  * CompilationUnit - Top-level AST node for a compilation unit
+ * 
+ * The compilation unit owns the arena holding every other node of the tree,
+ * so destroying the unit releases the whole AST at once.
  */
 class CompilationUnit : public Node {
 public:
     /**
      * Constructor
      */
-    CompilationUnit(std::vector<std::shared_ptr<Decl>> decls)
-        : decls_(decls) {}
+    CompilationUnit(std::unique_ptr<ASTArena> arena, NodeList<Decl> decls)
+        : decls_(decls) {
+        arenas_.push_back(std::move(arena));
+    }
+    
+    /**
+     * Constructor - Build a unit whose nodes live in several arenas
+     * 
+     * Used by incremental parsing, where unchanged declarations are shared
+     * with earlier units. The first arena holds the declaration list.
+     */
+    CompilationUnit(std::vector<std::shared_ptr<ASTArena>> arenas, NodeList<Decl> decls)
+        : arenas_(std::move(arenas)), decls_(decls) {}
     
     /**
      * Accept - Accept a visitor to this node
@@ -1031,10 +1137,21 @@ public:
     /**
      * GetDecls - Get the declarations
      */
-    const std::vector<std::shared_ptr<Decl>>& GetDecls() const { return decls_; }
+    NodeList<Decl> GetDecls() const { return decls_; }
+    
+    /**
+     * GetArena - Get the arena that owns this unit's nodes
+     */
+    ASTArena& GetArena() const { return *arenas_.front(); }
+    
+    /**
+     * GetArenas - Get every arena holding nodes of this unit
+     */
+    const std::vector<std::shared_ptr<ASTArena>>& GetArenas() const { return arenas_; }
     
 private:
-    std::vector<std::shared_ptr<Decl>> decls_;  // The declarations
+    std::vector<std::shared_ptr<ASTArena>> arenas_;    // Owners of all nodes in the unit
+    NodeList<Decl> decls_;                             // The declarations
 };
 
 //===----------------------------------------------------------------------===//
@@ -0,0 +1,117 @@
+/**
+ * backend.cpp - Shared LLVM Backend State Implementation for dsLang
+ *
+ * This file implements the process-wide target registry and the
+ * TargetMachine pool.
+ */
+
+#include "backend.h"
+#include "optimizer.h"
+#include <llvm/MC/TargetRegistry.h>
+#include <llvm/Support/TargetSelect.h>
+#include <llvm/Target/TargetOptions.h>
+
+namespace dsLang {
+
+/**
+ * operator= - Return the current machine, then take over another lease
+ */
+TargetMachineLease& TargetMachineLease::operator=(TargetMachineLease&& other) {
+    if (this != &other) {
+        Release();
+        key_ = std::move(other.key_);
+        machine_ = std::move(other.machine_);
+    }
+    return *this;
+}
+
+/**
+ * Destructor - Return the machine to the pool
+ */
+TargetMachineLease::~TargetMachineLease() {
+    Release();
+}
+
+/**
+ * Release - Return the machine to the pool
+ */
+void TargetMachineLease::Release() {
+    if (machine_) {
+        BackendContext::Get().Release(key_, std::move(machine_));
+    }
+}
+
+/**
+ * Get - Get the process-wide context, initializing LLVM on first use
+ */
+BackendContext& BackendContext::Get() {
+    // Function-local statics are initialized exactly once, even when first
+    // reached from several threads
+    static BackendContext context;
+    return context;
+}
+
+/**
+ * Constructor - Register the x86 target
+ */
+BackendContext::BackendContext() {
+    LLVMInitializeX86TargetInfo();
+    LLVMInitializeX86Target();
+    LLVMInitializeX86TargetMC();
+    LLVMInitializeX86AsmParser();
+    LLVMInitializeX86AsmPrinter();
+}
+
+/**
+ * AcquireTargetMachine - Lease a TargetMachine for a configuration
+ */
+TargetMachineLease BackendContext::AcquireTargetMachine(const std::string& triple,
+                                                        const std::string& cpu,
+                                                        const std::string& features,
+                                                        unsigned opt_level,
+                                                        std::string* error) {
+    std::string key = triple + '\0' + cpu + '\0' + features + '\0' + std::to_string(opt_level);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto it = idle_.find(key);
+        if (it != idle_.end() && !it->second.empty()) {
+            std::unique_ptr<llvm::TargetMachine> machine = std::move(it->second.back());
+            it->second.pop_back();
+            return TargetMachineLease(std::move(key), std::move(machine));
+        }
+    }
+
+    // Build a new machine outside the lock; this is the slow part
+    std::string lookup_error;
+    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(triple, lookup_error);
+    if (!target) {
+        if (error) {
+            *error = lookup_error;
+        }
+        return TargetMachineLease();
+    }
+
+    llvm::TargetOptions options;
+    std::unique_ptr<llvm::TargetMachine> machine(
+        target->createTargetMachine(triple, cpu, features, options, llvm::Reloc::Static,
+                                    std::nullopt, GetCodeGenOptLevel(opt_level)));
+    if (!machine) {
+        if (error) {
+            *error = "could not create a target machine for " + triple;
+        }
+        return TargetMachineLease();
+    }
+
+    return TargetMachineLease(std::move(key), std::move(machine));
+}
+
+/**
+ * Release - Put a machine back in its pool
+ */
+void BackendContext::Release(const std::string& key, std::unique_ptr<llvm::TargetMachine> machine) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_[key].push_back(std::move(machine));
+}
+
+} // namespace dsLang
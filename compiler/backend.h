@@ -0,0 +1,106 @@
+/**
+ * backend.h - Shared LLVM Backend State for dsLang
+ *
+ * This file defines the BackendContext class, which owns the process-wide
+ * LLVM target setup: it registers the x86 target exactly once and keeps a
+ * pool of TargetMachines so that repeated compilations in one process do
+ * not pay for target lookup and TargetMachine construction every time.
+ */
+
+#ifndef DSLANG_BACKEND_H
+#define DSLANG_BACKEND_H
+
+#include <llvm/Target/TargetMachine.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dsLang {
+
+class BackendContext;
+
+/**
+ * TargetMachineLease - Exclusive use of a pooled TargetMachine
+ *
+ * A TargetMachine must not be used by two threads at once, so each code
+ * generator leases one for its lifetime. Destroying the lease returns the
+ * machine to the pool. An empty lease means the target could not be
+ * created.
+ */
+class TargetMachineLease {
+public:
+    TargetMachineLease() = default;
+    TargetMachineLease(TargetMachineLease&& other) = default;
+    TargetMachineLease& operator=(TargetMachineLease&& other);
+    ~TargetMachineLease();
+
+    TargetMachineLease(const TargetMachineLease&) = delete;
+    TargetMachineLease& operator=(const TargetMachineLease&) = delete;
+
+    llvm::TargetMachine* Get() const { return machine_.get(); }
+    llvm::TargetMachine* operator->() const { return machine_.get(); }
+    explicit operator bool() const { return machine_ != nullptr; }
+
+private:
+    friend class BackendContext;
+
+    TargetMachineLease(std::string key, std::unique_ptr<llvm::TargetMachine> machine)
+        : key_(std::move(key)), machine_(std::move(machine)) {}
+
+    void Release();
+
+    std::string key_;                                   // Pool the machine belongs to
+    std::unique_ptr<llvm::TargetMachine> machine_;      // The leased machine
+};
+
+/**
+ * BackendContext - Process-wide LLVM target registry and TargetMachine pool
+ *
+ * Only the x86 target is registered; dsOS is built for x86 and nothing else
+ * is needed. Machines are pooled by triple, CPU, features and optimization
+ * level. All methods are thread-safe.
+ */
+class BackendContext {
+public:
+    /**
+     * Get - Get the process-wide context, initializing LLVM on first use
+     */
+    static BackendContext& Get();
+
+    BackendContext(const BackendContext&) = delete;
+    BackendContext& operator=(const BackendContext&) = delete;
+
+    /**
+     * AcquireTargetMachine - Lease a TargetMachine for a configuration
+     *
+     * Returns an idle pooled machine if there is one, otherwise creates a
+     * new one. Machines use the static relocation model.
+     *
+     * @param triple The target triple
+     * @param cpu The target CPU
+     * @param features The target feature string
+     * @param opt_level The optimization level (0-3)
+     * @param error Receives a description of the failure, if any
+     * @return The lease, which is empty on failure
+     */
+    TargetMachineLease AcquireTargetMachine(const std::string& triple, const std::string& cpu,
+                                            const std::string& features, unsigned opt_level,
+                                            std::string* error = nullptr);
+
+private:
+    friend class TargetMachineLease;
+
+    BackendContext();
+
+    void Release(const std::string& key, std::unique_ptr<llvm::TargetMachine> machine);
+
+    std::mutex mutex_;                                  // Guards idle_
+    std::unordered_map<std::string,
+        std::vector<std::unique_ptr<llvm::TargetMachine>>> idle_;   // Pooled machines by key
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_BACKEND_H
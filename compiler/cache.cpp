@@ -0,0 +1,434 @@
+/**
+ * cache.cpp - On-Disk Compilation Cache Implementation for dsLang
+ *
+ * This file implements keying, lookup, storage, eviction and statistics
+ * for the compile cache.
+ */
+
+#include "cache.h"
+#include "version.h"
+#include <llvm/ADT/ArrayRef.h>
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Config/llvm-config.h>
+#include <llvm/Support/SHA256.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <sys/file.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+namespace dsLang {
+
+namespace {
+
+/**
+ * UniqueSuffix - A suffix for temporary files that no other writer uses
+ */
+std::string UniqueSuffix() {
+    static std::atomic<unsigned> counter(0);
+    return ".tmp." + std::to_string(::getpid()) + "." + std::to_string(counter++);
+}
+
+/**
+ * IsEntry - Check if a cache directory member is a finished entry
+ */
+bool IsEntry(const fs::directory_entry& entry) {
+    std::error_code ec;
+    if (!entry.is_regular_file(ec)) {
+        return false;
+    }
+    std::string name = entry.path().filename().string();
+    return name.size() == 64 && name.find('.') == std::string::npos;
+}
+
+/**
+ * ReadStats - Read the totals file; a missing or damaged file reads as zero
+ */
+CacheStats ReadStats(const std::string& path) {
+    CacheStats stats;
+    std::ifstream in(path);
+    std::string name;
+    uint64_t value;
+    while (in >> name >> value) {
+        if (name == "hits") {
+            stats.hits = value;
+        } else if (name == "misses") {
+            stats.misses = value;
+        } else if (name == "stores") {
+            stats.stores = value;
+        } else if (name == "evictions") {
+            stats.evictions = value;
+        }
+    }
+    return stats;
+}
+
+/**
+ * HashField - Hash a length-prefixed field, so no two inputs serialize alike
+ */
+void HashField(llvm::SHA256& sha, std::string_view bytes) {
+    uint32_t size = static_cast<uint32_t>(bytes.size());
+    uint8_t prefix[4] = {
+        static_cast<uint8_t>(size), static_cast<uint8_t>(size >> 8),
+        static_cast<uint8_t>(size >> 16), static_cast<uint8_t>(size >> 24)
+    };
+    sha.update(llvm::ArrayRef<uint8_t>(prefix, 4));
+    sha.update(llvm::StringRef(bytes.data(), bytes.size()));
+}
+
+/**
+ * HexDigest - Finish a hash as 64 hex digits
+ */
+std::string HexDigest(llvm::SHA256& sha) {
+    static const char digits[] = "0123456789abcdef";
+    std::string key;
+    for (auto byte : sha.final()) {
+        uint8_t value = static_cast<uint8_t>(byte);
+        key.push_back(digits[value >> 4]);
+        key.push_back(digits[value & 15]);
+    }
+    return key;
+}
+
+} // anonymous namespace
+
+/**
+ * Constructor
+ */
+CompileCache::CompileCache(std::string directory, uint64_t max_size, std::string compiler_identity)
+    : directory_(std::move(directory)), max_size_(max_size),
+      identity_(std::string(DSLANG_VERSION) + "/llvm-" LLVM_VERSION_STRING "/" + compiler_identity) {
+}
+
+/**
+ * Destructor - Flush statistics
+ */
+CompileCache::~CompileCache() {
+    Flush();
+}
+
+/**
+ * GetDefaultDirectory - Get the cache directory to use if none is given
+ */
+std::string CompileCache::GetDefaultDirectory() {
+    if (const char* dir = std::getenv("DSCC_CACHE_DIR")) {
+        if (*dir) {
+            return dir;
+        }
+    }
+    if (const char* dir = std::getenv("XDG_CACHE_HOME")) {
+        if (*dir) {
+            return std::string(dir) + "/dscc";
+        }
+    }
+    if (const char* home = std::getenv("HOME")) {
+        return std::string(home) + "/.cache/dscc";
+    }
+    return ".dscc-cache";
+}
+
+/**
+ * ComputeKey - Compute the key for compiling a token stream
+ */
+std::string CompileCache::ComputeKey(const std::string& source_name, const TokenBuffer& tokens,
+                                     const std::string& target_triple, unsigned opt_level,
+                                     const std::string& output_kind) const {
+    llvm::SHA256 sha;
+    HashKeyHeader(sha, target_triple, opt_level, output_kind);
+    HashField(sha, source_name);
+
+    for (size_t i = 0; i < tokens.GetSize(); i++) {
+        uint8_t kind = static_cast<uint8_t>(tokens.GetKind(i));
+        sha.update(llvm::ArrayRef<uint8_t>(&kind, 1));
+        HashField(sha, tokens.GetLexeme(i));
+    }
+    return HexDigest(sha);
+}
+
+/**
+ * ComputeKey - Compute the key for compiling an arbitrary description
+ */
+std::string CompileCache::ComputeKey(std::string_view content, const std::string& target_triple,
+                                     unsigned opt_level, const std::string& output_kind) const {
+    llvm::SHA256 sha;
+    HashKeyHeader(sha, target_triple, opt_level, output_kind);
+    HashField(sha, content);
+    return HexDigest(sha);
+}
+
+/**
+ * Retrieve - Copy a cached output to a file
+ */
+bool CompileCache::Retrieve(const std::string& key, const std::string& output_filename) {
+    std::string path = GetEntryPath(key);
+    std::error_code ec;
+    bool hit = fs::copy_file(path, output_filename, fs::copy_options::overwrite_existing, ec);
+
+    if (hit) {
+        // Mark the entry as recently used
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hit) {
+        stats_.hits++;
+    } else {
+        stats_.misses++;
+    }
+    return hit;
+}
+
+/**
+ * Store - Add a freshly written output to the cache
+ */
+void CompileCache::Store(const std::string& key, const std::string& output_filename) {
+    std::string path = GetEntryPath(key);
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    if (ec) {
+        return;
+    }
+
+    std::string temp = path + UniqueSuffix();
+    if (!fs::copy_file(output_filename, temp, fs::copy_options::overwrite_existing, ec)) {
+        fs::remove(temp, ec);
+        return;
+    }
+    Publish(path, temp);
+}
+
+/**
+ * Load - Read a cached entry into memory
+ */
+bool CompileCache::Load(const std::string& key, std::string* contents) {
+    std::string path = GetEntryPath(key);
+    std::ifstream in(path, std::ios::binary);
+    bool hit = false;
+    if (in) {
+        std::ostringstream buffer;
+        buffer << in.rdbuf();
+        hit = !in.bad();
+        if (hit) {
+            *contents = buffer.str();
+            std::error_code ec;
+            fs::last_write_time(path, fs::file_time_type::clock::now(), ec);
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (hit) {
+        stats_.hits++;
+    } else {
+        stats_.misses++;
+    }
+    return hit;
+}
+
+/**
+ * Save - Add an in-memory output to the cache
+ */
+void CompileCache::Save(const std::string& key, std::string_view contents) {
+    std::string path = GetEntryPath(key);
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    if (ec) {
+        return;
+    }
+
+    std::string temp = path + UniqueSuffix();
+    {
+        std::ofstream out(temp, std::ios::binary);
+        out.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        if (!out.flush()) {
+            out.close();
+            fs::remove(temp, ec);
+            return;
+        }
+    }
+    Publish(path, temp);
+}
+
+/**
+ * Publish - Move a finished temporary file into place as an entry
+ *
+ * The rename is atomic, so readers never see a partial entry.
+ */
+void CompileCache::Publish(const std::string& path, const std::string& temp) {
+    std::error_code ec;
+    uint64_t size = fs::file_size(temp, ec);
+    if (ec) {
+        size = 0;
+    }
+    fs::rename(temp, path, ec);
+    if (ec) {
+        fs::remove(temp, ec);
+        return;
+    }
+
+    // Only the first store and stores that take the running total past
+    // the limit scan the directory
+    std::lock_guard<std::mutex> lock(mutex_);
+    stats_.stores++;
+    if (!size_known_) {
+        Evict();
+        return;
+    }
+    size_ += size;
+    if (size_ > max_size_) {
+        Evict();
+    }
+}
+
+/**
+ * Evict - Measure the cache and remove least recently used entries while
+ * over the size limit
+ *
+ * The scan also resets size_, which drifts from the real size when other
+ * processes store or evict entries, or when an entry is replaced. Shrinks
+ * to 90% of the limit, so the running total stays under it for roughly a
+ * tenth of the limit's worth of stores before the next scan. Must be
+ * called with mutex_ held.
+ */
+void CompileCache::Evict() {
+    struct Entry {
+        fs::path path;
+        uint64_t size;
+        fs::file_time_type time;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t total = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!IsEntry(*it)) {
+            continue;
+        }
+        std::error_code entry_ec;
+        uint64_t size = it->file_size(entry_ec);
+        fs::file_time_type time = it->last_write_time(entry_ec);
+        if (!entry_ec) {
+            entries.push_back({it->path(), size, time});
+            total += size;
+        }
+    }
+
+    size_ = total;
+    size_known_ = true;
+    if (total <= max_size_) {
+        return;
+    }
+
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.time < b.time; });
+
+    uint64_t target = max_size_ / 10 * 9;
+    for (const auto& entry : entries) {
+        if (total <= target) {
+            break;
+        }
+        if (fs::remove(entry.path, ec)) {
+            total -= entry.size;
+            stats_.evictions++;
+        }
+    }
+    size_ = total;
+}
+
+/**
+ * Flush - Add this object's counters to the on-disk totals
+ */
+void CompileCache::Flush() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!stats_.hits && !stats_.misses && !stats_.stores && !stats_.evictions) {
+        return;
+    }
+
+    std::error_code ec;
+    fs::create_directories(directory_, ec);
+
+    // Other dscc processes may be flushing too
+    std::string stats_path = directory_ + "/stats";
+    int lock_fd = ::open((stats_path + ".lock").c_str(), O_CREAT | O_RDWR, 0644);
+    if (lock_fd < 0) {
+        return;
+    }
+    ::flock(lock_fd, LOCK_EX);
+
+    CacheStats totals = ReadStats(stats_path);
+    totals.hits += stats_.hits;
+    totals.misses += stats_.misses;
+    totals.stores += stats_.stores;
+    totals.evictions += stats_.evictions;
+
+    std::string temp = stats_path + UniqueSuffix();
+    {
+        std::ofstream out(temp);
+        out << "hits " << totals.hits << "\n"
+            << "misses " << totals.misses << "\n"
+            << "stores " << totals.stores << "\n"
+            << "evictions " << totals.evictions << "\n";
+    }
+    fs::rename(temp, stats_path, ec);
+
+    ::flock(lock_fd, LOCK_UN);
+    ::close(lock_fd);
+
+    stats_ = CacheStats();
+}
+
+/**
+ * PrintStats - Print the on-disk totals and current size
+ */
+void CompileCache::PrintStats(std::ostream& os) {
+    Flush();
+
+    CacheStats totals = ReadStats(directory_ + "/stats");
+    uint64_t size = 0;
+    uint64_t count = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(directory_, ec), end; !ec && it != end; it.increment(ec)) {
+        if (IsEntry(*it)) {
+            std::error_code entry_ec;
+            size += it->file_size(entry_ec);
+            count++;
+        }
+    }
+
+    uint64_t lookups = totals.hits + totals.misses;
+    os << "Cache directory:  " << directory_ << "\n";
+    os << "Hits:             " << totals.hits << "\n";
+    os << "Misses:           " << totals.misses << "\n";
+    os << "Hit rate:         "
+       << (lookups ? static_cast<double>(totals.hits) * 100.0 / lookups : 0.0) << "%\n";
+    os << "Stores:           " << totals.stores << "\n";
+    os << "Evictions:        " << totals.evictions << "\n";
+    os << "Entries:          " << count << "\n";
+    os << "Size:             " << size / 1024 << " KiB of " << max_size_ / 1024 << " KiB\n";
+}
+
+/**
+ * HashKeyHeader - Hash the parts of a key shared by every kind of entry
+ */
+void CompileCache::HashKeyHeader(llvm::SHA256& sha, const std::string& target_triple,
+                                 unsigned opt_level, const std::string& output_kind) const {
+    HashField(sha, identity_);
+    HashField(sha, target_triple);
+    HashField(sha, std::to_string(opt_level));
+    HashField(sha, output_kind);
+}
+
+/**
+ * GetEntryPath - Get the file holding an entry
+ */
+std::string CompileCache::GetEntryPath(const std::string& key) const {
+    return directory_ + "/" + key.substr(0, 2) + "/" + key;
+}
+
+} // namespace dsLang
@@ -0,0 +1,176 @@
+/**
+ * cache.h - On-Disk Compilation Cache for dsLang
+ *
+ * This file defines the CompileCache class, a content-addressed store of
+ * compiler outputs. An entry's key is a SHA-256 over everything that can
+ * change the output: the compiler version and build, the target triple,
+ * the optimization level, the output kind, the input's name (which the
+ * output embeds) and the file's normalized token stream. Whitespace and
+ * comments are not tokens, so edits to them still hit the cache. The code generator also keeps finer entries here: the
+ * optimized bitcode of single functions, keyed by their fingerprints.
+ *
+ * Layout: <dir>/<first two hex digits>/<key>, plus a "stats" file. Entries
+ * are written to a temporary file and renamed into place, so concurrent
+ * compilers (threads or processes) never see a partial entry. File
+ * modification times serve as LRU order: hits refresh them, and stores
+ * evict the oldest entries once the cache exceeds its size limit. The
+ * size is measured by a scan on the first store and then kept as a
+ * running total; only a store that takes the total past the limit scans
+ * again.
+ */
+
+#ifndef DSLANG_CACHE_H
+#define DSLANG_CACHE_H
+
+#include "tokenbuffer.h"
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+
+namespace llvm {
+class SHA256;
+}
+
+namespace dsLang {
+
+/**
+ * CacheStats - Counters kept by a compile cache
+ */
+struct CacheStats {
+    uint64_t hits = 0;          // Lookups that found an entry
+    uint64_t misses = 0;        // Lookups that did not
+    uint64_t stores = 0;        // Entries written
+    uint64_t evictions = 0;     // Entries removed to stay under the size limit
+};
+
+/**
+ * CompileCache - Content-addressed store of compiler outputs
+ *
+ * All methods are thread-safe. Statistics gathered by this object are
+ * merged into the on-disk totals by Flush() (and by the destructor).
+ */
+class CompileCache {
+public:
+    /**
+     * Constructor
+     *
+     * @param directory The cache directory; created on first store
+     * @param max_size The size limit in bytes
+     * @param compiler_identity Identifies the compiler build, e.g. the size
+     *        and modification time of the dscc executable
+     */
+    CompileCache(std::string directory, uint64_t max_size, std::string compiler_identity);
+
+    /**
+     * Destructor - Flush statistics
+     */
+    ~CompileCache();
+
+    CompileCache(const CompileCache&) = delete;
+    CompileCache& operator=(const CompileCache&) = delete;
+
+    /**
+     * GetDefaultDirectory - Get the cache directory to use if none is given
+     *
+     * $DSCC_CACHE_DIR if set, else $XDG_CACHE_HOME/dscc, else ~/.cache/dscc.
+     */
+    static std::string GetDefaultDirectory();
+
+    /**
+     * ComputeKey - Compute the key for compiling a token stream
+     *
+     * @param source_name The input's name as given to the code generator,
+     *        which embeds it in the output
+     * @param tokens The file's tokens
+     * @param target_triple The target triple
+     * @param opt_level The optimization level
+     * @param output_kind What is produced, e.g. "obj" or "asm"
+     * @return The key as 64 hex digits
+     */
+    std::string ComputeKey(const std::string& source_name, const TokenBuffer& tokens,
+                           const std::string& target_triple, unsigned opt_level,
+                           const std::string& output_kind) const;
+    
+    /**
+     * ComputeKey - Compute the key for compiling an arbitrary description
+     *
+     * Used for entries finer than a file, such as one function's code.
+     *
+     * @param content Bytes describing everything the output depends on
+     * @param target_triple The target triple
+     * @param opt_level The optimization level
+     * @param output_kind What is produced, e.g. "func-bc"
+     * @return The key as 64 hex digits
+     */
+    std::string ComputeKey(std::string_view content, const std::string& target_triple,
+                           unsigned opt_level, const std::string& output_kind) const;
+
+    /**
+     * Retrieve - Copy a cached output to a file
+     *
+     * @param key The entry's key
+     * @param output_filename Where to write the output
+     * @return True on a hit
+     */
+    bool Retrieve(const std::string& key, const std::string& output_filename);
+
+    /**
+     * Store - Add a freshly written output to the cache
+     *
+     * Failures are ignored; the cache is only an optimization.
+     *
+     * @param key The entry's key
+     * @param output_filename The output to copy into the cache
+     */
+    void Store(const std::string& key, const std::string& output_filename);
+    
+    /**
+     * Load - Read a cached entry into memory
+     *
+     * @param key The entry's key
+     * @param contents Receives the entry on a hit
+     * @return True on a hit
+     */
+    bool Load(const std::string& key, std::string* contents);
+    
+    /**
+     * Save - Add an in-memory output to the cache
+     *
+     * Failures are ignored; the cache is only an optimization.
+     *
+     * @param key The entry's key
+     * @param contents The output
+     */
+    void Save(const std::string& key, std::string_view contents);
+
+    /**
+     * Flush - Add this object's counters to the on-disk totals
+     */
+    void Flush();
+
+    /**
+     * PrintStats - Print the on-disk totals and current size
+     */
+    void PrintStats(std::ostream& os);
+
+private:
+    std::string GetEntryPath(const std::string& key) const;
+    void HashKeyHeader(llvm::SHA256& sha, const std::string& target_triple,
+                       unsigned opt_level, const std::string& output_kind) const;
+    void Publish(const std::string& path, const std::string& temp);
+    void Evict();
+
+    std::string directory_;         // Root of the cache
+    uint64_t max_size_;             // Size limit in bytes
+    std::string identity_;          // Compiler version and build
+    std::mutex mutex_;              // Guards stats_, size_ and eviction
+    CacheStats stats_;              // Counters not yet flushed
+    uint64_t size_ = 0;             // Running total of entry sizes in bytes
+    bool size_known_ = false;       // Whether size_ has been measured yet
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_CACHE_H
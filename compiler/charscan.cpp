@@ -0,0 +1,243 @@
+/**
+ * charscan.cpp - Bulk Character Scanning Implementation for dsLang
+ *
+ * This file implements the lexer's bulk scanning routines. Each routine
+ * classifies a whole vector of bytes at a time, turns the result into a bit
+ * mask and uses count-trailing-zeros / popcount on it, then finishes the
+ * last partial vector with the scalar table. The scalar paths are the
+ * reference: building with -mno-sse2 selects them alone, and the vector
+ * kernels must return the same positions for every input, including runs
+ * that end on a block boundary and text shorter than one block.
+ */
+
+#include "charscan.h"
+#include <cstdint>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define DSLANG_SCAN_WIDTH 32
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define DSLANG_SCAN_WIDTH 16
+#endif
+
+namespace dsLang {
+
+namespace {
+
+enum CharClass : uint8_t {
+    kSpace = 1 << 0,    // ' ', '\t', '\n', '\v', '\f', '\r'
+    kIdent = 1 << 1     // [A-Za-z0-9_]
+};
+
+/**
+ * CharTable - Character classes for the scalar paths
+ */
+struct CharTable {
+    uint8_t classes[256];
+
+    constexpr CharTable() : classes() {
+        classes[static_cast<uint8_t>(' ')] = kSpace;
+        for (int c = '\t'; c <= '\r'; ++c) {
+            classes[c] = kSpace;
+        }
+        for (int c = 'a'; c <= 'z'; ++c) {
+            classes[c] = kIdent;
+        }
+        for (int c = 'A'; c <= 'Z'; ++c) {
+            classes[c] = kIdent;
+        }
+        for (int c = '0'; c <= '9'; ++c) {
+            classes[c] = kIdent;
+        }
+        classes[static_cast<uint8_t>('_')] = kIdent;
+    }
+
+    bool Is(char c, CharClass cls) const {
+        return (classes[static_cast<uint8_t>(c)] & cls) != 0;
+    }
+};
+
+constexpr CharTable kCharTable;
+
+#if defined(__AVX2__)
+
+using Block = __m256i;
+
+inline Block Load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+inline Block Splat(char c) { return _mm256_set1_epi8(c); }
+inline Block Equal(Block a, Block b) { return _mm256_cmpeq_epi8(a, b); }
+inline Block Or(Block a, Block b) { return _mm256_or_si256(a, b); }
+inline Block Sub(Block a, Block b) { return _mm256_sub_epi8(a, b); }
+inline Block MinUnsigned(Block a, Block b) { return _mm256_min_epu8(a, b); }
+inline uint32_t Mask(Block b) { return static_cast<uint32_t>(_mm256_movemask_epi8(b)); }
+
+#elif defined(__SSE2__)
+
+using Block = __m128i;
+
+inline Block Load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+inline Block Splat(char c) { return _mm_set1_epi8(c); }
+inline Block Equal(Block a, Block b) { return _mm_cmpeq_epi8(a, b); }
+inline Block Or(Block a, Block b) { return _mm_or_si128(a, b); }
+inline Block Sub(Block a, Block b) { return _mm_sub_epi8(a, b); }
+inline Block MinUnsigned(Block a, Block b) { return _mm_min_epu8(a, b); }
+inline uint32_t Mask(Block b) { return static_cast<uint32_t>(_mm_movemask_epi8(b)); }
+
+#endif
+
+#ifdef DSLANG_SCAN_WIDTH
+
+// Mask with one bit set per byte of a block
+constexpr uint32_t kFullMask = DSLANG_SCAN_WIDTH == 32 ? 0xFFFFFFFFu : 0xFFFFu;
+
+/**
+ * InRange - Bytes in [lo, hi], compared as unsigned
+ */
+inline Block InRange(Block v, char lo, char hi) {
+    Block offset = Sub(v, Splat(lo));
+    return Equal(MinUnsigned(offset, Splat(static_cast<char>(hi - lo))), offset);
+}
+
+inline uint32_t SpaceMask(Block v) {
+    return Mask(Or(Equal(v, Splat(' ')), InRange(v, '\t', '\r')));
+}
+
+inline uint32_t IdentMask(Block v) {
+    // Setting bit 5 folds upper case onto lower case
+    Block letters = InRange(Or(v, Splat(0x20)), 'a', 'z');
+    Block digits = InRange(v, '0', '9');
+    return Mask(Or(Or(letters, digits), Equal(v, Splat('_'))));
+}
+
+/**
+ * SkipBlocks - Skip whole blocks of bytes of one class
+ *
+ * @return The first byte outside the class, or the start of the final
+ *         partial block
+ */
+template <uint32_t (*BlockMask)(Block)>
+size_t SkipBlocks(std::string_view text, size_t pos) {
+    while (pos + DSLANG_SCAN_WIDTH <= text.size()) {
+        uint32_t outside = ~BlockMask(Load(text.data() + pos)) & kFullMask;
+        if (outside) {
+            return pos + __builtin_ctz(outside);
+        }
+        pos += DSLANG_SCAN_WIDTH;
+    }
+    return pos;
+}
+
+#endif
+
+/**
+ * SkipScalar - Skip bytes of one class one at a time
+ */
+size_t SkipScalar(std::string_view text, size_t pos, CharClass cls) {
+    while (pos < text.size() && kCharTable.Is(text[pos], cls)) {
+        ++pos;
+    }
+    return pos;
+}
+
+/**
+ * FindByte - Find the next occurrence of a byte
+ */
+size_t FindByte(std::string_view text, size_t pos, char c) {
+    const char* data = text.data();
+    size_t size = text.size();
+
+#ifdef DSLANG_SCAN_WIDTH
+    Block needle = Splat(c);
+    while (pos + DSLANG_SCAN_WIDTH <= size) {
+        uint32_t hits = Mask(Equal(Load(data + pos), needle));
+        if (hits) {
+            return pos + __builtin_ctz(hits);
+        }
+        pos += DSLANG_SCAN_WIDTH;
+    }
+#endif
+
+    if (pos >= size) {
+        return size;
+    }
+    const void* hit = std::memchr(data + pos, c, size - pos);
+    return hit ? static_cast<size_t>(static_cast<const char*>(hit) - data) : size;
+}
+
+} // anonymous namespace
+
+/**
+ * FindNonWhitespace - Skip a run of whitespace
+ */
+size_t FindNonWhitespace(std::string_view text, size_t pos) {
+#ifdef DSLANG_SCAN_WIDTH
+    pos = SkipBlocks<SpaceMask>(text, pos);
+#endif
+    return SkipScalar(text, pos, kSpace);
+}
+
+/**
+ * FindIdentifierEnd - Skip a run of identifier characters
+ */
+size_t FindIdentifierEnd(std::string_view text, size_t pos) {
+#ifdef DSLANG_SCAN_WIDTH
+    pos = SkipBlocks<IdentMask>(text, pos);
+#endif
+    return SkipScalar(text, pos, kIdent);
+}
+
+/**
+ * FindLineEnd - Find the end of a line comment
+ */
+size_t FindLineEnd(std::string_view text, size_t pos) {
+    return FindByte(text, pos, '\n');
+}
+
+/**
+ * FindBlockCommentEnd - Find the end of a block comment body
+ */
+size_t FindBlockCommentEnd(std::string_view text, size_t pos) {
+    while (true) {
+        pos = FindByte(text, pos, '*');
+        if (pos + 1 >= text.size()) {
+            return text.size();
+        }
+        if (text[pos + 1] == '/') {
+            return pos;
+        }
+        ++pos;
+    }
+}
+
+/**
+ * CountNewlines - Count the newlines in a range
+ */
+size_t CountNewlines(std::string_view text, size_t begin, size_t end, size_t* last_newline) {
+    const char* data = text.data();
+    size_t count = 0;
+    size_t pos = begin;
+
+#ifdef DSLANG_SCAN_WIDTH
+    Block newline = Splat('\n');
+    while (pos + DSLANG_SCAN_WIDTH <= end) {
+        uint32_t hits = Mask(Equal(Load(data + pos), newline));
+        if (hits) {
+            count += __builtin_popcount(hits);
+            *last_newline = pos + (31 - __builtin_clz(hits));
+        }
+        pos += DSLANG_SCAN_WIDTH;
+    }
+#endif
+
+    for (; pos < end; ++pos) {
+        if (data[pos] == '\n') {
+            ++count;
+            *last_newline = pos;
+        }
+    }
+    return count;
+}
+
+} // namespace dsLang
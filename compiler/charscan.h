@@ -0,0 +1,74 @@
+/**
+ * charscan.h - Bulk Character Scanning for the dsLang Lexer
+ *
+ * This file declares the routines the lexer uses to skip over runs of
+ * whitespace, comment bodies and identifier characters. When the compiler
+ * targets SSE2 or AVX2 they classify 16 or 32 bytes per step; otherwise
+ * they fall back to a table-driven scalar loop. All of them stop at the end
+ * of the text and never read past it.
+ */
+
+#ifndef DSLANG_CHARSCAN_H
+#define DSLANG_CHARSCAN_H
+
+#include <cstddef>
+#include <string_view>
+
+namespace dsLang {
+
+/**
+ * FindNonWhitespace - Skip a run of whitespace
+ *
+ * Whitespace is the same set as std::isspace in the "C" locale.
+ *
+ * @param text The text to scan
+ * @param pos The position to start at
+ * @return The position of the first non-whitespace byte, or text.size()
+ */
+size_t FindNonWhitespace(std::string_view text, size_t pos);
+
+/**
+ * FindIdentifierEnd - Skip a run of identifier characters
+ *
+ * Identifier characters are ASCII letters, digits and '_'.
+ *
+ * @param text The text to scan
+ * @param pos The position to start at
+ * @return The position of the first non-identifier byte, or text.size()
+ */
+size_t FindIdentifierEnd(std::string_view text, size_t pos);
+
+/**
+ * FindLineEnd - Find the end of a line comment
+ *
+ * @param text The text to scan
+ * @param pos The position to start at
+ * @return The position of the next '\n', or text.size()
+ */
+size_t FindLineEnd(std::string_view text, size_t pos);
+
+/**
+ * FindBlockCommentEnd - Find the end of a block comment body
+ *
+ * @param text The text to scan
+ * @param pos The position just after the opening slash-star
+ * @return The position of the closing star-slash, or text.size() if the
+ *         comment is unterminated
+ */
+size_t FindBlockCommentEnd(std::string_view text, size_t pos);
+
+/**
+ * CountNewlines - Count the newlines in a range
+ *
+ * @param text The text to scan
+ * @param begin The start of the range
+ * @param end The end of the range (exclusive)
+ * @param last_newline Receives the position of the last newline in the
+ *        range; left untouched if there is none
+ * @return The number of '\n' bytes in [begin, end)
+ */
+size_t CountNewlines(std::string_view text, size_t begin, size_t end, size_t* last_newline);
+
+} // namespace dsLang
+
+#endif // DSLANG_CHARSCAN_H
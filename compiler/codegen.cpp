@@ -6,49 +6,58 @@
  */
 
 #include "codegen.h"
+#include "backend.h"
+#include "cache.h"
+#include "fingerprint.h"
+#include "optimizer.h"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Linker/Linker.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Transforms/Utils/Cloning.h>
+#include <algorithm>
 #include <sstream>
 #include <iostream>
 
 namespace dsLang {
 
+namespace {
+
+// Branch weights of the right operand of && and ||. Guards such as
+// "p && p->ready" or "!p || !p->ready" usually let the right operand run;
+// the ratio is the one LLVM assumes for pointer comparisons.
+constexpr uint32_t kRhsEvaluatedWeight = 20;
+constexpr uint32_t kRhsSkippedWeight = 12;
+
+} // anonymous namespace
+
 /**
  * Constructor - Initialize the code generator
  */
-CodeGenerator::CodeGenerator(const std::string& module_name, const std::string& target_triple)
+CodeGenerator::CodeGenerator(const std::string& module_name, const std::string& target_triple,
+                             unsigned opt_level)
     : context_(std::make_unique<llvm::LLVMContext>()),
       module_(std::make_unique<llvm::Module>(module_name, *context_)),
       builder_(std::make_unique<llvm::IRBuilder<>>(*context_)),
       target_triple_(target_triple),
+      opt_level_(opt_level),
       current_function_(nullptr) {
     
-    // Initialize LLVM targets
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
-    
     // Set the target triple
     module_->setTargetTriple(target_triple_);
     
-    // Initialize the target machine
+    // Lease a target machine; targets are registered once per process and
+    // machines are pooled across code generators
     std::string error;
-    auto target = llvm::TargetRegistry::lookupTarget(target_triple_, error);
+    target_machine_ = BackendContext::Get().AcquireTargetMachine(
+        target_triple_, "generic", "", opt_level_, &error);
     
-    if (!target) {
+    if (!target_machine_) {
         std::cerr << "Failed to lookup target: " << error << std::endl;
         return;
     }
     
-    auto cpu = "generic";
-    auto features = "";
-    
-    llvm::TargetOptions opt;
-    // Use a static relocation model
-    auto reloc_model = llvm::Reloc::Static;
-    target_machine_ = std::unique_ptr<llvm::TargetMachine>(
-        target->createTargetMachine(target_triple_, cpu, features, opt, reloc_model));
-    
     module_->setDataLayout(target_machine_->createDataLayout());
 
     // Create the initial scope
@@ -58,22 +67,82 @@ CodeGenerator::CodeGenerator(const std::string& module_name, const std::string&
 /**
  * Generate - Generate code for a compilation unit
  */
-void CodeGenerator::Generate(CompilationUnit* unit) {
-    // Add runtime functions and structs
-    DeclareRuntimeFunctions();
+bool CodeGenerator::Generate(CompilationUnit* unit) {
+    // Key every function definition for the function cache; inlining makes
+    // callees' bodies part of the optimized code
+    if (function_cache_) {
+        ScopedTimer timer(time_report_, "Function fingerprinting");
+        for (const auto& entry : ComputeFunctionFingerprints(unit, opt_level_ > 0)) {
+            function_keys_[entry.first] = function_cache_->ComputeKey(
+                entry.second, target_triple_, opt_level_, "func-bc");
+        }
+    }
     
-    // Process all declarations
-    for (const auto& decl : unit->GetDecls()) {
-        decl->Accept(this);
+    {
+        ScopedTimer timer(time_report_, "IR generation");
+        
+        // Add runtime functions and structs
+        DeclareRuntimeFunctions();
+        
+        // Process all declarations
+        VisitCompilationUnit(unit);
+        ShareStringSuffixes();
+        
+        // Verify the module
+        std::string error;
+        llvm::raw_string_ostream error_stream(error);
+        if (llvm::verifyModule(*module_, &error_stream)) {
+            std::cerr << "Module verification failed: " << error << std::endl;
+            return false;
+        }
     }
     
-    // Verify the module
-    std::string error;
-    llvm::raw_string_ostream error_stream(error);
-    if (llvm::verifyModule(*module_, &error_stream)) {
-        std::cerr << "Module verification failed: " << error << std::endl;
-        return;
+    // Fresh functions must be optimized against the reused bodies just as
+    // if those had been generated here, or their code (which is cached
+    // under fingerprints covering the callees) would depend on the cache
+    if (function_cache_ && opt_level_ > 0) {
+        ScopedTimer timer(time_report_, "Function cache");
+        if (!LinkInlinableDefinitions()) {
+            return false;
+        }
+    }
+    
+    // Optimize the verified module
+    {
+        ScopedTimer timer(time_report_, "Optimization");
+        OptimizeModule(*module_, target_machine_.Get(), opt_level_, time_report_);
+    }
+    
+    // Cached bodies were optimized when they were cached
+    if (function_cache_) {
+        ScopedTimer timer(time_report_, "Function cache");
+        DropInlinableDefinitions();
+        CacheFreshDefinitions();
+        return LinkCachedDefinitions();
     }
+    return true;
+}
+
+/**
+ * SetShard - Restrict code generation to one shard of the functions
+ */
+void CodeGenerator::SetShard(unsigned shard_index, unsigned shard_count) {
+    shard_index_ = shard_index;
+    shard_count_ = shard_count ? shard_count : 1;
+}
+
+/**
+ * SetFunctionCache - Reuse the optimized code of unchanged functions
+ */
+void CodeGenerator::SetFunctionCache(CompileCache* cache) {
+    function_cache_ = cache;
+}
+
+/**
+ * SetTimeReport - Record phase, per-function and pass timings
+ */
+void CodeGenerator::SetTimeReport(TimeReport* report) {
+    time_report_ = report;
 }
 
 /**
@@ -91,34 +160,221 @@ void CodeGenerator::EmitIR(const std::string& filename) {
     module_->print(dest, nullptr);
 }
 
+/**
+ * TakeModule - Hand the generated module and its context to a JIT
+ */
+llvm::orc::ThreadSafeModule CodeGenerator::TakeModule() {
+    return llvm::orc::ThreadSafeModule(std::move(module_), std::move(context_));
+}
+
 /**
  * EmitObject - Emit object code to the specified file
  */
-void CodeGenerator::EmitObject(const std::string& filename) {
+bool CodeGenerator::EmitObject(const std::string& filename) {
+    return EmitFile(filename, llvm::CodeGenFileType::ObjectFile);
+}
+
+/**
+ * EmitAssembly - Emit assembly code to the specified file
+ */
+bool CodeGenerator::EmitAssembly(const std::string& filename) {
+    return EmitFile(filename, llvm::CodeGenFileType::AssemblyFile);
+}
+
+/**
+ * EmitFile - Run the target's code generation passes into a file
+ */
+bool CodeGenerator::EmitFile(const std::string& filename, llvm::CodeGenFileType file_type) {
+    if (!target_machine_) {
+        std::cerr << "No target machine for " << target_triple_ << std::endl;
+        return false;
+    }
+    
     std::error_code ec;
     llvm::raw_fd_ostream dest(filename, ec, llvm::sys::fs::OF_None);
     
     if (ec) {
         std::cerr << "Could not open file: " << ec.message() << std::endl;
-        return;
+        return false;
     }
     
+    ScopedTimer timer(time_report_, "Emission");
     llvm::legacy::PassManager pass;
-    auto file_type = llvm::CodeGenFileType::ObjectFile;
     
     if (target_machine_->addPassesToEmitFile(pass, dest, nullptr, file_type)) {
         std::cerr << "Target machine can't emit a file of this type" << std::endl;
-        return;
+        return false;
     }
     
     pass.run(*module_);
     dest.flush();
+    return !dest.has_error();
 }
 
 //===----------------------------------------------------------------------===//
 // Helper methods
 //===----------------------------------------------------------------------===//
 
+/**
+ * TakeDefinition - Number the next function definition
+ */
+bool CodeGenerator::TakeDefinition() {
+    return definition_count_++ % shard_count_ == shard_index_;
+}
+
+/**
+ * ReuseDefinition - Look up a function's body in the function cache
+ */
+bool CodeGenerator::ReuseDefinition(const std::string& name) {
+    if (!function_cache_) {
+        return false;
+    }
+    
+    // Functions without a key (e.g. defined twice) are never cached
+    auto key_it = function_keys_.find(name);
+    if (key_it == function_keys_.end()) {
+        return false;
+    }
+    
+    std::string bitcode;
+    if (function_cache_->Load(key_it->second, &bitcode)) {
+        cached_definitions_.push_back(std::move(bitcode));
+        return true;
+    }
+    
+    fresh_definitions_.push_back(name);
+    return false;
+}
+
+/**
+ * CacheFreshDefinitions - Add each optimized fresh body to the cache
+ */
+void CodeGenerator::CacheFreshDefinitions() {
+    for (const auto& name : fresh_definitions_) {
+        // Bodies that failed verification were erased
+        llvm::Function* func = module_->getFunction(name);
+        if (!func || func->isDeclaration()) {
+            continue;
+        }
+        
+        // Extract the body into a module of its own, keeping the internal
+        // constants (string literals) it refers to
+        llvm::ValueToValueMapTy value_map;
+        std::unique_ptr<llvm::Module> extracted = llvm::CloneModule(
+            *module_, value_map, [func](const llvm::GlobalValue* value) {
+                return value == func ||
+                       (value->hasLocalLinkage() && llvm::isa<llvm::GlobalVariable>(value));
+            });
+        
+        // Drop everything the body does not use
+        for (auto it = extracted->global_begin(); it != extracted->global_end();) {
+            llvm::GlobalVariable& global = *it++;
+            global.removeDeadConstantUsers();
+            if (global.use_empty()) {
+                global.eraseFromParent();
+            }
+        }
+        for (auto it = extracted->begin(); it != extracted->end();) {
+            llvm::Function& declaration = *it++;
+            if (declaration.isDeclaration() && declaration.use_empty()) {
+                declaration.eraseFromParent();
+            }
+        }
+        
+        llvm::SmallVector<char, 0> bitcode;
+        llvm::raw_svector_ostream stream(bitcode);
+        llvm::WriteBitcodeToFile(*extracted, stream);
+        function_cache_->Save(function_keys_[name], std::string_view(bitcode.data(), bitcode.size()));
+    }
+}
+
+/**
+ * ReadCachedDefinition - Read the module of a reused body
+ */
+std::unique_ptr<llvm::Module> CodeGenerator::ReadCachedDefinition(const std::string& bitcode) {
+    llvm::Expected<std::unique_ptr<llvm::Module>> cached = llvm::parseBitcodeFile(
+        llvm::MemoryBufferRef(bitcode, "cached function"), *context_);
+    if (!cached) {
+        std::cerr << "Could not read cached function: "
+                  << llvm::toString(cached.takeError()) << std::endl;
+        return nullptr;
+    }
+    return std::move(*cached);
+}
+
+/**
+ * LinkInlinableDefinitions - Link copies of the reused bodies for the
+ * optimizer to inline
+ *
+ * The copies are available_externally, so the optimizer may inline and
+ * analyze them but never emits them.
+ */
+bool CodeGenerator::LinkInlinableDefinitions() {
+    for (const auto& bitcode : cached_definitions_) {
+        std::unique_ptr<llvm::Module> cached = ReadCachedDefinition(bitcode);
+        if (!cached) {
+            return false;
+        }
+        for (llvm::Function& func : *cached) {
+            if (!func.isDeclaration() && !func.hasLocalLinkage()) {
+                func.setLinkage(llvm::GlobalValue::AvailableExternallyLinkage);
+                inlinable_definitions_.push_back(func.getName().str());
+            }
+        }
+        
+        if (llvm::Linker::linkModules(*module_, std::move(cached))) {
+            std::cerr << "Could not link cached function" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * DropInlinableDefinitions - Turn the inlinable copies back into declarations
+ */
+void CodeGenerator::DropInlinableDefinitions() {
+    if (inlinable_definitions_.empty()) {
+        return;
+    }
+    for (const auto& name : inlinable_definitions_) {
+        llvm::Function* func = module_->getFunction(name);
+        if (func && !func->isDeclaration()) {
+            func->deleteBody();
+        }
+    }
+    inlinable_definitions_.clear();
+    
+    // The optimizer already dropped every other unused internal constant,
+    // so the ones left unused were only referenced by the copies
+    for (auto it = module_->global_begin(); it != module_->global_end();) {
+        llvm::GlobalVariable& global = *it++;
+        global.removeDeadConstantUsers();
+        if (global.hasLocalLinkage() && global.use_empty()) {
+            global.eraseFromParent();
+        }
+    }
+}
+
+/**
+ * LinkCachedDefinitions - Link the reused bodies into the module
+ */
+bool CodeGenerator::LinkCachedDefinitions() {
+    for (const auto& bitcode : cached_definitions_) {
+        std::unique_ptr<llvm::Module> cached = ReadCachedDefinition(bitcode);
+        if (!cached) {
+            return false;
+        }
+        
+        // The module declares the function; the cached module defines it
+        if (llvm::Linker::linkModules(*module_, std::move(cached))) {
+            std::cerr << "Could not link cached function" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
 /**
  * DeclareRuntimeFunctions - Declare runtime functions used by the standard library
  */
@@ -242,12 +498,27 @@ void CodeGenerator::EndScope() {
 /**
  * ConvertType - Convert a dsLang type to an LLVM type
  */
-llvm::Type* CodeGenerator::ConvertType(const std::shared_ptr<Type>& type) {
+llvm::Type* CodeGenerator::ConvertType(Type* type) {
     if (!type) {
         // Handle null type pointer - return void type as fallback
         return llvm::Type::getVoidTy(*context_);
     }
     
+    auto it = llvm_types_.find(type);
+    if (it != llvm_types_.end()) {
+        return it->second;
+    }
+    
+    // Building may convert (and cache) other types, so look the slot up afresh
+    llvm::Type* llvm_type = BuildType(type);
+    llvm_types_[type] = llvm_type;
+    return llvm_type;
+}
+
+/**
+ * BuildType - Build the LLVM type for a dsLang type not yet converted
+ */
+llvm::Type* CodeGenerator::BuildType(Type* type) {
     switch (type->GetKind()) {
         case Type::Kind::VOID:
             return llvm::Type::getVoidTy(*context_);
@@ -274,19 +545,19 @@ llvm::Type* CodeGenerator::ConvertType(const std::shared_ptr<Type>& type) {
             return llvm::Type::getDoubleTy(*context_);
             
         case Type::Kind::POINTER: {
-            auto ptr_type = std::static_pointer_cast<PointerType>(type);
+            auto ptr_type = static_cast<PointerType*>(type);
             return llvm::PointerType::get(ConvertType(ptr_type->GetPointeeType()), 0);
         }
             
         case Type::Kind::ARRAY: {
-            auto array_type = std::static_pointer_cast<ArrayType>(type);
+            auto array_type = static_cast<ArrayType*>(type);
             return llvm::ArrayType::get(
                 ConvertType(array_type->GetElementType()),
                 array_type->GetSize());
         }
             
         case Type::Kind::FUNCTION: {
-            auto func_type = std::static_pointer_cast<FunctionType>(type);
+            auto func_type = static_cast<FunctionType*>(type);
             
             std::vector<llvm::Type*> param_types;
             for (const auto& param_type : func_type->GetParamTypes()) {
@@ -302,32 +573,30 @@ llvm::Type* CodeGenerator::ConvertType(const std::shared_ptr<Type>& type) {
         }
             
         case Type::Kind::STRUCT: {
-            auto struct_type = std::static_pointer_cast<StructType>(type);
-            auto name = struct_type->GetName();
+            auto struct_type = static_cast<StructType*>(type);
             
-            // If the struct type is already defined, return it
-            auto it = struct_types_.find(name);
-            if (it != struct_types_.end()) {
-                return it->second;
-            }
-            
-            // Otherwise, create a new struct type
+            // Cache the struct before its fields, so that fields pointing
+            // back to it find it instead of recursing
             llvm::StructType* llvm_struct_type = llvm::StructType::create(
                 *context_,
-                name);
-            struct_types_[name] = llvm_struct_type;
-            
-            // Set the body of the struct type
-            std::vector<llvm::Type*> field_types;
-            for (const auto& field_pair : struct_type->GetFields()) {
-                field_types.push_back(ConvertType(field_pair.second));
+                struct_type->GetName());
+            llvm_types_[type] = llvm_struct_type;
+            
+            // A struct that is only declared stays opaque
+            if (struct_type->IsComplete()) {
+                std::vector<llvm::Type*> field_types;
+                for (const auto& field_pair : struct_type->GetFields()) {
+                    field_types.push_back(ConvertType(field_pair.second));
+                }
+                llvm_struct_type->setBody(field_types);
             }
             
-            llvm_struct_type->setBody(field_types);
-            
             return llvm_struct_type;
         }
             
+        case Type::Kind::ENUM:
+            return ConvertType(static_cast<EnumType*>(type)->GetBaseType());
+            
         default:
             std::cerr << "Unsupported type kind: " << std::to_string(static_cast<int>(type->GetKind())) << std::endl;
             return nullptr;
@@ -369,32 +638,98 @@ llvm::Value* CodeGenerator::ConvertToBoolean(llvm::Value* value) {
     return llvm::ConstantInt::getFalse(*context_);
 }
 
+/**
+ * GetStringLiteral - Get the pooled constant holding a string literal
+ *
+ * The constant is unnamed_addr with byte alignment, so the backend puts it
+ * in a mergeable string section and the linker can also merge it with the
+ * same string from other object files.
+ */
+llvm::GlobalVariable* CodeGenerator::GetStringLiteral(const std::string& str) {
+    auto it = string_literals_.find(str);
+    if (it != string_literals_.end()) {
+        return it->second;
+    }
+    
+    llvm::Constant* strConstant = llvm::ConstantDataArray::getString(*context_, str, true);
+    llvm::GlobalVariable* globalStr = new llvm::GlobalVariable(
+        *module_,
+        strConstant->getType(),
+        true,
+        llvm::GlobalValue::PrivateLinkage,
+        strConstant,
+        ".str");
+    globalStr->setUnnamedAddr(llvm::GlobalValue::UnnamedAddr::Global);
+    globalStr->setAlignment(llvm::Align(1));
+    
+    string_literals_.emplace(str, globalStr);
+    return globalStr;
+}
+
+/**
+ * ShareStringSuffixes - Point literals that end another literal into it
+ *
+ * "error\n" is stored as the tail of "disk error\n" rather than on its own.
+ * Sorted by their reversed text, in descending order, every literal that
+ * ends another one comes right after a literal it ends, so one pass finds
+ * them all.
+ */
+void CodeGenerator::ShareStringSuffixes() {
+    std::vector<std::pair<std::string, llvm::GlobalVariable*>> literals;
+    for (const auto& entry : string_literals_) {
+        literals.emplace_back(std::string(entry.first.rbegin(), entry.first.rend()), entry.second);
+    }
+    std::sort(literals.begin(), literals.end(),
+              [](const auto& a, const auto& b) { return a.first > b.first; });
+    
+    // The literal that holds the previous one, and its reversed text
+    const std::string* host_text = nullptr;
+    llvm::GlobalVariable* host = nullptr;
+    
+    for (const auto& literal : literals) {
+        const std::string& text = literal.first;
+        if (!host || host_text->compare(0, text.size(), text) != 0) {
+            host_text = &text;
+            host = literal.second;
+            continue;
+        }
+        
+        // Point every use at the tail of the host and drop the literal
+        llvm::Type* index_type = llvm::Type::getInt64Ty(*context_);
+        llvm::Constant* indices[] = {
+            llvm::ConstantInt::get(index_type, 0),
+            llvm::ConstantInt::get(index_type, host_text->size() - text.size())
+        };
+        llvm::Constant* tail = llvm::ConstantExpr::getInBoundsGetElementPtr(
+            host->getValueType(), host, indices);
+        literal.second->replaceAllUsesWith(
+            llvm::ConstantExpr::getPointerCast(tail, literal.second->getType()));
+        literal.second->eraseFromParent();
+    }
+    string_literals_.clear();
+}
+
 /**
  * GetLValue - Get the address of an expression for assignment
  */
 llvm::Value* CodeGenerator::GetLValue(Expr* expr) {
     if (auto var_expr = dynamic_cast<VarExpr*>(expr)) {
-        const std::string& name = var_expr->GetName();
-        
         // Look up the variable in the symbol table
-        auto it = named_values_.find(name);
+        auto it = named_values_.find(var_expr->GetSymbol());
         if (it == named_values_.end()) {
-            std::cerr << "Unknown variable name: " << name << std::endl;
+            std::cerr << "Unknown variable name: " << var_expr->GetName() << std::endl;
             return nullptr;
         }
         
         return it->second;
     }
     else if (auto subscript_expr = dynamic_cast<SubscriptExpr*>(expr)) {
-        // Visit the array/pointer
-        subscript_expr->GetArray()->Accept(this);
-        llvm::Value* array = value_stack_.top();
-        value_stack_.pop();
-        
-        // Visit the index
-        subscript_expr->GetIndex()->Accept(this);
-        llvm::Value* index = value_stack_.top();
-        value_stack_.pop();
+        // Evaluate the array/pointer and the index
+        llvm::Value* array = EmitExpr(subscript_expr->GetArray());
+        llvm::Value* index = EmitExpr(subscript_expr->GetIndex());
+        if (!array || !index) {
+            return nullptr;
+        }
         
         // Calculate the element address
         std::vector<llvm::Value*> indices;
@@ -408,9 +743,8 @@ llvm::Value* CodeGenerator::GetLValue(Expr* expr) {
     }
     else if (auto unary_expr = dynamic_cast<UnaryExpr*>(expr)) {
         if (unary_expr->GetOp() == UnaryExpr::Op::DEREF) {
-            // Visit the operand
-            unary_expr->GetOperand()->Accept(this);
-            return value_stack_.top();
+            // The operand is the address
+            return EmitExpr(unary_expr->GetOperand());
         }
     }
     
@@ -420,22 +754,38 @@ llvm::Value* CodeGenerator::GetLValue(Expr* expr) {
 
 /**
  * EmitLogicalAnd - Emit code for short-circuit logical AND
+ *
+ * The RHS is only evaluated, side effects included, if the LHS is true.
  */
-llvm::Value* CodeGenerator::EmitLogicalAnd(llvm::Value* lhs, llvm::Value* rhs) {
-    // Convert LHS to boolean
-    llvm::Value* lhs_bool = ConvertToBoolean(lhs);
+llvm::Value* CodeGenerator::EmitLogicalAnd(Expr* lhs, Expr* rhs) {
+    // Evaluate the LHS and convert it to boolean
+    llvm::Value* lhs_value = EmitExpr(lhs);
+    if (!lhs_value) {
+        return nullptr;
+    }
+    llvm::Value* lhs_bool = ConvertToBoolean(lhs_value);
+    
+    // The LHS may have ended in a block of its own, e.g. a nested && or ||
+    llvm::BasicBlock* lhs_block = builder_->GetInsertBlock();
     
     // Create the basic blocks
-    llvm::Function* func = builder_->GetInsertBlock()->getParent();
+    llvm::Function* func = lhs_block->getParent();
     llvm::BasicBlock* rhs_block = llvm::BasicBlock::Create(*context_, "and_rhs", func);
     llvm::BasicBlock* end_block = llvm::BasicBlock::Create(*context_, "and_end", func);
     
     // Branch to the RHS block if LHS is true, otherwise short-circuit
-    builder_->CreateCondBr(lhs_bool, rhs_block, end_block);
+    llvm::MDNode* weights = llvm::MDBuilder(*context_).createBranchWeights(
+        kRhsEvaluatedWeight, kRhsSkippedWeight);
+    builder_->CreateCondBr(lhs_bool, rhs_block, end_block, weights);
     
     // Emit the RHS block
     builder_->SetInsertPoint(rhs_block);
-    llvm::Value* rhs_bool = ConvertToBoolean(rhs);
+    llvm::Value* rhs_value = EmitExpr(rhs);
+    if (!rhs_value) {
+        return nullptr;
+    }
+    llvm::Value* rhs_bool = ConvertToBoolean(rhs_value);
+    llvm::BasicBlock* rhs_end_block = builder_->GetInsertBlock();
     builder_->CreateBr(end_block);
     
     // Emit the end block
@@ -447,33 +797,46 @@ llvm::Value* CodeGenerator::EmitLogicalAnd(llvm::Value* lhs, llvm::Value* rhs) {
         2,
         "andtmp");
     
-    result->addIncoming(
-        llvm::ConstantInt::getFalse(*context_),
-        builder_->GetInsertBlock()->getParent()->getEntryBlock().getFirstNonPHI()->getParent());
-    
-    result->addIncoming(rhs_bool, rhs_block);
+    result->addIncoming(llvm::ConstantInt::getFalse(*context_), lhs_block);
+    result->addIncoming(rhs_bool, rhs_end_block);
     
     return result;
 }
 
 /**
  * EmitLogicalOr - Emit code for short-circuit logical OR
+ *
+ * The RHS is only evaluated, side effects included, if the LHS is false.
  */
-llvm::Value* CodeGenerator::EmitLogicalOr(llvm::Value* lhs, llvm::Value* rhs) {
-    // Convert LHS to boolean
-    llvm::Value* lhs_bool = ConvertToBoolean(lhs);
+llvm::Value* CodeGenerator::EmitLogicalOr(Expr* lhs, Expr* rhs) {
+    // Evaluate the LHS and convert it to boolean
+    llvm::Value* lhs_value = EmitExpr(lhs);
+    if (!lhs_value) {
+        return nullptr;
+    }
+    llvm::Value* lhs_bool = ConvertToBoolean(lhs_value);
+    
+    // The LHS may have ended in a block of its own, e.g. a nested && or ||
+    llvm::BasicBlock* lhs_block = builder_->GetInsertBlock();
     
     // Create the basic blocks
-    llvm::Function* func = builder_->GetInsertBlock()->getParent();
+    llvm::Function* func = lhs_block->getParent();
     llvm::BasicBlock* rhs_block = llvm::BasicBlock::Create(*context_, "or_rhs", func);
     llvm::BasicBlock* end_block = llvm::BasicBlock::Create(*context_, "or_end", func);
     
     // Branch to the RHS block if LHS is false, otherwise short-circuit
-    builder_->CreateCondBr(lhs_bool, end_block, rhs_block);
+    llvm::MDNode* weights = llvm::MDBuilder(*context_).createBranchWeights(
+        kRhsSkippedWeight, kRhsEvaluatedWeight);
+    builder_->CreateCondBr(lhs_bool, end_block, rhs_block, weights);
     
     // Emit the RHS block
     builder_->SetInsertPoint(rhs_block);
-    llvm::Value* rhs_bool = ConvertToBoolean(rhs);
+    llvm::Value* rhs_value = EmitExpr(rhs);
+    if (!rhs_value) {
+        return nullptr;
+    }
+    llvm::Value* rhs_bool = ConvertToBoolean(rhs_value);
+    llvm::BasicBlock* rhs_end_block = builder_->GetInsertBlock();
     builder_->CreateBr(end_block);
     
     // Emit the end block
@@ -485,11 +848,8 @@ llvm::Value* CodeGenerator::EmitLogicalOr(llvm::Value* lhs, llvm::Value* rhs) {
         2,
         "ortmp");
     
-    result->addIncoming(
-        llvm::ConstantInt::getTrue(*context_),
-        builder_->GetInsertBlock()->getParent()->getEntryBlock().getFirstNonPHI()->getParent());
-    
-    result->addIncoming(rhs_bool, rhs_block);
+    result->addIncoming(llvm::ConstantInt::getTrue(*context_), lhs_block);
+    result->addIncoming(rhs_bool, rhs_end_block);
     
     return result;
 }
@@ -575,7 +935,7 @@ llvm::Value* CodeGenerator::EmitPostDecrement(Expr* expr, llvm::Value* value) {
 /**
  * IsFloatingPointType - Check if a type is a floating point type
  */
-bool CodeGenerator::IsFloatingPointType(const std::shared_ptr<Type>& type) {
+bool CodeGenerator::IsFloatingPointType(Type* type) {
     return type->GetKind() == Type::Kind::FLOAT || 
            type->GetKind() == Type::Kind::DOUBLE;
 }
@@ -583,9 +943,9 @@ bool CodeGenerator::IsFloatingPointType(const std::shared_ptr<Type>& type) {
 /**
  * IsUnsignedType - Check if a type is an unsigned integer type
  */
-bool CodeGenerator::IsUnsignedType(const std::shared_ptr<Type>& type) {
+bool CodeGenerator::IsUnsignedType(Type* type) {
     // Check if this is a PrimitiveType with unsigned sign kind
-    if (auto prim_type = std::dynamic_pointer_cast<PrimitiveType>(type)) {
+    if (auto prim_type = dynamic_cast<PrimitiveType*>(type)) {
         return prim_type->IsUnsigned();
     }
     return false;
@@ -594,7 +954,7 @@ bool CodeGenerator::IsUnsignedType(const std::shared_ptr<Type>& type) {
 /**
  * IsIntegerType - Check if a type is an integer type
  */
-bool CodeGenerator::IsIntegerType(const std::shared_ptr<Type>& type) {
+bool CodeGenerator::IsIntegerType(Type* type) {
     return type->GetKind() == Type::Kind::BOOL || 
            type->GetKind() == Type::Kind::CHAR || 
            type->GetKind() == Type::Kind::SHORT || 
@@ -606,7 +966,7 @@ bool CodeGenerator::IsIntegerType(const std::shared_ptr<Type>& type) {
 /**
  * GetTypeSize - Get the size of a type in bits
  */
-unsigned CodeGenerator::GetTypeSize(const std::shared_ptr<Type>& type) {
+unsigned CodeGenerator::GetTypeSize(Type* type) {
     switch (type->GetKind()) {
         case Type::Kind::BOOL:
             return 1;
@@ -636,21 +996,65 @@ unsigned CodeGenerator::GetTypeSize(const std::shared_ptr<Type>& type) {
 }
 
 //===----------------------------------------------------------------------===//
-// ASTVisitor implementation - Expressions
+// Expressions
 //===----------------------------------------------------------------------===//
 
 /**
- * VisitBinaryExpr - Visit a binary expression node
+ * EmitExpr - Emit code for an expression
+ *
+ * Expressions return their values directly instead of through the visitor,
+ * so that each parent gets exactly the values of its own operands.
+ */
+llvm::Value* CodeGenerator::EmitExpr(Expr* expr) {
+    switch (expr->GetKind()) {
+        case Expr::Kind::BINARY:
+            return EmitBinaryExpr(static_cast<BinaryExpr*>(expr));
+            
+        case Expr::Kind::UNARY:
+            return EmitUnaryExpr(static_cast<UnaryExpr*>(expr));
+            
+        case Expr::Kind::LITERAL:
+            return EmitLiteralExpr(static_cast<LiteralExpr*>(expr));
+            
+        case Expr::Kind::VAR:
+            return EmitVarExpr(static_cast<VarExpr*>(expr));
+            
+        case Expr::Kind::ASSIGN:
+            return EmitAssignExpr(static_cast<AssignExpr*>(expr));
+            
+        case Expr::Kind::CALL:
+            return EmitCallExpr(static_cast<CallExpr*>(expr));
+            
+        case Expr::Kind::MESSAGE:
+            return EmitMessageExpr(static_cast<MessageExpr*>(expr));
+            
+        case Expr::Kind::SUBSCRIPT:
+            return EmitSubscriptExpr(static_cast<SubscriptExpr*>(expr));
+            
+        case Expr::Kind::CAST:
+            return EmitCastExpr(static_cast<CastExpr*>(expr));
+    }
+    return nullptr;
+}
+
+/**
+ * EmitBinaryExpr - Emit code for a binary expression
  */
-void CodeGenerator::VisitBinaryExpr(BinaryExpr* expr) {
-    // Visit the operands
-    expr->GetLeft()->Accept(this);
-    auto L = value_stack_.top();
-    value_stack_.pop();
+llvm::Value* CodeGenerator::EmitBinaryExpr(BinaryExpr* expr) {
+    // Logical operators must branch before the RHS is evaluated
+    if (expr->GetOp() == BinaryExpr::Op::LOGICAL_AND) {
+        return EmitLogicalAnd(expr->GetLeft(), expr->GetRight());
+    }
+    if (expr->GetOp() == BinaryExpr::Op::LOGICAL_OR) {
+        return EmitLogicalOr(expr->GetLeft(), expr->GetRight());
+    }
     
-    expr->GetRight()->Accept(this);
-    auto R = value_stack_.top();
-    value_stack_.pop();
+    // Evaluate the operands
+    llvm::Value* L = EmitExpr(expr->GetLeft());
+    llvm::Value* R = EmitExpr(expr->GetRight());
+    if (!L || !R) {
+        return nullptr;
+    }
     
     // Generate code based on the operator
     llvm::Value* result = nullptr;
@@ -779,27 +1183,28 @@ void CodeGenerator::VisitBinaryExpr(BinaryExpr* expr) {
             break;
             
         case BinaryExpr::Op::LOGICAL_AND:
-            // Short-circuit evaluation for logical AND
-            result = EmitLogicalAnd(L, R);
-            break;
-            
         case BinaryExpr::Op::LOGICAL_OR:
-            // Short-circuit evaluation for logical OR
-            result = EmitLogicalOr(L, R);
+            // Emitted above, without evaluating the RHS up front
             break;
     }
     
-    value_stack_.push(result);
+    return result;
 }
 
 /**
- * VisitUnaryExpr - Visit a unary expression node
+ * EmitUnaryExpr - Emit code for a unary expression
  */
-void CodeGenerator::VisitUnaryExpr(UnaryExpr* expr) {
-    // Visit the operand
-    expr->GetOperand()->Accept(this);
-    llvm::Value* operand = value_stack_.top();
-    value_stack_.pop();
+llvm::Value* CodeGenerator::EmitUnaryExpr(UnaryExpr* expr) {
+    // Taking the address does not evaluate the operand
+    if (expr->GetOp() == UnaryExpr::Op::ADDR) {
+        return GetLValue(expr->GetOperand());
+    }
+    
+    // Evaluate the operand
+    llvm::Value* operand = EmitExpr(expr->GetOperand());
+    if (!operand) {
+        return nullptr;
+    }
     
     llvm::Value* result = nullptr;
     
@@ -821,36 +1226,31 @@ void CodeGenerator::VisitUnaryExpr(UnaryExpr* expr) {
             break;
             
         case UnaryExpr::Op::PRE_INC: {
-            // Get the raw pointer from the shared_ptr
-            Expr* operandExpr = expr->GetOperand().get();
+            Expr* operandExpr = expr->GetOperand();
             result = EmitPreIncrement(operandExpr, operand);
             break;
         }
             
         case UnaryExpr::Op::PRE_DEC: {
-            // Get the raw pointer from the shared_ptr
-            Expr* operandExpr = expr->GetOperand().get();
+            Expr* operandExpr = expr->GetOperand();
             result = EmitPreDecrement(operandExpr, operand);
             break;
         }
             
         case UnaryExpr::Op::POST_INC: {
-            // Get the raw pointer from the shared_ptr
-            Expr* operandExpr = expr->GetOperand().get();
+            Expr* operandExpr = expr->GetOperand();
             result = EmitPostIncrement(operandExpr, operand);
             break;
         }
             
         case UnaryExpr::Op::POST_DEC: {
-            // Get the raw pointer from the shared_ptr
-            Expr* operandExpr = expr->GetOperand().get();
+            Expr* operandExpr = expr->GetOperand();
             result = EmitPostDecrement(operandExpr, operand);
             break;
         }
             
         case UnaryExpr::Op::ADDR:
-            // Get the address of the operand
-            result = GetLValue(expr->GetOperand().get());
+            // Emitted above, without evaluating the operand
             break;
             
         case UnaryExpr::Op::DEREF:
@@ -862,13 +1262,13 @@ void CodeGenerator::VisitUnaryExpr(UnaryExpr* expr) {
             break;
     }
     
-    value_stack_.push(result);
+    return result;
 }
 
 /**
- * VisitLiteralExpr - Visit a literal expression node
+ * EmitLiteralExpr - Emit code for a literal
  */
-void CodeGenerator::VisitLiteralExpr(LiteralExpr* expr) {
+llvm::Value* CodeGenerator::EmitLiteralExpr(LiteralExpr* expr) {
     llvm::Value* result = nullptr;
     
     switch (expr->GetLiteralKind()) {
@@ -897,23 +1297,8 @@ void CodeGenerator::VisitLiteralExpr(LiteralExpr* expr) {
             break;
             
         case LiteralExpr::Kind::STRING: {
-            // Get the string value
-            const std::string& str = expr->GetStringValue();
-            
-            // Create a global constant for the string
-            llvm::Constant* strConstant = llvm::ConstantDataArray::getString(
-                *context_,
-                str,
-                true);
-            
-            // Create a global variable to hold the string
-            llvm::GlobalVariable* globalStr = new llvm::GlobalVariable(
-                *module_,
-                strConstant->getType(),
-                true,
-                llvm::GlobalValue::PrivateLinkage,
-                strConstant,
-                ".str");
+            // Identical literals share one global constant
+            llvm::GlobalVariable* globalStr = GetStringLiteral(expr->GetStringValue());
             
             // Get a pointer to the first element of the string
             llvm::Value* zero = llvm::ConstantInt::get(
@@ -938,95 +1323,106 @@ void CodeGenerator::VisitLiteralExpr(LiteralExpr* expr) {
             break;
     }
     
-    value_stack_.push(result);
+    return result;
 }
 
 /**
- * VisitVarExpr - Visit a variable expression node
+ * EmitVarExpr - Emit code for a variable reference
  */
-void CodeGenerator::VisitVarExpr(VarExpr* expr) {
+llvm::Value* CodeGenerator::EmitVarExpr(VarExpr* expr) {
     // Look up the variable in the symbol table
     const std::string& name = expr->GetName();
     llvm::Value* lvalue = nullptr;
     
-    auto it = named_values_.find(name);
+    auto it = named_values_.find(expr->GetSymbol());
     if (it == named_values_.end()) {
+        // Enumerators are immediates; variables of the same name shadow them
+        auto constant = enum_constants_.find(expr->GetSymbol());
+        if (constant != enum_constants_.end()) {
+            return constant->second;
+        }
+        
         std::cerr << "Unknown variable name: " << name << std::endl;
-        return;
+        return nullptr;
     }
     
     lvalue = it->second;
     
     // Load the variable's value
-    llvm::Value* value = builder_->CreateLoad(
+    return builder_->CreateLoad(
         ConvertType(expr->GetType()),
         lvalue,
         name.c_str());
-    
-    value_stack_.push(value);
 }
 
 /**
- * VisitAssignExpr - Visit an assignment expression node
+ * EmitAssignExpr - Emit code for an assignment
  */
-void CodeGenerator::VisitAssignExpr(AssignExpr* expr) {
+llvm::Value* CodeGenerator::EmitAssignExpr(AssignExpr* expr) {
     // Get the address of the target
-    llvm::Value* lvalue = GetLValue(expr->GetTarget().get());
+    llvm::Value* lvalue = GetLValue(expr->GetTarget());
     
     // Evaluate the value to be assigned
-    expr->GetValue()->Accept(this);
-    llvm::Value* rvalue = value_stack_.top();
-    value_stack_.pop();
+    llvm::Value* rvalue = EmitExpr(expr->GetValue());
+    if (!lvalue || !rvalue) {
+        return nullptr;
+    }
     
     // Store the value
     builder_->CreateStore(rvalue, lvalue);
     
     // The result of an assignment is the assigned value
-    value_stack_.push(rvalue);
+    return rvalue;
 }
 
 /**
- * VisitCallExpr - Visit a function call expression node
+ * EmitCallExpr - Emit code for a function call
  */
-void CodeGenerator::VisitCallExpr(CallExpr* expr) {
-    // Get the function
-    llvm::Function* callee = module_->getFunction(expr->GetCallee());
+llvm::Value* CodeGenerator::EmitCallExpr(CallExpr* expr) {
+    // Get the function, preferring the table of functions emitted so far
+    llvm::Function* callee = nullptr;
+    auto func_it = function_table_.find(expr->GetCalleeSymbol());
+    if (func_it != function_table_.end()) {
+        callee = func_it->second;
+    } else {
+        callee = module_->getFunction(expr->GetCallee());
+    }
     
     if (!callee) {
         std::cerr << "Unknown function: " << expr->GetCallee() << std::endl;
-        return;
+        return nullptr;
     }
     
     // Check number of arguments
     if (callee->arg_size() != expr->GetArgs().size() && !callee->isVarArg()) {
         std::cerr << "Incorrect number of arguments to function: " << expr->GetCallee() << std::endl;
-        // Instead of throwing an exception, push a dummy value and return
-        value_stack_.push(llvm::UndefValue::get(ConvertType(expr->GetType())));
-        return;
+        // Instead of throwing an exception, return a dummy value
+        return llvm::UndefValue::get(ConvertType(expr->GetType()));
     }
     
     // Evaluate the arguments
     std::vector<llvm::Value*> args;
     for (const auto& arg : expr->GetArgs()) {
-        arg->Accept(this);
-        args.push_back(value_stack_.top());
-        value_stack_.pop();
+        llvm::Value* value = EmitExpr(arg);
+        if (!value) {
+            return nullptr;
+        }
+        args.push_back(value);
     }
     
     // Call the function
-    llvm::Value* result = builder_->CreateCall(callee, args, "calltmp");
-    
-    value_stack_.push(result);
+    return builder_->CreateCall(callee, args, "calltmp");
 }
 
 /**
- * VisitMessageExpr - Visit an Objective-C style message expression node
+ * EmitMessageExpr - Emit code for an Objective-C style message
  */
-void CodeGenerator::VisitMessageExpr(MessageExpr* expr) {
+llvm::Value* CodeGenerator::EmitMessageExpr(MessageExpr* expr) {
     // Get the receiver object
-    expr->GetReceiver()->Accept(this);
-    llvm::Value* receiver = value_stack_.top();
-    value_stack_.pop();
+    llvm::Value* receiver = EmitExpr(expr->GetReceiver());
+    if (!receiver) {
+        return nullptr;
+    }
     
     // Get the method name (selector)
     std::string selector = expr->GetSelector();
@@ -1041,7 +1437,7 @@ void CodeGenerator::VisitMessageExpr(MessageExpr* expr) {
     
     if (!callee) {
         std::cerr << "Unknown method: " << selector << std::endl;
-        return;
+        return nullptr;
     }
     
     // Build the argument list, starting with the receiver
@@ -1050,30 +1446,27 @@ void CodeGenerator::VisitMessageExpr(MessageExpr* expr) {
     
     // Add the remaining arguments
     for (const auto& arg : expr->GetArgs()) {
-        arg->Accept(this);
-        args.push_back(value_stack_.top());
-        value_stack_.pop();
+        llvm::Value* value = EmitExpr(arg);
+        if (!value) {
+            return nullptr;
+        }
+        args.push_back(value);
     }
     
     // Call the function
-    llvm::Value* result = builder_->CreateCall(callee, args, "msgtmp");
-    
-    value_stack_.push(result);
+    return builder_->CreateCall(callee, args, "msgtmp");
 }
 
 /**
- * VisitSubscriptExpr - Visit a subscript expression node
+ * EmitSubscriptExpr - Emit code for a subscript
  */
-void CodeGenerator::VisitSubscriptExpr(SubscriptExpr* expr) {
-    // Visit the array/pointer
-    expr->GetArray()->Accept(this);
-    llvm::Value* array = value_stack_.top();
-    value_stack_.pop();
-    
-    // Visit the index
-    expr->GetIndex()->Accept(this);
-    llvm::Value* index = value_stack_.top();
-    value_stack_.pop();
+llvm::Value* CodeGenerator::EmitSubscriptExpr(SubscriptExpr* expr) {
+    // Evaluate the array/pointer and the index
+    llvm::Value* array = EmitExpr(expr->GetArray());
+    llvm::Value* index = EmitExpr(expr->GetIndex());
+    if (!array || !index) {
+        return nullptr;
+    }
     
     // Calculate the element address
     std::vector<llvm::Value*> indices;
@@ -1086,26 +1479,25 @@ void CodeGenerator::VisitSubscriptExpr(SubscriptExpr* expr) {
         "elemptr");
     
     // Load the element
-    llvm::Value* elem = builder_->CreateLoad(
+    return builder_->CreateLoad(
         ConvertType(expr->GetType()),
         elemPtr,
         "elem");
-    
-    value_stack_.push(elem);
 }
 
 /**
- * VisitCastExpr - Visit a cast expression node
+ * EmitCastExpr - Emit code for a cast
  */
-void CodeGenerator::VisitCastExpr(CastExpr* expr) {
-    // Visit the operand
-    expr->GetExpr()->Accept(this);
-    llvm::Value* operand = value_stack_.top();
-    value_stack_.pop();
+llvm::Value* CodeGenerator::EmitCastExpr(CastExpr* expr) {
+    // Evaluate the operand
+    llvm::Value* operand = EmitExpr(expr->GetExpr());
+    if (!operand) {
+        return nullptr;
+    }
     
     // Get the source and target types
-    std::shared_ptr<Type> src_type = expr->GetExpr()->GetType();
-    std::shared_ptr<Type> dst_type = expr->GetType();
+    Type* src_type = expr->GetExpr()->GetType();
+    Type* dst_type = expr->GetType();
     
     llvm::Value* result = nullptr;
     
@@ -1170,10 +1562,10 @@ void CodeGenerator::VisitCastExpr(CastExpr* expr) {
     } else {
         std::cerr << "Unsupported cast from " << std::to_string(static_cast<int>(src_type->GetKind())) 
                   << " to " << std::to_string(static_cast<int>(dst_type->GetKind())) << std::endl;
-        return;
+        return nullptr;
     }
     
-    value_stack_.push(result);
+    return result;
 }
 
 //===----------------------------------------------------------------------===//
@@ -1184,11 +1576,8 @@ void CodeGenerator::VisitCastExpr(CastExpr* expr) {
  * VisitExprStmt - Visit an expression statement node
  */
 void CodeGenerator::VisitExprStmt(ExprStmt* stmt) {
-    // Visit the expression
-    stmt->GetExpr()->Accept(this);
-    
-    // Pop the result, we don't need it
-    value_stack_.pop();
+    // Evaluate the expression for its side effects
+    EmitExpr(stmt->GetExpr());
 }
 
 /**
@@ -1211,10 +1600,11 @@ void CodeGenerator::VisitBlockStmt(BlockStmt* stmt) {
  * VisitIfStmt - Visit an if statement node
  */
 void CodeGenerator::VisitIfStmt(IfStmt* stmt) {
-    // Visit the condition
-    stmt->GetCond()->Accept(this);
-    llvm::Value* cond_val = value_stack_.top();
-    value_stack_.pop();
+    // Evaluate the condition
+    llvm::Value* cond_val = EmitExpr(stmt->GetCond());
+    if (!cond_val) {
+        return;
+    }
     
     // Convert condition to a boolean value
     llvm::Value* cond_bool = ConvertToBoolean(cond_val);
@@ -1282,15 +1672,12 @@ void CodeGenerator::VisitWhileStmt(WhileStmt* stmt) {
     
     // Emit the condition block
     builder_->SetInsertPoint(cond_bb);
-    stmt->GetCond()->Accept(this);
-    llvm::Value* cond_val = value_stack_.top();
-    value_stack_.pop();
-    
-    // Convert condition to a boolean value
-    llvm::Value* cond_bool = ConvertToBoolean(cond_val);
+    llvm::Value* cond_val = EmitExpr(stmt->GetCond());
     
     // Branch to the body if condition is true, otherwise to the end
-    builder_->CreateCondBr(cond_bool, body_bb, end_bb);
+    if (cond_val) {
+        builder_->CreateCondBr(ConvertToBoolean(cond_val), body_bb, end_bb);
+    }
     
     // Emit the body block
     body_bb->insertInto(func);
@@ -1345,15 +1732,10 @@ void CodeGenerator::VisitForStmt(ForStmt* stmt) {
     // Emit the condition block
     builder_->SetInsertPoint(cond_bb);
     if (stmt->GetCond()) {
-        stmt->GetCond()->Accept(this);
-        llvm::Value* cond_val = value_stack_.top();
-        value_stack_.pop();
-        
-        // Convert condition to a boolean value
-        llvm::Value* cond_bool = ConvertToBoolean(cond_val);
-        
         // Branch to the body if condition is true, otherwise to the end
-        builder_->CreateCondBr(cond_bool, body_bb, end_bb);
+        if (llvm::Value* cond_val = EmitExpr(stmt->GetCond())) {
+            builder_->CreateCondBr(ConvertToBoolean(cond_val), body_bb, end_bb);
+        }
     } else {
         // No condition, always branch to the body
         builder_->CreateBr(body_bb);
@@ -1373,8 +1755,7 @@ void CodeGenerator::VisitForStmt(ForStmt* stmt) {
     inc_bb->insertInto(func);
     builder_->SetInsertPoint(inc_bb);
     if (stmt->GetInc()) {
-        stmt->GetInc()->Accept(this);
-        value_stack_.pop(); // Pop the result, we don't need it
+        EmitExpr(stmt->GetInc());
     }
     
     // Branch back to the condition block
@@ -1427,11 +1808,9 @@ void CodeGenerator::VisitReturnStmt(ReturnStmt* stmt) {
     
     if (stmt->GetExpr()) {
         // Return value
-        stmt->GetExpr()->Accept(this);
-        llvm::Value* ret_val = value_stack_.top();
-        value_stack_.pop();
-        
-        builder_->CreateRet(ret_val);
+        if (llvm::Value* ret_val = EmitExpr(stmt->GetExpr())) {
+            builder_->CreateRet(ret_val);
+        }
     } else {
         // Void return
         builder_->CreateRetVoid();
@@ -1450,12 +1829,23 @@ void CodeGenerator::VisitDeclStmt(DeclStmt* stmt) {
 // ASTVisitor implementation - Declarations
 //===----------------------------------------------------------------------===//
 
+/**
+ * VisitCompilationUnit - Visit every top-level declaration
+ */
+void CodeGenerator::VisitCompilationUnit(CompilationUnit* unit) {
+    for (const auto& decl : unit->GetDecls()) {
+        // One -ftime-trace span per declaration shows which ones are slow
+        llvm::TimeTraceScope scope("Declaration", [&] { return decl->GetName(); });
+        decl->Accept(this);
+    }
+}
+
 /**
  * VisitVarDecl - Visit a variable declaration node
  */
 void CodeGenerator::VisitVarDecl(VarDecl* decl) {
     const std::string& name = decl->GetName();
-    std::shared_ptr<Type> type = decl->GetType();
+    Type* type = decl->GetType();
     
     // Create an alloca for the variable
     llvm::Function* func = builder_->GetInsertBlock()->getParent();
@@ -1467,16 +1857,14 @@ void CodeGenerator::VisitVarDecl(VarDecl* decl) {
         name.c_str());
     
     // Add the variable to the symbol table
-    named_values_[name] = alloca;
-    scopes_.back().values[name] = alloca;
+    named_values_[decl->GetSymbol()] = alloca;
+    scopes_.back().values[decl->GetSymbol()] = alloca;
     
     // Initialize the variable if an initializer is provided
     if (decl->GetInit()) {
-        decl->GetInit()->Accept(this);
-        llvm::Value* init_val = value_stack_.top();
-        value_stack_.pop();
-        
-        builder_->CreateStore(init_val, alloca);
+        if (llvm::Value* init_val = EmitExpr(decl->GetInit())) {
+            builder_->CreateStore(init_val, alloca);
+        }
     }
 }
 
@@ -1492,7 +1880,7 @@ void CodeGenerator::VisitParamDecl(ParamDecl* decl) {
  */
 void CodeGenerator::VisitFuncDecl(FuncDecl* decl) {
     const std::string& name = decl->GetName();
-    std::shared_ptr<FunctionType> func_type = std::static_pointer_cast<FunctionType>(decl->GetType());
+    FunctionType* func_type = static_cast<FunctionType*>(decl->GetType());
     
     // Get the return type and parameter types
     llvm::Type* return_type = ConvertType(func_type->GetReturnType());
@@ -1516,7 +1904,7 @@ void CodeGenerator::VisitFuncDecl(FuncDecl* decl) {
         module_.get());
     
     // Add the function to the function table
-    function_table_[name] = func;
+    function_table_[decl->GetSymbol()] = func;
     
     // Set parameter names
     unsigned idx = 0;
@@ -1524,11 +1912,15 @@ void CodeGenerator::VisitFuncDecl(FuncDecl* decl) {
         param.setName(decl->GetParams()[idx++]->GetName());
     }
     
-    // If this is a declaration without a body, we're done
-    if (!decl->GetBody()) {
+    // If this is a declaration without a body, another shard generates
+    // the body, or the body is cached, we're done
+    if (!decl->GetBody() || !TakeDefinition() || ReuseDefinition(name)) {
         return;
     }
     
+    // Time this function's share of IR generation
+    ScopedTimer timer(time_report_, name, "function");
+    
     // Create a new basic block to start insertion into
     llvm::BasicBlock* bb = llvm::BasicBlock::Create(*context_, "entry", func);
     builder_->SetInsertPoint(bb);
@@ -1552,8 +1944,9 @@ void CodeGenerator::VisitFuncDecl(FuncDecl* decl) {
         builder_->CreateStore(&param, alloca);
         
         // Add the variable to the symbol table
-        named_values_[param.getName().str()] = alloca;
-        scopes_.back().values[param.getName().str()] = alloca;
+        Symbol param_name = decl->GetParams()[param.getArgNo()]->GetSymbol();
+        named_values_[param_name] = alloca;
+        scopes_.back().values[param_name] = alloca;
     }
     
     // Generate code for the function body
@@ -1602,7 +1995,7 @@ void CodeGenerator::VisitFuncDecl(FuncDecl* decl) {
  */
 void CodeGenerator::VisitMethodDecl(MethodDecl* decl) {
     const std::string& name = decl->GetName();
-    std::shared_ptr<FunctionType> func_type = std::static_pointer_cast<FunctionType>(decl->GetType());
+    FunctionType* func_type = static_cast<FunctionType*>(decl->GetType());
     
     // Transform the method name based on the Objective-C style syntax
     // For example, foo:bar: -> foo_bar
@@ -1636,7 +2029,7 @@ void CodeGenerator::VisitMethodDecl(MethodDecl* decl) {
         module_.get());
     
     // Add the function to the function table
-    function_table_[transformed_name] = func;
+    function_table_[Symbol::Intern(transformed_name)] = func;
     
     // Set parameter names
     auto arg_it = func->arg_begin();
@@ -1651,11 +2044,15 @@ void CodeGenerator::VisitMethodDecl(MethodDecl* decl) {
         arg_it->setName(decl->GetParams()[idx]->GetName());
     }
     
-    // If this is a declaration without a body, we're done
-    if (!decl->GetBody()) {
+    // If this is a declaration without a body, another shard generates
+    // the body, or the body is cached, we're done
+    if (!decl->GetBody() || !TakeDefinition() || ReuseDefinition(transformed_name)) {
         return;
     }
     
+    // Time this method's share of IR generation
+    ScopedTimer timer(time_report_, transformed_name, "function");
+    
     // Create a new basic block to start insertion into
     llvm::BasicBlock* bb = llvm::BasicBlock::Create(*context_, "entry", func);
     builder_->SetInsertPoint(bb);
@@ -1678,9 +2075,12 @@ void CodeGenerator::VisitMethodDecl(MethodDecl* decl) {
         // Store the parameter value
         builder_->CreateStore(&param, alloca);
         
-        // Add the variable to the symbol table
-        named_values_[param.getName().str()] = alloca;
-        scopes_.back().values[param.getName().str()] = alloca;
+        // Add the variable to the symbol table; argument 0 is the receiver
+        Symbol param_name = param.getArgNo() == 0
+            ? Symbol::Intern("self")
+            : decl->GetParams()[param.getArgNo() - 1]->GetSymbol();
+        named_values_[param_name] = alloca;
+        scopes_.back().values[param_name] = alloca;
     }
     
     // Generate code for the function body
@@ -1728,52 +2128,21 @@ void CodeGenerator::VisitMethodDecl(MethodDecl* decl) {
  * VisitStructDecl - Visit a struct declaration node
  */
 void CodeGenerator::VisitStructDecl(StructDecl* decl) {
-    const std::string& name = decl->GetName();
-    std::vector<std::shared_ptr<Type>> field_types;
-    
-    // Get the field types
-    for (const auto& field : decl->GetFields()) {
-        field_types.push_back(field->GetType());
-    }
-    
-    // Create a struct type in LLVM IR
-    std::vector<llvm::Type*> llvm_field_types;
-    for (const auto& field_type : field_types) {
-        llvm_field_types.push_back(ConvertType(field_type));
-    }
-    
-    llvm::StructType* struct_type = llvm::StructType::create(
-        *context_,
-        llvm_field_types,
-        name);
-    
-    // Add the struct type to the struct types table
-    struct_types_[name] = struct_type;
+    // The type holds the fields, so converting it creates the LLVM struct
+    ConvertType(decl->GetType());
 }
 
 /**
  * VisitEnumDecl - Visit an enum declaration node
  */
 void CodeGenerator::VisitEnumDecl(EnumDecl* decl) {
-    const std::string& name = decl->GetName();
-    
-    // Get the enum's base type (e.g., int)
+    // Nothing is emitted: every use of an enumerator folds to its value, so
+    // comparisons against enumerators stay immediate compares that
+    // SimplifyCFG can turn into switches and jump tables
     llvm::Type* base_type = ConvertType(decl->GetBaseType());
-    
-    // Define each enum value as a constant
     for (const auto& enum_val : decl->GetValues()) {
-        llvm::Constant* value = llvm::ConstantInt::get(
-            base_type,
-            enum_val.second);
-        
-        // Create a global constant for the enum value
-        new llvm::GlobalVariable(
-            *module_,
-            base_type,
-            true, // is constant
-            llvm::GlobalValue::InternalLinkage,
-            value,
-            name + "::" + enum_val.first);
+        enum_constants_[Symbol::Intern(enum_val.first)] =
+            llvm::ConstantInt::get(base_type, static_cast<uint64_t>(enum_val.second), true);
     }
 }
 
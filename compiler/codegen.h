@@ -12,10 +12,10 @@
 #include <memory>
 #include <unordered_map>
 #include <vector>
-#include <stack>
 #include <optional>
 
 // LLVM headers
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
 #include <llvm/IR/Module.h>
 #include <llvm/IR/Function.h>
 #include <llvm/IR/Type.h>
@@ -32,10 +32,14 @@
 #include <llvm/Target/TargetOptions.h>
 #include <llvm/MC/TargetRegistry.h>
 #include "ast.h"
+#include "backend.h"
+#include "timing.h"
 #include "type.h"
 
 namespace dsLang {
 
+class CompileCache;
+
 /**
  * CodeGenError - Error reporting for code generation errors
  * 
@@ -73,13 +77,54 @@ class CodeGenerator : public ASTVisitor {
 public:
     /**
      * Constructor - Initialize the code generator
+     * 
+     * @param module_name The name of the generated module
+     * @param target_triple The target to generate code for
+     * @param opt_level The optimization level (0-3) for the IR pipeline and
+     *        the backend
      */
-    CodeGenerator(const std::string& module_name, const std::string& target_triple);
+    CodeGenerator(const std::string& module_name, const std::string& target_triple,
+                  unsigned opt_level = 0);
     
     /**
      * Generate - Generate code for a compilation unit
+     * 
+     * The module is verified and then optimized at the generator's level.
+     * 
+     * @return True if the generated module passed verification
+     */
+    bool Generate(CompilationUnit* unit);
+    
+    /**
+     * SetShard - Restrict code generation to one shard of the functions
+     * 
+     * Function definitions are numbered in declaration order and dealt
+     * round-robin to shard_count shards. Every shard declares every
+     * function, but only bodies dealt to shard_index are generated, so the
+     * shards' objects link together into the whole program. Call before
+     * Generate.
      */
-    void Generate(CompilationUnit* unit);
+    void SetShard(unsigned shard_index, unsigned shard_count);
+    
+    /**
+     * SetFunctionCache - Reuse the optimized code of unchanged functions
+     * 
+     * Every function definition is fingerprinted (see fingerprint.h).
+     * Bodies whose fingerprint has a cache entry are neither generated nor
+     * optimized: their cached bitcode is linked into the module after the
+     * fresh bodies are optimized, and the fresh bodies are added to the
+     * cache. Call before Generate.
+     */
+    void SetFunctionCache(CompileCache* cache);
+    
+    /**
+     * SetTimeReport - Record phase, per-function and pass timings
+     * 
+     * Generate records IR generation (and each function's share of it),
+     * optimization with its passes, and function cache work; EmitObject
+     * and EmitAssembly record emission.
+     */
+    void SetTimeReport(TimeReport* report);
     
     /**
      * EmitIR - Emit LLVM IR to the specified file
@@ -88,19 +133,38 @@ public:
     
     /**
      * EmitObject - Emit object code to the specified file
+     * 
+     * @return True if the file was written
      */
-    void EmitObject(const std::string& filename);
+    bool EmitObject(const std::string& filename);
+    
+    /**
+     * EmitAssembly - Emit assembly code to the specified file
+     * 
+     * @return True if the file was written
+     */
+    bool EmitAssembly(const std::string& filename);
+    
+    /**
+     * TakeModule - Hand the generated module and its context to a JIT
+     * 
+     * Nothing can be generated or emitted afterwards.
+     */
+    llvm::orc::ThreadSafeModule TakeModule();
     
     // ASTVisitor implementation
-    void VisitBinaryExpr(BinaryExpr* expr) override;
-    void VisitUnaryExpr(UnaryExpr* expr) override;
-    void VisitLiteralExpr(LiteralExpr* expr) override;
-    void VisitVarExpr(VarExpr* expr) override;
-    void VisitAssignExpr(AssignExpr* expr) override;
-    void VisitCallExpr(CallExpr* expr) override;
-    void VisitMessageExpr(MessageExpr* expr) override;
-    void VisitSubscriptExpr(SubscriptExpr* expr) override;
-    void VisitCastExpr(CastExpr* expr) override;
+    void VisitCompilationUnit(CompilationUnit* unit) override;
+    
+    // Expressions are emitted by EmitExpr; visiting one evaluates it for its side effects
+    void VisitBinaryExpr(BinaryExpr* expr) override { EmitExpr(expr); }
+    void VisitUnaryExpr(UnaryExpr* expr) override { EmitExpr(expr); }
+    void VisitLiteralExpr(LiteralExpr* expr) override { EmitExpr(expr); }
+    void VisitVarExpr(VarExpr* expr) override { EmitExpr(expr); }
+    void VisitAssignExpr(AssignExpr* expr) override { EmitExpr(expr); }
+    void VisitCallExpr(CallExpr* expr) override { EmitExpr(expr); }
+    void VisitMessageExpr(MessageExpr* expr) override { EmitExpr(expr); }
+    void VisitSubscriptExpr(SubscriptExpr* expr) override { EmitExpr(expr); }
+    void VisitCastExpr(CastExpr* expr) override { EmitExpr(expr); }
     
     void VisitExprStmt(ExprStmt* stmt) override;
     void VisitBlockStmt(BlockStmt* stmt) override;
@@ -124,23 +188,29 @@ private:
     std::unique_ptr<llvm::LLVMContext> context_;
     std::unique_ptr<llvm::Module> module_;
     std::unique_ptr<llvm::IRBuilder<>> builder_;
-    std::unique_ptr<llvm::TargetMachine> target_machine_;
+    TargetMachineLease target_machine_;
     std::string target_triple_;
+    unsigned opt_level_;
     
     // Current function being generated
     llvm::Function* current_function_;
     
     // Symbol table for variable and function lookups
-    std::unordered_map<std::string, llvm::Value*> named_values_;
-    std::unordered_map<std::string, llvm::Function*> function_table_;
-    std::unordered_map<std::string, llvm::StructType*> struct_types_;
+    std::unordered_map<Symbol, llvm::Value*> named_values_;
+    std::unordered_map<Symbol, llvm::Function*> function_table_;
     
-    // Value stack for expression evaluation
-    std::stack<llvm::Value*> value_stack_;
+    // LLVM type of every dsLang type converted so far
+    std::unordered_map<const Type*, llvm::Type*> llvm_types_;
+    
+    // String literals, one constant per distinct content
+    std::unordered_map<std::string, llvm::GlobalVariable*> string_literals_;
+    
+    // Enumerators, used as immediates rather than loaded
+    std::unordered_map<Symbol, llvm::Constant*> enum_constants_;
     
     // Scope management for variable declarations
     struct Scope {
-        std::unordered_map<std::string, llvm::Value*> values;
+        std::unordered_map<Symbol, llvm::Value*> values;
     };
     std::vector<Scope> scopes_;
     
@@ -148,8 +218,74 @@ private:
     llvm::BasicBlock* break_target_ = nullptr;
     llvm::BasicBlock* continue_target_ = nullptr;
     
+    // Function sharding for parallel code generation
+    unsigned shard_index_ = 0;
+    unsigned shard_count_ = 1;
+    unsigned definition_count_ = 0;
+    
+    // Per-function code caching
+    CompileCache* function_cache_ = nullptr;
+    std::unordered_map<std::string, std::string> function_keys_;    // Cache keys by function name
+    std::vector<std::string> cached_definitions_;                   // Bitcode of reused bodies
+    std::vector<std::string> fresh_definitions_;                    // Names of bodies generated here
+    std::vector<std::string> inlinable_definitions_;                // Names of reused bodies linked for inlining
+    
+    // Instrumentation for -ftime-report; null when not timing
+    TimeReport* time_report_ = nullptr;
+    
     // Helper functions
     
+    /**
+     * EmitFile - Run the target's code generation passes into a file
+     */
+    bool EmitFile(const std::string& filename, llvm::CodeGenFileType file_type);
+    
+    /**
+     * TakeDefinition - Number the next function definition
+     * 
+     * @return True if this shard should generate its body
+     */
+    bool TakeDefinition();
+    
+    /**
+     * ReuseDefinition - Look up a function's body in the function cache
+     * 
+     * @return True if the cached body will be linked in instead
+     */
+    bool ReuseDefinition(const std::string& name);
+    
+    /**
+     * CacheFreshDefinitions - Add each optimized fresh body to the cache
+     */
+    void CacheFreshDefinitions();
+    
+    /**
+     * ReadCachedDefinition - Read the module of a reused body
+     * 
+     * @return The module, or null (after reporting why) if it is damaged
+     */
+    std::unique_ptr<llvm::Module> ReadCachedDefinition(const std::string& bitcode);
+    
+    /**
+     * LinkInlinableDefinitions - Link copies of the reused bodies for the
+     * optimizer to inline
+     * 
+     * @return True if every body was read and linked
+     */
+    bool LinkInlinableDefinitions();
+    
+    /**
+     * DropInlinableDefinitions - Turn the inlinable copies back into declarations
+     */
+    void DropInlinableDefinitions();
+    
+    /**
+     * LinkCachedDefinitions - Link the reused bodies into the module
+     * 
+     * @return True if every body was read and linked
+     */
+    bool LinkCachedDefinitions();
+    
     /**
      * DeclareRuntimeFunctions - Declare runtime functions used by the standard library
      */
@@ -167,14 +303,85 @@ private:
     
     /**
      * ConvertType - Convert a dsLang type to an LLVM type
+     *
+     * Types are uniqued by the TypeContext, so each one is converted once
+     * and then found by address.
+     */
+    llvm::Type* ConvertType(Type* type);
+    
+    /**
+     * BuildType - Build the LLVM type for a dsLang type not yet converted
      */
-    llvm::Type* ConvertType(const std::shared_ptr<Type>& type);
+    llvm::Type* BuildType(Type* type);
     
     /**
      * ConvertToBoolean - Convert a value to a boolean
      */
     llvm::Value* ConvertToBoolean(llvm::Value* value);
     
+    /**
+     * GetStringLiteral - Get the pooled constant holding a string literal
+     */
+    llvm::GlobalVariable* GetStringLiteral(const std::string& str);
+    
+    /**
+     * ShareStringSuffixes - Point literals that end another literal into it
+     */
+    void ShareStringSuffixes();
+    
+    /**
+     * EmitExpr - Emit code for an expression
+     *
+     * @return The value of the expression, or nullptr if it could not be
+     *         emitted (the error has been reported)
+     */
+    llvm::Value* EmitExpr(Expr* expr);
+    
+    /**
+     * EmitBinaryExpr - Emit code for a binary expression
+     */
+    llvm::Value* EmitBinaryExpr(BinaryExpr* expr);
+    
+    /**
+     * EmitUnaryExpr - Emit code for a unary expression
+     */
+    llvm::Value* EmitUnaryExpr(UnaryExpr* expr);
+    
+    /**
+     * EmitLiteralExpr - Emit code for a literal
+     */
+    llvm::Value* EmitLiteralExpr(LiteralExpr* expr);
+    
+    /**
+     * EmitVarExpr - Emit code for a variable reference
+     */
+    llvm::Value* EmitVarExpr(VarExpr* expr);
+    
+    /**
+     * EmitAssignExpr - Emit code for an assignment
+     */
+    llvm::Value* EmitAssignExpr(AssignExpr* expr);
+    
+    /**
+     * EmitCallExpr - Emit code for a function call
+     */
+    llvm::Value* EmitCallExpr(CallExpr* expr);
+    
+    /**
+     * EmitMessageExpr - Emit code for an Objective-C style message
+     */
+    llvm::Value* EmitMessageExpr(MessageExpr* expr);
+    
+    /**
+     * EmitSubscriptExpr - Emit code for a subscript
+     */
+    llvm::Value* EmitSubscriptExpr(SubscriptExpr* expr);
+    
+    /**
+     * EmitCastExpr - Emit code for a cast
+     */
+    llvm::Value* EmitCastExpr(CastExpr* expr);
+    
     /**
      * GetLValue - Get the address of an expression for assignment
      */
@@ -183,12 +390,12 @@ private:
     /**
      * EmitLogicalAnd - Emit code for short-circuit logical AND
      */
-    llvm::Value* EmitLogicalAnd(llvm::Value* lhs, llvm::Value* rhs);
+    llvm::Value* EmitLogicalAnd(Expr* lhs, Expr* rhs);
     
     /**
      * EmitLogicalOr - Emit code for short-circuit logical OR
      */
-    llvm::Value* EmitLogicalOr(llvm::Value* lhs, llvm::Value* rhs);
+    llvm::Value* EmitLogicalOr(Expr* lhs, Expr* rhs);
     
     /**
      * EmitPreIncrement - Emit code for pre-increment (++x)
@@ -213,22 +420,22 @@ private:
     /**
      * IsFloatingPointType - Check if a type is a floating point type
      */
-    bool IsFloatingPointType(const std::shared_ptr<Type>& type);
+    bool IsFloatingPointType(Type* type);
     
     /**
      * IsUnsignedType - Check if a type is an unsigned integer type
      */
-    bool IsUnsignedType(const std::shared_ptr<Type>& type);
+    bool IsUnsignedType(Type* type);
     
     /**
      * IsIntegerType - Check if a type is an integer type
      */
-    bool IsIntegerType(const std::shared_ptr<Type>& type);
+    bool IsIntegerType(Type* type);
     
     /**
      * GetTypeSize - Get the size of a type in bits
      */
-    unsigned GetTypeSize(const std::shared_ptr<Type>& type);
+    unsigned GetTypeSize(Type* type);
 };
 
 } // namespace dsLang
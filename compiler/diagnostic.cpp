@@ -6,6 +6,7 @@
  */
 
 #include "diagnostic.h"
+#include <mutex>
 #include <sstream>
 
 namespace dsLang {
@@ -49,8 +50,16 @@ void DiagnosticReporter::Report(Diagnostic::Level level, const std::string& mess
         warning_count_++;
     }
     
-    // Immediately print the diagnostic to stderr
-    std::cerr << diagnostics_.back().ToString() << std::endl;
+    if (!echo_) {
+        return;
+    }
+    
+    // Immediately print the diagnostic to stderr; reporters on other
+    // compile threads share the stream, so keep each line whole
+    static std::mutex output_mutex;
+    std::string text = diagnostics_.back().ToString();
+    std::lock_guard<std::mutex> lock(output_mutex);
+    std::cerr << text << std::endl;
 }
 
 /**
@@ -70,7 +79,7 @@ void DiagnosticReporter::ReportError(const std::string& message, const Token& to
     
     // If the token has some lexeme text, show it in the error
     if (!token.GetLexeme().empty()) {
-        std::string token_text = "'" + token.GetLexeme() + "'";
+        std::string token_text = "'" + std::string(token.GetLexeme()) + "'";
         Report(Diagnostic::Level::NOTE, "token text: " + token_text, 
                filename, token.GetLine(), token.GetColumn());
     }
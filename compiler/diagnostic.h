@@ -97,8 +97,11 @@ class DiagnosticReporter {
 public:
     /**
      * Constructor
+     * 
+     * @param echo Print each diagnostic to stderr as it is reported
      */
-    DiagnosticReporter() : error_count_(0), warning_count_(0) {}
+    explicit DiagnosticReporter(bool echo = true)
+        : error_count_(0), warning_count_(0), echo_(echo) {}
     
     /**
      * Report - Report a diagnostic
@@ -191,6 +194,7 @@ private:
     std::vector<Diagnostic> diagnostics_;
     unsigned error_count_;
     unsigned warning_count_;
+    bool echo_;
 };
 
 } // namespace dsLang
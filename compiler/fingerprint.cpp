@@ -0,0 +1,426 @@
+/**
+ * fingerprint.cpp - Function Fingerprints Implementation for dsLang
+ *
+ * This file implements ComputeFunctionFingerprints by serializing each
+ * function's signature and body into bytes and hashing them.
+ */
+
+#include "fingerprint.h"
+#include "type.h"
+#include <llvm/ADT/StringRef.h>
+#include <llvm/Support/SHA256.h>
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <unordered_set>
+#include <vector>
+
+namespace dsLang {
+
+namespace {
+
+/**
+ * Digest - Hash serialized bytes down to a fixed-size string
+ */
+std::string Digest(const std::string& bytes) {
+    llvm::SHA256 sha;
+    sha.update(llvm::StringRef(bytes));
+    std::string digest;
+    for (auto byte : sha.final()) {
+        digest.push_back(static_cast<char>(byte));
+    }
+    return digest;
+}
+
+/**
+ * AppendField - Append a length-prefixed field
+ */
+void AppendField(std::string& out, std::string_view field) {
+    uint32_t size = static_cast<uint32_t>(field.size());
+    out.append(reinterpret_cast<const char*>(&size), sizeof(size));
+    out.append(field.data(), field.size());
+}
+
+/**
+ * MethodFunctionName - Get the LLVM function name for a selector
+ *
+ * Mirrors the code generator: foo:bar: becomes foo_bar_.
+ */
+std::string MethodFunctionName(std::string selector) {
+    std::replace(selector.begin(), selector.end(), ':', '_');
+    return selector;
+}
+
+/**
+ * FingerprintWriter - Serializes each function of a unit
+ *
+ * Every node writes a tag byte followed by the fields that affect code
+ * generation, so two bodies serialize alike only if they generate alike.
+ */
+class FingerprintWriter : public ASTVisitor {
+public:
+    /**
+     * Function - What the writer learned about one LLVM function
+     */
+    struct Function {
+        std::string signature;              // Digest of the signature
+        std::string definition;             // Digest of signature and body
+        std::set<std::string> callees;      // Functions the body calls
+        unsigned definitions = 0;           // Number of bodies seen
+    };
+
+    const std::unordered_map<std::string, Function>& GetFunctions() const { return functions_; }
+
+    void VisitCompilationUnit(CompilationUnit* unit) override {
+        for (const auto& decl : unit->GetDecls()) {
+            decl->Accept(this);
+        }
+    }
+
+    void VisitFuncDecl(FuncDecl* decl) override {
+        BeginFunction();
+        WriteTag('F');
+        WriteString(decl->GetName());
+        WriteType(decl->GetType());
+        for (const auto& param : decl->GetParams()) {
+            WriteString(param->GetName());
+        }
+        EndFunction(decl->GetName(), decl->GetBody());
+    }
+
+    void VisitMethodDecl(MethodDecl* decl) override {
+        BeginFunction();
+        WriteTag('M');
+        WriteString(decl->GetName());
+        WriteType(decl->GetReceiverType());
+        WriteType(decl->GetType());
+        for (const auto& param : decl->GetParams()) {
+            WriteString(param->GetName());
+        }
+        EndFunction(MethodFunctionName(decl->GetName()), decl->GetBody());
+    }
+
+    // Types are written in full wherever they are used
+    void VisitStructDecl(StructDecl*) override {}
+
+    // Enumerators fold into the code that uses them, so their values are
+    // written at each use
+    void VisitEnumDecl(EnumDecl* decl) override {
+        for (const auto& value : decl->GetValues()) {
+            enumerators_[value.first] = value.second;
+        }
+    }
+
+    void VisitBinaryExpr(BinaryExpr* expr) override {
+        WriteTag('b');
+        WriteInt(static_cast<int64_t>(expr->GetOp()));
+        WriteType(expr->GetType());
+        WriteNode(expr->GetLeft());
+        WriteNode(expr->GetRight());
+    }
+
+    void VisitUnaryExpr(UnaryExpr* expr) override {
+        WriteTag('u');
+        WriteInt(static_cast<int64_t>(expr->GetOp()));
+        WriteType(expr->GetType());
+        WriteNode(expr->GetOperand());
+    }
+
+    void VisitLiteralExpr(LiteralExpr* expr) override {
+        WriteTag('l');
+        WriteInt(static_cast<int64_t>(expr->GetLiteralKind()));
+        WriteType(expr->GetType());
+        switch (expr->GetLiteralKind()) {
+            case LiteralExpr::Kind::BOOL:
+                WriteInt(expr->GetBoolValue());
+                break;
+            case LiteralExpr::Kind::INT:
+                WriteInt(expr->GetIntValue());
+                break;
+            case LiteralExpr::Kind::FLOAT: {
+                double value = expr->GetFloatValue();
+                int64_t bits;
+                std::memcpy(&bits, &value, sizeof(bits));
+                WriteInt(bits);
+                break;
+            }
+            case LiteralExpr::Kind::CHAR:
+                WriteInt(expr->GetCharValue());
+                break;
+            case LiteralExpr::Kind::STRING:
+                WriteString(expr->GetStringValue());
+                break;
+            case LiteralExpr::Kind::NULL_PTR:
+                break;
+        }
+    }
+
+    void VisitVarExpr(VarExpr* expr) override {
+        WriteTag('v');
+        WriteString(expr->GetName());
+        WriteType(expr->GetType());
+        auto enumerator = enumerators_.find(expr->GetName());
+        if (enumerator != enumerators_.end()) {
+            WriteInt(enumerator->second);
+        }
+    }
+
+    void VisitAssignExpr(AssignExpr* expr) override {
+        WriteTag('=');
+        WriteType(expr->GetType());
+        WriteNode(expr->GetTarget());
+        WriteNode(expr->GetValue());
+    }
+
+    void VisitCallExpr(CallExpr* expr) override {
+        WriteTag('c');
+        WriteString(expr->GetCallee());
+        WriteType(expr->GetType());
+        for (const auto& arg : expr->GetArgs()) {
+            WriteNode(arg);
+        }
+        WriteTag(')');
+        callees_.insert(expr->GetCallee());
+    }
+
+    void VisitMessageExpr(MessageExpr* expr) override {
+        WriteTag('m');
+        WriteString(expr->GetSelector());
+        WriteType(expr->GetType());
+        WriteNode(expr->GetReceiver());
+        for (const auto& arg : expr->GetArgs()) {
+            WriteNode(arg);
+        }
+        WriteTag(']');
+        callees_.insert(MethodFunctionName(expr->GetSelector()));
+    }
+
+    void VisitSubscriptExpr(SubscriptExpr* expr) override {
+        WriteTag('[');
+        WriteType(expr->GetType());
+        WriteNode(expr->GetArray());
+        WriteNode(expr->GetIndex());
+    }
+
+    void VisitCastExpr(CastExpr* expr) override {
+        WriteTag('(');
+        WriteType(expr->GetType());
+        WriteNode(expr->GetExpr());
+    }
+
+    void VisitExprStmt(ExprStmt* stmt) override {
+        WriteTag(';');
+        WriteNode(stmt->GetExpr());
+    }
+
+    void VisitBlockStmt(BlockStmt* stmt) override {
+        WriteTag('{');
+        for (const auto& child : stmt->GetStmts()) {
+            WriteNode(child);
+        }
+        WriteTag('}');
+    }
+
+    void VisitIfStmt(IfStmt* stmt) override {
+        WriteTag('i');
+        WriteNode(stmt->GetCond());
+        WriteNode(stmt->GetThen());
+        WriteNode(stmt->GetElse());
+    }
+
+    void VisitWhileStmt(WhileStmt* stmt) override {
+        WriteTag('w');
+        WriteNode(stmt->GetCond());
+        WriteNode(stmt->GetBody());
+    }
+
+    void VisitForStmt(ForStmt* stmt) override {
+        WriteTag('f');
+        WriteNode(stmt->GetInit());
+        WriteNode(stmt->GetCond());
+        WriteNode(stmt->GetInc());
+        WriteNode(stmt->GetBody());
+    }
+
+    void VisitBreakStmt(BreakStmt*) override { WriteTag('k'); }
+
+    void VisitContinueStmt(ContinueStmt*) override { WriteTag('n'); }
+
+    void VisitReturnStmt(ReturnStmt* stmt) override {
+        WriteTag('r');
+        WriteNode(stmt->GetExpr());
+    }
+
+    void VisitDeclStmt(DeclStmt* stmt) override {
+        WriteTag('d');
+        WriteNode(stmt->GetDecl());
+    }
+
+    void VisitVarDecl(VarDecl* decl) override {
+        WriteTag('V');
+        WriteString(decl->GetName());
+        WriteType(decl->GetType());
+        WriteNode(decl->GetInit());
+    }
+
+    void VisitParamDecl(ParamDecl* decl) override {
+        WriteTag('P');
+        WriteString(decl->GetName());
+        WriteType(decl->GetType());
+    }
+
+private:
+    void BeginFunction() {
+        bytes_.clear();
+        callees_.clear();
+        written_structs_.clear();
+    }
+
+    void EndFunction(const std::string& name, Stmt* body) {
+        Function& function = functions_[name];
+        function.signature = Digest(bytes_);
+        if (body) {
+            WriteNode(body);
+            function.definition = Digest(bytes_);
+            function.callees = std::move(callees_);
+            function.definitions++;
+        }
+    }
+
+    void WriteTag(char tag) { bytes_.push_back(tag); }
+
+    void WriteInt(int64_t value) { bytes_.append(reinterpret_cast<const char*>(&value), sizeof(value)); }
+
+    void WriteString(std::string_view text) { AppendField(bytes_, text); }
+
+    void WriteNode(Node* node) {
+        if (!node) {
+            WriteTag('0');
+            return;
+        }
+        node->Accept(this);
+    }
+
+    void WriteType(Type* type) {
+        if (!type) {
+            WriteTag('0');
+            return;
+        }
+        WriteInt(static_cast<int64_t>(type->GetKind()));
+
+        switch (type->GetKind()) {
+            case Type::Kind::POINTER:
+                WriteType(static_cast<PointerType*>(type)->GetPointeeType());
+                break;
+            case Type::Kind::ARRAY: {
+                auto array_type = static_cast<ArrayType*>(type);
+                WriteInt(static_cast<int64_t>(array_type->GetNumElements()));
+                WriteType(array_type->GetElementType());
+                break;
+            }
+            case Type::Kind::STRUCT: {
+                // Write each layout once; later uses (and recursion) refer
+                // back to it by name
+                auto struct_type = static_cast<StructType*>(type);
+                WriteString(struct_type->GetName());
+                if (written_structs_.insert(struct_type).second) {
+                    WriteInt(static_cast<int64_t>(struct_type->GetFields().size()));
+                    for (const auto& field : struct_type->GetFields()) {
+                        WriteString(field.first);
+                        WriteType(field.second);
+                    }
+                }
+                break;
+            }
+            case Type::Kind::ENUM: {
+                auto enum_type = static_cast<EnumType*>(type);
+                WriteString(enum_type->GetName());
+                WriteType(enum_type->GetBaseType());
+                for (const auto& value : enum_type->GetValues()) {
+                    WriteString(value.first);
+                    WriteInt(value.second);
+                }
+                break;
+            }
+            case Type::Kind::FUNCTION: {
+                auto func_type = static_cast<FunctionType*>(type);
+                WriteType(func_type->GetReturnType());
+                WriteInt(static_cast<int64_t>(func_type->GetParamTypes().size()));
+                for (const auto& param_type : func_type->GetParamTypes()) {
+                    WriteType(param_type);
+                }
+                WriteInt(func_type->IsVariadic());
+                break;
+            }
+            default:
+                // Primitive types, including signedness
+                WriteString(type->ToString());
+                break;
+        }
+    }
+
+    std::string bytes_;                                     // Serialization of the current function
+    std::set<std::string> callees_;                         // Functions the current body calls
+    std::unordered_set<const Type*> written_structs_;       // Structs already written in full
+    std::unordered_map<std::string, Function> functions_;   // Functions by LLVM name
+    std::unordered_map<std::string, int64_t> enumerators_;  // Enumerator values declared so far
+};
+
+} // anonymous namespace
+
+/**
+ * ComputeFunctionFingerprints - Fingerprint every function definition
+ */
+std::unordered_map<std::string, std::string> ComputeFunctionFingerprints(
+    CompilationUnit* unit, bool include_callee_bodies) {
+    FingerprintWriter writer;
+    writer.VisitCompilationUnit(unit);
+    const auto& functions = writer.GetFunctions();
+
+    std::unordered_map<std::string, std::string> fingerprints;
+    for (const auto& entry : functions) {
+        const FingerprintWriter::Function& function = entry.second;
+        if (function.definitions != 1) {
+            continue;
+        }
+
+        std::string fingerprint = function.definition;
+
+        // Find the functions whose code can affect this one's: the direct
+        // callees, or everything reachable if the inliner may pull it in
+        std::set<std::string> dependencies = function.callees;
+        if (include_callee_bodies) {
+            std::vector<std::string> worklist(dependencies.begin(), dependencies.end());
+            while (!worklist.empty()) {
+                std::string name = std::move(worklist.back());
+                worklist.pop_back();
+                auto it = functions.find(name);
+                if (it == functions.end()) {
+                    continue;
+                }
+                for (const auto& callee : it->second.callees) {
+                    if (dependencies.insert(callee).second) {
+                        worklist.push_back(callee);
+                    }
+                }
+            }
+        }
+
+        // Functions not in the unit are runtime functions, which only
+        // change with the compiler
+        for (const auto& name : dependencies) {
+            AppendField(fingerprint, name);
+            auto it = functions.find(name);
+            if (it == functions.end()) {
+                continue;
+            }
+            AppendField(fingerprint, include_callee_bodies ? it->second.definition
+                                                           : it->second.signature);
+        }
+
+        fingerprints.emplace(entry.first, std::move(fingerprint));
+    }
+    return fingerprints;
+}
+
+} // namespace dsLang
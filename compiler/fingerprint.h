@@ -0,0 +1,39 @@
+/**
+ * fingerprint.h - Function Fingerprints for dsLang
+ *
+ * This file declares ComputeFunctionFingerprints, which describes
+ * everything the generated code of each function definition depends on.
+ * Two compiles that give a function the same fingerprint (at the same
+ * optimization level, for the same target, with the same compiler) produce
+ * the same code for it, so the code can be cached per function.
+ */
+
+#ifndef DSLANG_FINGERPRINT_H
+#define DSLANG_FINGERPRINT_H
+
+#include "ast.h"
+#include <string>
+#include <unordered_map>
+
+namespace dsLang {
+
+/**
+ * ComputeFunctionFingerprints - Fingerprint every function definition
+ *
+ * A fingerprint covers the definition's signature and body and the full
+ * layout of every type they mention, plus the signature of each function
+ * it calls. When the optimizer may inline, it also covers the signatures
+ * and bodies of every function reachable through calls, since any of them
+ * can end up in the optimized code.
+ *
+ * @param unit The analyzed compilation unit
+ * @param include_callee_bodies Whether callees' bodies affect the code
+ * @return Fingerprints (opaque byte strings) by LLVM function name; names
+ *         defined more than once are left out
+ */
+std::unordered_map<std::string, std::string> ComputeFunctionFingerprints(
+    CompilationUnit* unit, bool include_callee_bodies);
+
+} // namespace dsLang
+
+#endif // DSLANG_FINGERPRINT_H
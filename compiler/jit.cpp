@@ -0,0 +1,534 @@
+/**
+ * jit.cpp - In-Process Execution Implementation for dsLang
+ *
+ * This file implements JitSession, the host shims for the dsOS standard
+ * library, and tiered recompilation of hot functions.
+ */
+
+#include "jit.h"
+#include "backend.h"
+#include "optimizer.h"
+#include "threadpool.h"
+#include <llvm/Bitcode/BitcodeReader.h>
+#include <llvm/Bitcode/BitcodeWriter.h>
+#include <llvm/ExecutionEngine/Orc/AbsoluteSymbols.h>
+#include <llvm/ExecutionEngine/Orc/CompileOnDemandLayer.h>
+#include <llvm/ExecutionEngine/Orc/CompileUtils.h>
+#include <llvm/ExecutionEngine/Orc/Core.h>
+#include <llvm/IR/IRBuilder.h>
+#include <llvm/IR/MDBuilder.h>
+#include <llvm/Support/MemoryBuffer.h>
+#include <llvm/Support/raw_ostream.h>
+#include <llvm/TargetParser/Host.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+namespace dsLang {
+
+namespace {
+
+//===----------------------------------------------------------------------===//
+// Host shims for the dsOS standard library (std/). Each has the signature
+// of the function it stands in for.
+//===----------------------------------------------------------------------===//
+
+/**
+ * HostClearScreen - There is no screen to clear; output is a stream
+ */
+void HostClearScreen() {
+}
+
+/**
+ * HostPutchar - Write a character to stdout
+ */
+void HostPutchar(char c) {
+    std::fputc(static_cast<unsigned char>(c), stdout);
+}
+
+/**
+ * HostPuts - Write a string to stdout; like dsOS's, adds no newline
+ */
+void HostPuts(const char* str) {
+    std::fputs(str, stdout);
+}
+
+/**
+ * HostGetchar - Read a character from stdin
+ */
+int HostGetchar() {
+    return std::getchar();
+}
+
+/**
+ * HostItoa - Write an int in decimal
+ */
+char* HostItoa(int value, char* str) {
+    std::snprintf(str, 12, "%d", value);
+    return str;
+}
+
+/**
+ * HostShim - A standard library function and its host stand-in
+ */
+struct HostShim {
+    const char* name;                   // dsOS standard library name
+    llvm::orc::ExecutorAddr address;    // Host function with its signature
+};
+
+/**
+ * GetHostShims - Get every standard library function that can run on a host
+ */
+std::vector<HostShim> GetHostShims() {
+    using llvm::orc::ExecutorAddr;
+
+    // C++ overloads these on constness; dsOS has the C signatures
+    using FindChar = const char* (*)(const char*, int);
+    using FindString = const char* (*)(const char*, const char*);
+
+    return {
+        {"clear_screen", ExecutorAddr::fromPtr(&HostClearScreen)},
+        {"putchar", ExecutorAddr::fromPtr(&HostPutchar)},
+        {"puts", ExecutorAddr::fromPtr(&HostPuts)},
+        {"printf", ExecutorAddr::fromPtr(&std::printf)},
+        {"getchar", ExecutorAddr::fromPtr(&HostGetchar)},
+        {"malloc", ExecutorAddr::fromPtr(&std::malloc)},
+        {"free", ExecutorAddr::fromPtr(&std::free)},
+        {"memset", ExecutorAddr::fromPtr(&std::memset)},
+        {"memcpy", ExecutorAddr::fromPtr(&std::memcpy)},
+        {"memmove", ExecutorAddr::fromPtr(&std::memmove)},
+        {"memcmp", ExecutorAddr::fromPtr(&std::memcmp)},
+        {"strlen", ExecutorAddr::fromPtr(&std::strlen)},
+        {"strcpy", ExecutorAddr::fromPtr(&std::strcpy)},
+        {"strncpy", ExecutorAddr::fromPtr(&std::strncpy)},
+        {"strcat", ExecutorAddr::fromPtr(&std::strcat)},
+        {"strncat", ExecutorAddr::fromPtr(&std::strncat)},
+        {"strcmp", ExecutorAddr::fromPtr(&std::strcmp)},
+        {"strncmp", ExecutorAddr::fromPtr(&std::strncmp)},
+        {"strchr", ExecutorAddr::fromPtr(static_cast<FindChar>(&std::strchr))},
+        {"strrchr", ExecutorAddr::fromPtr(static_cast<FindChar>(&std::strrchr))},
+        {"strstr", ExecutorAddr::fromPtr(static_cast<FindString>(&std::strstr))},
+        {"atoi", ExecutorAddr::fromPtr(&std::atoi)},
+        {"itoa", ExecutorAddr::fromPtr(&HostItoa)},
+    };
+}
+
+/**
+ * TakeError - Move an LLVM error's message into an error string
+ */
+void TakeError(llvm::Error err, std::string* error) {
+    std::string message = llvm::toString(std::move(err));
+    if (error) {
+        *error = message;
+    }
+}
+
+/**
+ * GetTierOptLevel - Get the level a module's IR was optimized at
+ *
+ * Recompiled hot functions carry it as a module flag; code without one is
+ * the -O0 first tier.
+ */
+unsigned GetTierOptLevel(const llvm::Module& module) {
+    auto level = llvm::mdconst::extract_or_null<llvm::ConstantInt>(
+        module.getModuleFlag("dscc.opt_level"));
+    return level ? static_cast<unsigned>(level->getZExtValue()) : 0;
+}
+
+/**
+ * TieredCompiler - Compiles each module with the backend at its tier's level
+ *
+ * A lazy JIT compiles on whichever thread first calls a function, and hot
+ * functions are recompiled on the tier-up thread, so every module gets a
+ * TargetMachine of its own.
+ */
+class TieredCompiler : public llvm::orc::IRCompileLayer::IRCompiler {
+public:
+    explicit TieredCompiler(llvm::orc::JITTargetMachineBuilder machine_builder)
+        : IRCompiler(llvm::orc::irManglingOptionsFromTargetOptions(machine_builder.getOptions())),
+          machine_builder_(std::move(machine_builder)) {}
+
+    llvm::Expected<std::unique_ptr<llvm::MemoryBuffer>> operator()(llvm::Module& module) override {
+        llvm::orc::JITTargetMachineBuilder machine_builder = machine_builder_;
+        machine_builder.setCodeGenOptLevel(GetCodeGenOptLevel(GetTierOptLevel(module)));
+        return llvm::orc::ConcurrentIRCompiler(std::move(machine_builder))(module);
+    }
+
+private:
+    llvm::orc::JITTargetMachineBuilder machine_builder_;    // The host, at no particular level
+};
+
+} // anonymous namespace
+
+/**
+ * Constructor
+ */
+JitSession::JitSession(std::unique_ptr<llvm::orc::LLJIT> jit, const TieringOptions* tiering)
+    : jit_(std::move(jit)), lazy_jit_(nullptr) {
+    if (tiering) {
+        lazy_jit_ = static_cast<llvm::orc::LLLazyJIT*>(jit_.get());
+        tiering_ = *tiering;
+        tier_up_pool_ = std::make_unique<ThreadPool>(1);
+    }
+}
+
+/**
+ * Destructor - Abandon recompiles not yet started and wait for the rest
+ */
+JitSession::~JitSession() {
+    closing_ = true;
+    tier_up_pool_.reset();
+}
+
+/**
+ * Create - Set up a JIT for the host with the standard library shims
+ */
+std::unique_ptr<JitSession> JitSession::Create(std::string* error) {
+    // Registers the x86 target, which the JIT compiles for
+    BackendContext::Get();
+
+    // Only the shims may resolve external calls; falling back to whatever
+    // the compiler process exports would bind calls to unrelated functions
+    auto jit = llvm::orc::LLJITBuilder().setLinkProcessSymbolsByDefault(false).create();
+    if (!jit) {
+        TakeError(jit.takeError(), error);
+        return nullptr;
+    }
+
+    std::unique_ptr<JitSession> session(new JitSession(std::move(*jit), nullptr));
+    if (!session->DefineHostShims(error)) {
+        return nullptr;
+    }
+    return session;
+}
+
+/**
+ * CreateLazy - Set up a JIT that compiles functions on first call
+ */
+std::unique_ptr<JitSession> JitSession::CreateLazy(const TieringOptions& tiering, std::string* error) {
+    BackendContext::Get();
+
+    llvm::orc::LLLazyJITBuilder builder;
+    builder.setLinkProcessSymbolsByDefault(false);
+    builder.setCompileFunctionCreator([](llvm::orc::JITTargetMachineBuilder machine_builder)
+            -> llvm::Expected<std::unique_ptr<llvm::orc::IRCompileLayer::IRCompiler>> {
+        return std::make_unique<TieredCompiler>(std::move(machine_builder));
+    });
+
+    auto jit = builder.create();
+    if (!jit) {
+        TakeError(jit.takeError(), error);
+        return nullptr;
+    }
+
+    // Split modules into one function per partition, compiled when called
+    (*jit)->setPartitionFunction(llvm::orc::CompileOnDemandLayer::compileRequested);
+
+    std::unique_ptr<JitSession> session(new JitSession(std::move(*jit), &tiering));
+    if (!session->DefineHostShims(error) || !session->DefineTieringHooks(error)) {
+        return nullptr;
+    }
+    return session;
+}
+
+/**
+ * GetHostTriple - Get the triple to generate JIT-compiled modules for
+ */
+std::string JitSession::GetHostTriple() {
+    return llvm::sys::getProcessTriple();
+}
+
+/**
+ * AddModule - Add a module; it is compiled when first looked up
+ */
+bool JitSession::AddModule(llvm::orc::ThreadSafeModule module, std::string* error) {
+    if (lazy_jit_) {
+        module.withModuleDo([this](llvm::Module& m) { PrepareForTiering(m); });
+    }
+
+    llvm::Error err = lazy_jit_ ? lazy_jit_->addLazyIRModule(std::move(module))
+                                : jit_->addIRModule(std::move(module));
+    if (err) {
+        TakeError(std::move(err), error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Run - Call a function taking no arguments
+ */
+bool JitSession::Run(const std::string& entry, bool returns_int, int* result, std::string* error) {
+    // Looking the entry up compiles the module and resolves its externals
+    auto symbol = jit_->lookup(entry);
+    if (!symbol) {
+        TakeError(symbol.takeError(), error);
+        return false;
+    }
+
+    if (returns_int) {
+        *result = symbol->toPtr<int (*)()>()();
+    } else {
+        symbol->toPtr<void (*)()>()();
+        *result = 0;
+    }
+
+    // The program wrote through the host's stdio buffers
+    std::fflush(stdout);
+    return true;
+}
+
+/**
+ * DefineHostShims - Define the standard library as the host shims
+ */
+bool JitSession::DefineHostShims(std::string* error) {
+    llvm::orc::SymbolMap symbols;
+    for (const auto& shim : GetHostShims()) {
+        symbols[jit_->mangleAndIntern(shim.name)] = llvm::orc::ExecutorSymbolDef(
+            shim.address, llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+    }
+
+    if (llvm::Error err = jit_->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols)))) {
+        TakeError(std::move(err), error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * DefineTieringHooks - Define what counted code calls when it becomes hot
+ *
+ * The session's address is defined as a symbol, so that code can pass it
+ * back to the hook.
+ */
+bool JitSession::DefineTieringHooks(std::string* error) {
+    llvm::orc::SymbolMap symbols;
+    symbols[jit_->mangleAndIntern("dscc.session")] = llvm::orc::ExecutorSymbolDef(
+        llvm::orc::ExecutorAddr::fromPtr(this), llvm::JITSymbolFlags::Exported);
+    symbols[jit_->mangleAndIntern("dscc.tier_up")] = llvm::orc::ExecutorSymbolDef(
+        llvm::orc::ExecutorAddr::fromPtr(&TierUpHook),
+        llvm::JITSymbolFlags::Exported | llvm::JITSymbolFlags::Callable);
+
+    if (llvm::Error err = jit_->getMainJITDylib().define(llvm::orc::absoluteSymbols(std::move(symbols)))) {
+        TakeError(std::move(err), error);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * PrepareForTiering - Make a module's functions countable and swappable
+ *
+ * Every direct call is made through an entry pointer, "<name>.entry",
+ * which starts out at the lazily compiled code; a tier-up stores the
+ * optimized code there. The module is then saved as it is, before every
+ * function gets a call counter, "<name>.calls", that calls the tier-up
+ * hook on reaching the hot call count.
+ */
+void JitSession::PrepareForTiering(llvm::Module& module) {
+    llvm::LLVMContext& context = module.getContext();
+    const llvm::DataLayout& data_layout = module.getDataLayout();
+
+    std::vector<llvm::Function*> defined;
+    for (auto& func : module) {
+        if (!func.isDeclaration()) {
+            defined.push_back(&func);
+        }
+    }
+
+    // Route direct calls through the entry pointers. Calls through
+    // function pointers keep going to the first tier.
+    for (llvm::Function* func : defined) {
+        auto entry = new llvm::GlobalVariable(
+            module, func->getType(), false, llvm::GlobalValue::ExternalLinkage, func,
+            func->getName() + ".entry");
+        llvm::Align alignment = data_layout.getPointerABIAlignment(0);
+        entry->setAlignment(alignment);
+
+        std::vector<llvm::CallInst*> calls;
+        for (llvm::User* user : func->users()) {
+            auto call = llvm::dyn_cast<llvm::CallInst>(user);
+            if (call && call->getCalledOperand() == func) {
+                calls.push_back(call);
+            }
+        }
+        for (llvm::CallInst* call : calls) {
+            llvm::IRBuilder<> builder(call);
+            llvm::LoadInst* target = builder.CreateAlignedLoad(func->getType(), entry, alignment,
+                                                               func->getName() + ".target");
+            target->setAtomic(llvm::AtomicOrdering::Acquire);
+            call->setCalledOperand(target);
+        }
+    }
+
+    // Tier-ups rebuild functions from this copy, so they are not counted
+    auto bitcode = std::make_shared<std::string>();
+    llvm::raw_string_ostream bitcode_stream(*bitcode);
+    llvm::WriteBitcodeToFile(module, bitcode_stream);
+    bitcode_stream.flush();
+
+    llvm::Type* int32_type = llvm::Type::getInt32Ty(context);
+    llvm::Type* int64_type = llvm::Type::getInt64Ty(context);
+    auto session = new llvm::GlobalVariable(
+        module, llvm::Type::getInt8Ty(context), true, llvm::GlobalValue::ExternalLinkage,
+        nullptr, "dscc.session");
+    llvm::Function* hook = llvm::Function::Create(
+        llvm::FunctionType::get(llvm::Type::getVoidTy(context), {session->getType(), int64_type}, false),
+        llvm::Function::ExternalLinkage, "dscc.tier_up", module);
+    llvm::MDNode* weights = llvm::MDBuilder(context).createBranchWeights(1, tiering_.hot_call_count);
+
+    for (llvm::Function* func : defined) {
+        uint64_t index;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            index = functions_.size();
+            functions_.push_back({func->getName().str(), bitcode, false});
+        }
+
+        auto counter = new llvm::GlobalVariable(
+            module, int32_type, false, llvm::GlobalValue::InternalLinkage,
+            llvm::ConstantInt::get(int32_type, 0), func->getName() + ".calls");
+
+        // Count the call after the allocas, which must stay in the entry block
+        llvm::BasicBlock* entry_block = &func->getEntryBlock();
+        auto first = entry_block->begin();
+        while (llvm::isa<llvm::AllocaInst>(*first)) {
+            ++first;
+        }
+        llvm::BasicBlock* body = entry_block->splitBasicBlock(first, "body");
+        llvm::BasicBlock* hot = llvm::BasicBlock::Create(context, "tier_up", func, body);
+        entry_block->getTerminator()->eraseFromParent();
+
+        llvm::IRBuilder<> builder(entry_block);
+        llvm::Value* calls = builder.CreateAtomicRMW(
+            llvm::AtomicRMWInst::Add, counter, llvm::ConstantInt::get(int32_type, 1),
+            llvm::MaybeAlign(4), llvm::AtomicOrdering::Monotonic);
+        llvm::Value* is_hot = builder.CreateICmpEQ(
+            calls, llvm::ConstantInt::get(int32_type, tiering_.hot_call_count - 1));
+        builder.CreateCondBr(is_hot, hot, body, weights);
+
+        builder.SetInsertPoint(hot);
+        builder.CreateCall(hook, {session, llvm::ConstantInt::get(int64_type, index)});
+        builder.CreateBr(body);
+    }
+}
+
+/**
+ * TierUpHook - Called by counted code when a function becomes hot
+ */
+void JitSession::TierUpHook(JitSession* session, uint64_t function) {
+    session->ScheduleTierUp(function);
+}
+
+/**
+ * ScheduleTierUp - Queue a hot function for recompiling, once
+ */
+void JitSession::ScheduleTierUp(uint64_t function) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (function >= functions_.size() || functions_[function].scheduled) {
+            return;
+        }
+        functions_[function].scheduled = true;
+    }
+
+    tier_up_pool_->Submit([this, function] {
+        if (!closing_) {
+            TierUp(function);
+        }
+    });
+}
+
+/**
+ * TierUp - Recompile a hot function, reporting failure as a warning
+ */
+void JitSession::TierUp(size_t function) {
+    std::string name;
+    std::shared_ptr<const std::string> bitcode;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        name = functions_[function].name;
+        bitcode = functions_[function].bitcode;
+    }
+
+    // The program keeps running on the first tier, so this is not fatal
+    std::string error;
+    if (Recompile(name, *bitcode, &error)) {
+        tier_up_count_++;
+    } else {
+        std::cerr << "warning: could not recompile hot function '" << name << "': " << error << "\n";
+    }
+}
+
+/**
+ * Recompile - Optimize a function and swap its entry to the new code
+ *
+ * Runs on the tier-up thread while the program keeps running. Calls that
+ * loaded the entry before the swap finish in the old code, which stays.
+ */
+bool JitSession::Recompile(const std::string& name, const std::string& bitcode, std::string* error) {
+    // Rebuild the module in a context of its own
+    auto context = std::make_unique<llvm::LLVMContext>();
+    auto parsed = llvm::parseBitcodeFile(llvm::MemoryBufferRef(bitcode, name), *context);
+    if (!parsed) {
+        TakeError(parsed.takeError(), error);
+        return false;
+    }
+    std::unique_ptr<llvm::Module> module = std::move(*parsed);
+
+    // Keep only the function and the internal constants (string literals)
+    // it uses; everything else is the first tier's
+    for (auto& func : *module) {
+        if (func.getName() != name && !func.isDeclaration()) {
+            func.deleteBody();
+        }
+    }
+    for (auto it = module->global_begin(); it != module->global_end();) {
+        llvm::GlobalVariable& global = *it++;
+        if (!global.hasLocalLinkage()) {
+            global.setInitializer(nullptr);
+            global.setLinkage(llvm::GlobalValue::ExternalLinkage);
+            continue;
+        }
+        global.removeDeadConstantUsers();
+        if (global.use_empty()) {
+            global.eraseFromParent();
+        }
+    }
+
+    // The first tier keeps its name; the entry pointer is what moves
+    std::string hot_name = name + ".O" + std::to_string(tiering_.opt_level);
+    module->getFunction(name)->setName(hot_name);
+    module->addModuleFlag(llvm::Module::Warning, "dscc.opt_level", tiering_.opt_level);
+
+    TargetMachineLease target_machine = BackendContext::Get().AcquireTargetMachine(
+        GetHostTriple(), llvm::sys::getHostCPUName().str(), "", tiering_.opt_level, error);
+    if (!target_machine) {
+        return false;
+    }
+    OptimizeModule(*module, target_machine.Get(), tiering_.opt_level);
+
+    if (llvm::Error err = jit_->addIRModule(
+            llvm::orc::ThreadSafeModule(std::move(module), std::move(context)))) {
+        TakeError(std::move(err), error);
+        return false;
+    }
+
+    auto code = jit_->lookup(hot_name);
+    if (!code) {
+        TakeError(code.takeError(), error);
+        return false;
+    }
+    auto entry = jit_->lookup(name + ".entry");
+    if (!entry) {
+        TakeError(entry.takeError(), error);
+        return false;
+    }
+
+    using EntryPointer = std::atomic<void*>;
+    entry->toPtr<EntryPointer*>()->store(code->toPtr<void*>(), std::memory_order_release);
+    return true;
+}
+
+} // namespace dsLang
@@ -0,0 +1,145 @@
+/**
+ * jit.h - In-Process Execution for dsLang
+ *
+ * This file defines the JitSession class, which compiles generated modules
+ * with ORC's LLJIT and runs them inside the compiler process (dscc --run),
+ * so that dsLang tests and benchmarks run on the build host without
+ * booting the kernel.
+ *
+ * Programs are built for the host, not for dsOS. Calls into the dsOS
+ * standard library are bound to host shims: console output goes to stdout,
+ * memory comes from the host heap, and the string and memory functions are
+ * the host C library's. Kernel-only functions such as port I/O have no
+ * host equivalent, so programs that call them cannot be run.
+ *
+ * A lazy session compiles each function on its first call, at -O0, so
+ * that large programs start at once. Every call of such a function is
+ * counted; once a function has been called often enough it is recompiled
+ * at a higher level on a background thread, and its entry is swapped for
+ * the new code. Later calls, from any thread, run the optimized code.
+ */
+
+#ifndef DSLANG_JIT_H
+#define DSLANG_JIT_H
+
+#include <llvm/ExecutionEngine/Orc/LLJIT.h>
+#include <llvm/ExecutionEngine/Orc/ThreadSafeModule.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace dsLang {
+
+class ThreadPool;
+
+/**
+ * TieringOptions - When and how a lazy session recompiles hot functions
+ */
+struct TieringOptions {
+    uint32_t hot_call_count = 1000;     // Calls after which a function is recompiled
+    unsigned opt_level = 2;             // Level hot functions are recompiled at (1-3)
+};
+
+/**
+ * JitSession - A JIT holding the modules of one program
+ *
+ * Only x86-64 hosts are supported, since the x86 target is the only one
+ * the backend registers.
+ */
+class JitSession {
+public:
+    /**
+     * Create - Set up a JIT for the host with the standard library shims
+     *
+     * @param error Receives a description of the failure, if any
+     * @return The session, or nullptr on failure
+     */
+    static std::unique_ptr<JitSession> Create(std::string* error = nullptr);
+
+    /**
+     * CreateLazy - Set up a JIT that compiles functions on first call
+     *
+     * Modules added to it should not be optimized; functions start at -O0
+     * and only hot ones are recompiled, as set by the tiering options.
+     *
+     * @param tiering When and how hot functions are recompiled
+     * @param error Receives a description of the failure, if any
+     * @return The session, or nullptr on failure
+     */
+    static std::unique_ptr<JitSession> CreateLazy(const TieringOptions& tiering,
+                                                  std::string* error = nullptr);
+
+    /**
+     * Destructor - Abandon recompiles not yet started and wait for the rest
+     */
+    ~JitSession();
+
+    /**
+     * GetHostTriple - Get the triple to generate JIT-compiled modules for
+     */
+    static std::string GetHostTriple();
+
+    /**
+     * AddModule - Add a module; it is compiled when first looked up
+     *
+     * @param module The module, generated for GetHostTriple()
+     * @param error Receives a description of the failure, if any
+     * @return False on failure
+     */
+    bool AddModule(llvm::orc::ThreadSafeModule module, std::string* error = nullptr);
+
+    /**
+     * Run - Call a function taking no arguments
+     *
+     * @param entry The name of the function
+     * @param returns_int Whether it returns int (otherwise void)
+     * @param result Receives the return value, or 0 for void functions
+     * @param error Receives a description of the failure, if any
+     * @return False if the function could not be compiled or found
+     */
+    bool Run(const std::string& entry, bool returns_int, int* result, std::string* error = nullptr);
+
+    /**
+     * GetTierUpCount - Get the number of hot functions recompiled so far
+     */
+    size_t GetTierUpCount() const { return tier_up_count_.load(); }
+
+private:
+    /**
+     * HotFunction - A lazily compiled function and its tier-up state
+     */
+    struct HotFunction {
+        std::string name;                               // Symbol of the -O0 code
+        std::shared_ptr<const std::string> bitcode;     // Its module, unoptimized and uncounted
+        bool scheduled = false;                         // Set once a recompile is queued
+    };
+
+    JitSession(std::unique_ptr<llvm::orc::LLJIT> jit, const TieringOptions* tiering);
+
+    bool DefineHostShims(std::string* error);
+    bool DefineTieringHooks(std::string* error);
+    void PrepareForTiering(llvm::Module& module);
+    void ScheduleTierUp(uint64_t function);
+    void TierUp(size_t function);
+    bool Recompile(const std::string& name, const std::string& bitcode, std::string* error);
+
+    static void TierUpHook(JitSession* session, uint64_t function);
+
+    std::unique_ptr<llvm::orc::LLJIT> jit_;     // The JIT and its main library
+    llvm::orc::LLLazyJIT* lazy_jit_;            // jit_ if it is lazy, else null
+    TieringOptions tiering_;                    // Recompile policy of a lazy session
+
+    std::mutex mutex_;                          // Guards functions_
+    std::vector<HotFunction> functions_;        // Every lazily compiled function
+    std::atomic<size_t> tier_up_count_{0};      // Functions recompiled so far
+    std::atomic<bool> closing_{false};          // Set by the destructor
+
+    std::unique_ptr<ThreadPool> tier_up_pool_;  // Recompiles in the background
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_JIT_H
@@ -0,0 +1,471 @@
+/**
+ * json.cpp - Minimal JSON Values Implementation for dsLang
+ *
+ * This file implements parsing and serializing JsonValue.
+ */
+
+#include "json.h"
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+namespace dsLang {
+
+namespace {
+
+/**
+ * JsonParser - Recursive-descent parser over a complete JSON text
+ */
+class JsonParser {
+public:
+    explicit JsonParser(std::string_view text) : text_(text), pos_(0) {}
+
+    bool ParseDocument(JsonValue* value) {
+        SkipWhitespace();
+        if (!ParseValue(value, 0)) {
+            return false;
+        }
+        SkipWhitespace();
+        if (pos_ != text_.size()) {
+            return Fail("unexpected text after value");
+        }
+        return true;
+    }
+
+    const std::string& GetError() const { return error_; }
+
+private:
+    // Deep enough for any real message, shallow enough not to overflow
+    static constexpr int kMaxDepth = 128;
+
+    bool Fail(const char* message) {
+        if (error_.empty()) {
+            error_ = std::string(message) + " at offset " + std::to_string(pos_);
+        }
+        return false;
+    }
+
+    void SkipWhitespace() {
+        while (pos_ < text_.size()) {
+            char c = text_[pos_];
+            if (c != ' ' && c != '\t' && c != '\n' && c != '\r') {
+                break;
+            }
+            ++pos_;
+        }
+    }
+
+    bool Consume(std::string_view word) {
+        if (text_.substr(pos_, word.size()) != word) {
+            return false;
+        }
+        pos_ += word.size();
+        return true;
+    }
+
+    bool ParseValue(JsonValue* value, int depth) {
+        if (depth > kMaxDepth) {
+            return Fail("nesting too deep");
+        }
+        if (pos_ >= text_.size()) {
+            return Fail("unexpected end of input");
+        }
+
+        switch (text_[pos_]) {
+            case '{':
+                return ParseObject(value, depth);
+            case '[':
+                return ParseArray(value, depth);
+            case '"': {
+                std::string text;
+                if (!ParseString(&text)) {
+                    return false;
+                }
+                *value = JsonValue(std::move(text));
+                return true;
+            }
+            case 't':
+                if (Consume("true")) {
+                    *value = JsonValue(true);
+                    return true;
+                }
+                return Fail("invalid literal");
+            case 'f':
+                if (Consume("false")) {
+                    *value = JsonValue(false);
+                    return true;
+                }
+                return Fail("invalid literal");
+            case 'n':
+                if (Consume("null")) {
+                    *value = JsonValue();
+                    return true;
+                }
+                return Fail("invalid literal");
+            default:
+                return ParseNumber(value);
+        }
+    }
+
+    bool ParseObject(JsonValue* value, int depth) {
+        *value = JsonValue::Object();
+        ++pos_;
+        SkipWhitespace();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            ++pos_;
+            return true;
+        }
+
+        while (true) {
+            SkipWhitespace();
+            if (pos_ >= text_.size() || text_[pos_] != '"') {
+                return Fail("expected member name");
+            }
+            std::string key;
+            if (!ParseString(&key)) {
+                return false;
+            }
+
+            SkipWhitespace();
+            if (pos_ >= text_.size() || text_[pos_] != ':') {
+                return Fail("expected ':'");
+            }
+            ++pos_;
+            SkipWhitespace();
+
+            JsonValue member;
+            if (!ParseValue(&member, depth + 1)) {
+                return false;
+            }
+            value->Set(std::move(key), std::move(member));
+
+            SkipWhitespace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                ++pos_;
+                continue;
+            }
+            if (pos_ < text_.size() && text_[pos_] == '}') {
+                ++pos_;
+                return true;
+            }
+            return Fail("expected ',' or '}'");
+        }
+    }
+
+    bool ParseArray(JsonValue* value, int depth) {
+        *value = JsonValue::Array();
+        ++pos_;
+        SkipWhitespace();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            ++pos_;
+            return true;
+        }
+
+        while (true) {
+            SkipWhitespace();
+            JsonValue element;
+            if (!ParseValue(&element, depth + 1)) {
+                return false;
+            }
+            value->Push(std::move(element));
+
+            SkipWhitespace();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                ++pos_;
+                continue;
+            }
+            if (pos_ < text_.size() && text_[pos_] == ']') {
+                ++pos_;
+                return true;
+            }
+            return Fail("expected ',' or ']'");
+        }
+    }
+
+    bool ParseHex4(uint32_t* code) {
+        if (pos_ + 4 > text_.size()) {
+            return Fail("truncated \\u escape");
+        }
+        uint32_t result = 0;
+        for (int i = 0; i < 4; ++i) {
+            char c = text_[pos_++];
+            result <<= 4;
+            if (c >= '0' && c <= '9') {
+                result |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                result |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                result |= c - 'A' + 10;
+            } else {
+                return Fail("invalid \\u escape");
+            }
+        }
+        *code = result;
+        return true;
+    }
+
+    static void AppendUtf8(std::string* out, uint32_t code) {
+        if (code < 0x80) {
+            out->push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out->push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else if (code < 0x10000) {
+            out->push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out->push_back(static_cast<char>(0xF0 | (code >> 18)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 12) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out->push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    bool ParseString(std::string* out) {
+        // Skip the opening quote
+        ++pos_;
+        while (true) {
+            if (pos_ >= text_.size()) {
+                return Fail("unterminated string");
+            }
+            char c = text_[pos_++];
+            if (c == '"') {
+                return true;
+            }
+            if (static_cast<unsigned char>(c) < 0x20) {
+                return Fail("control character in string");
+            }
+            if (c != '\\') {
+                out->push_back(c);
+                continue;
+            }
+
+            if (pos_ >= text_.size()) {
+                return Fail("unterminated string");
+            }
+            switch (text_[pos_++]) {
+                case '"': out->push_back('"'); break;
+                case '\\': out->push_back('\\'); break;
+                case '/': out->push_back('/'); break;
+                case 'b': out->push_back('\b'); break;
+                case 'f': out->push_back('\f'); break;
+                case 'n': out->push_back('\n'); break;
+                case 'r': out->push_back('\r'); break;
+                case 't': out->push_back('\t'); break;
+                case 'u': {
+                    uint32_t code;
+                    if (!ParseHex4(&code)) {
+                        return false;
+                    }
+                    // Combine a surrogate pair into one code point
+                    if (code >= 0xD800 && code <= 0xDBFF) {
+                        uint32_t low;
+                        if (!Consume("\\u") || !ParseHex4(&low) || low < 0xDC00 || low > 0xDFFF) {
+                            return Fail("invalid surrogate pair");
+                        }
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    AppendUtf8(out, code);
+                    break;
+                }
+                default:
+                    return Fail("invalid escape");
+            }
+        }
+    }
+
+    bool ParseNumber(JsonValue* value) {
+        size_t start = pos_;
+        if (pos_ < text_.size() && text_[pos_] == '-') {
+            ++pos_;
+        }
+        size_t digits = pos_;
+        while (pos_ < text_.size() && ((text_[pos_] >= '0' && text_[pos_] <= '9') ||
+               text_[pos_] == '.' || text_[pos_] == 'e' || text_[pos_] == 'E' ||
+               text_[pos_] == '+' || text_[pos_] == '-')) {
+            ++pos_;
+        }
+        if (pos_ == digits) {
+            return Fail("unexpected character");
+        }
+
+        std::string number(text_.substr(start, pos_ - start));
+        char* end = nullptr;
+        double result = std::strtod(number.c_str(), &end);
+        if (*end != '\0') {
+            return Fail("invalid number");
+        }
+        *value = JsonValue(result);
+        return true;
+    }
+
+    std::string_view text_;     // The text being parsed
+    size_t pos_;                // Current position in text_
+    std::string error_;         // First error encountered
+};
+
+void SerializeString(const std::string& text, std::string& out) {
+    out.push_back('"');
+    for (char c : text) {
+        switch (c) {
+            case '"': out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\b': out += "\\b"; break;
+            case '\f': out += "\\f"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    char escape[8];
+                    std::snprintf(escape, sizeof(escape), "\\u%04x", static_cast<unsigned>(c));
+                    out += escape;
+                } else {
+                    out.push_back(c);
+                }
+        }
+    }
+    out.push_back('"');
+}
+
+} // anonymous namespace
+
+/**
+ * Array - Create an empty array
+ */
+JsonValue JsonValue::Array() {
+    JsonValue value;
+    value.kind_ = Kind::ARRAY;
+    return value;
+}
+
+/**
+ * Object - Create an empty object
+ */
+JsonValue JsonValue::Object() {
+    JsonValue value;
+    value.kind_ = Kind::OBJECT;
+    return value;
+}
+
+/**
+ * Parse - Parse a complete JSON text
+ */
+bool JsonValue::Parse(std::string_view text, JsonValue* value, std::string* error) {
+    JsonParser parser(text);
+    if (!parser.ParseDocument(value)) {
+        if (error) {
+            *error = parser.GetError();
+        }
+        return false;
+    }
+    return true;
+}
+
+/**
+ * AsString - Get a string, or the empty string if this is not one
+ */
+const std::string& JsonValue::AsString() const {
+    static const std::string empty;
+    return kind_ == Kind::STRING ? string_ : empty;
+}
+
+/**
+ * operator[] - Get an object member, or null if there is none
+ */
+const JsonValue& JsonValue::operator[](std::string_view key) const {
+    static const JsonValue null_value;
+    for (const auto& member : members_) {
+        if (member.first == key) {
+            return member.second;
+        }
+    }
+    return null_value;
+}
+
+/**
+ * Set - Add or replace an object member
+ */
+JsonValue& JsonValue::Set(std::string key, JsonValue value) {
+    for (auto& member : members_) {
+        if (member.first == key) {
+            member.second = std::move(value);
+            return *this;
+        }
+    }
+    members_.emplace_back(std::move(key), std::move(value));
+    return *this;
+}
+
+/**
+ * Push - Append an array element
+ */
+void JsonValue::Push(JsonValue value) {
+    elements_.push_back(std::move(value));
+}
+
+/**
+ * Serialize - Write the value as compact JSON on a single line
+ */
+std::string JsonValue::Serialize() const {
+    std::string out;
+    SerializeTo(out);
+    return out;
+}
+
+/**
+ * SerializeTo - Append the value's JSON text
+ */
+void JsonValue::SerializeTo(std::string& out) const {
+    switch (kind_) {
+        case Kind::NUL:
+            out += "null";
+            break;
+        case Kind::BOOLEAN:
+            out += bool_ ? "true" : "false";
+            break;
+        case Kind::NUMBER: {
+            // Integers print without a fraction; JSON has no NaN or infinity
+            char buffer[32];
+            if (!std::isfinite(number_)) {
+                out += "null";
+            } else if (number_ == std::floor(number_) && std::fabs(number_) < 1e15) {
+                std::snprintf(buffer, sizeof(buffer), "%.0f", number_);
+                out += buffer;
+            } else {
+                std::snprintf(buffer, sizeof(buffer), "%.17g", number_);
+                out += buffer;
+            }
+            break;
+        }
+        case Kind::STRING:
+            SerializeString(string_, out);
+            break;
+        case Kind::ARRAY:
+            out.push_back('[');
+            for (size_t i = 0; i < elements_.size(); ++i) {
+                if (i) {
+                    out.push_back(',');
+                }
+                elements_[i].SerializeTo(out);
+            }
+            out.push_back(']');
+            break;
+        case Kind::OBJECT:
+            out.push_back('{');
+            for (size_t i = 0; i < members_.size(); ++i) {
+                if (i) {
+                    out.push_back(',');
+                }
+                SerializeString(members_[i].first, out);
+                out.push_back(':');
+                members_[i].second.SerializeTo(out);
+            }
+            out.push_back('}');
+            break;
+    }
+}
+
+} // namespace dsLang
@@ -0,0 +1,127 @@
+/**
+ * json.h - Minimal JSON Values for dsLang
+ *
+ * This file defines the JsonValue class used by the compile server's wire
+ * protocol. It supports the full JSON grammar but is tuned for small
+ * messages, not large documents.
+ */
+
+#ifndef DSLANG_JSON_H
+#define DSLANG_JSON_H
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace dsLang {
+
+/**
+ * JsonValue - A parsed or constructed JSON value
+ *
+ * Objects keep their members in insertion order. Looking up a missing
+ * member or reading a value as the wrong kind yields a default instead of
+ * failing, which keeps request handling code short.
+ */
+class JsonValue {
+public:
+    enum class Kind {
+        NUL,
+        BOOLEAN,
+        NUMBER,
+        STRING,
+        ARRAY,
+        OBJECT
+    };
+
+    JsonValue() : kind_(Kind::NUL) {}
+    JsonValue(bool value) : kind_(Kind::BOOLEAN), bool_(value) {}
+    JsonValue(int value) : kind_(Kind::NUMBER), number_(value) {}
+    JsonValue(unsigned value) : kind_(Kind::NUMBER), number_(value) {}
+    JsonValue(double value) : kind_(Kind::NUMBER), number_(value) {}
+    JsonValue(const char* value) : kind_(Kind::STRING), string_(value) {}
+    JsonValue(std::string value) : kind_(Kind::STRING), string_(std::move(value)) {}
+
+    /**
+     * Array - Create an empty array
+     */
+    static JsonValue Array();
+
+    /**
+     * Object - Create an empty object
+     */
+    static JsonValue Object();
+
+    /**
+     * Parse - Parse a complete JSON text
+     *
+     * @param text The text to parse
+     * @param value Receives the parsed value
+     * @param error Receives a description of the failure, if any
+     * @return True if the whole text was a single valid JSON value
+     */
+    static bool Parse(std::string_view text, JsonValue* value, std::string* error = nullptr);
+
+    Kind GetKind() const { return kind_; }
+    bool IsNull() const { return kind_ == Kind::NUL; }
+    bool IsString() const { return kind_ == Kind::STRING; }
+    bool IsObject() const { return kind_ == Kind::OBJECT; }
+
+    /**
+     * AsBool - Get a boolean, or a default if this is not one
+     */
+    bool AsBool(bool default_value = false) const {
+        return kind_ == Kind::BOOLEAN ? bool_ : default_value;
+    }
+
+    /**
+     * AsNumber - Get a number, or a default if this is not one
+     */
+    double AsNumber(double default_value = 0) const {
+        return kind_ == Kind::NUMBER ? number_ : default_value;
+    }
+
+    /**
+     * AsString - Get a string, or the empty string if this is not one
+     */
+    const std::string& AsString() const;
+
+    /**
+     * operator[] - Get an object member, or null if there is none
+     */
+    const JsonValue& operator[](std::string_view key) const;
+
+    /**
+     * Set - Add or replace an object member
+     */
+    JsonValue& Set(std::string key, JsonValue value);
+
+    /**
+     * Push - Append an array element
+     */
+    void Push(JsonValue value);
+
+    /**
+     * GetElements - Get the elements of an array
+     */
+    const std::vector<JsonValue>& GetElements() const { return elements_; }
+
+    /**
+     * Serialize - Write the value as compact JSON on a single line
+     */
+    std::string Serialize() const;
+
+private:
+    void SerializeTo(std::string& out) const;
+
+    Kind kind_;                                             // The kind of value
+    bool bool_ = false;                                     // BOOLEAN payload
+    double number_ = 0;                                     // NUMBER payload
+    std::string string_;                                    // STRING payload
+    std::vector<JsonValue> elements_;                       // ARRAY payload
+    std::vector<std::pair<std::string, JsonValue>> members_;  // OBJECT payload
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_JSON_H
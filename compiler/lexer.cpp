@@ -6,50 +6,100 @@
  */
 
 #include "lexer.h"
-#include <unordered_map>
+#include "charscan.h"
+#include "diagnostic.h"
 #include <cctype>
 #include <iostream>
 #include <cassert>
 
 namespace dsLang {
 
-// Static keyword map for fast keyword lookup
-static const std::unordered_map<std::string, TokenKind> keywords = {
-    {"if", TokenKind::KW_IF},
-    {"else", TokenKind::KW_ELSE},
-    {"while", TokenKind::KW_WHILE},
-    {"for", TokenKind::KW_FOR},
-    {"do", TokenKind::KW_DO},
-    {"break", TokenKind::KW_BREAK},
-    {"continue", TokenKind::KW_CONTINUE},
-    {"return", TokenKind::KW_RETURN},
-    {"void", TokenKind::KW_VOID},
-    {"bool", TokenKind::KW_BOOL},
-    {"char", TokenKind::KW_CHAR},
-    {"short", TokenKind::KW_SHORT},
-    {"int", TokenKind::KW_INT},
-    {"long", TokenKind::KW_LONG},
-    {"float", TokenKind::KW_FLOAT},
-    {"double", TokenKind::KW_DOUBLE},
-    {"unsigned", TokenKind::KW_UNSIGNED},
-    {"struct", TokenKind::KW_STRUCT},
-    {"enum", TokenKind::KW_ENUM},
-    {"const", TokenKind::KW_CONST},
-    {"true", TokenKind::KW_TRUE},
-    {"false", TokenKind::KW_FALSE},
-    {"null", TokenKind::KW_NULL}
-};
+/**
+ * LookupKeyword - Classify an identifier-shaped lexeme
+ * 
+ * Dispatches on length and first character and then compares at most a
+ * couple of candidates directly against the source bytes, so no string is
+ * built or hashed for the (much more common) non-keyword case.
+ * 
+ * @param text The lexeme
+ * @return The keyword's token kind, or IDENTIFIER if it is not a keyword
+ */
+static TokenKind LookupKeyword(std::string_view text) {
+    switch (text.size()) {
+        case 2:
+            switch (text[0]) {
+                case 'i': if (text == "if") return TokenKind::KW_IF; break;
+                case 'd': if (text == "do") return TokenKind::KW_DO; break;
+            }
+            break;
+        case 3:
+            switch (text[0]) {
+                case 'f': if (text == "for") return TokenKind::KW_FOR; break;
+                case 'i': if (text == "int") return TokenKind::KW_INT; break;
+            }
+            break;
+        case 4:
+            switch (text[0]) {
+                case 'b': if (text == "bool") return TokenKind::KW_BOOL; break;
+                case 'c': if (text == "char") return TokenKind::KW_CHAR; break;
+                case 'e':
+                    if (text == "else") return TokenKind::KW_ELSE;
+                    if (text == "enum") return TokenKind::KW_ENUM;
+                    break;
+                case 'l': if (text == "long") return TokenKind::KW_LONG; break;
+                case 'n': if (text == "null") return TokenKind::KW_NULL; break;
+                case 't': if (text == "true") return TokenKind::KW_TRUE; break;
+                case 'v': if (text == "void") return TokenKind::KW_VOID; break;
+            }
+            break;
+        case 5:
+            switch (text[0]) {
+                case 'b': if (text == "break") return TokenKind::KW_BREAK; break;
+                case 'c': if (text == "const") return TokenKind::KW_CONST; break;
+                case 'f':
+                    if (text == "float") return TokenKind::KW_FLOAT;
+                    if (text == "false") return TokenKind::KW_FALSE;
+                    break;
+                case 's': if (text == "short") return TokenKind::KW_SHORT; break;
+                case 'w': if (text == "while") return TokenKind::KW_WHILE; break;
+            }
+            break;
+        case 6:
+            switch (text[0]) {
+                case 'd': if (text == "double") return TokenKind::KW_DOUBLE; break;
+                case 'r': if (text == "return") return TokenKind::KW_RETURN; break;
+                case 's': if (text == "struct") return TokenKind::KW_STRUCT; break;
+            }
+            break;
+        case 8:
+            switch (text[0]) {
+                case 'c': if (text == "continue") return TokenKind::KW_CONTINUE; break;
+                case 'u': if (text == "unsigned") return TokenKind::KW_UNSIGNED; break;
+            }
+            break;
+    }
+    
+    return TokenKind::IDENTIFIER;
+}
 
 /**
  * Constructor - Initialize the lexer with source code
  */
 Lexer::Lexer(const std::string& source_code, const std::string& filename)
-    : source_(source_code),
-      filename_(filename),
+    : Lexer(SourceBuffer::FromString(source_code, filename)) {
+}
+
+/**
+ * Constructor - Initialize the lexer over an existing source buffer
+ */
+Lexer::Lexer(std::shared_ptr<const SourceBuffer> buffer)
+    : buffer_(std::move(buffer)),
+      source_(buffer_->GetText()),
       current_pos_(0),
       line_(1),
       column_(1),
-      peeked_token_(false) {
+      peeked_token_(false),
+      diag_reporter_(nullptr) {
 }
 
 /**
@@ -64,7 +114,7 @@ Token Lexer::GetNextToken() {
     SkipWhitespaceAndComments();
     
     if (current_pos_ >= source_.size()) {
-        return CreateToken(TokenKind::END_OF_FILE, "");
+        return CreateToken(TokenKind::END_OF_FILE, source_.substr(source_.size()));
     }
     
     char c = source_[current_pos_];
@@ -109,53 +159,30 @@ Token Lexer::PeekNextToken() {
  */
 void Lexer::SkipWhitespaceAndComments() {
     while (current_pos_ < source_.size()) {
-        char c = source_[current_pos_];
-        
         // Skip whitespace
-        if (std::isspace(c)) {
-            if (c == '\n') {
-                line_++;
-                column_ = 1;
-            } else {
-                column_++;
-            }
-            current_pos_++;
-            continue;
+        AdvanceTo(FindNonWhitespace(source_, current_pos_));
+        
+        if (current_pos_ + 1 >= source_.size() || source_[current_pos_] != '/') {
+            break;
         }
         
-        // Skip single-line comment
-        if (c == '/' && current_pos_ + 1 < source_.size() && source_[current_pos_ + 1] == '/') {
-            current_pos_ += 2;
-            column_ += 2;
-            
-            while (current_pos_ < source_.size() && source_[current_pos_] != '\n') {
-                current_pos_++;
-                column_++;
-            }
+        // Skip single-line comment, leaving the newline as whitespace
+        if (source_[current_pos_ + 1] == '/') {
+            size_t end = FindLineEnd(source_, current_pos_ + 2);
+            column_ += end - current_pos_;
+            current_pos_ = end;
             continue;
         }
         
         // Skip multi-line comment
-        if (c == '/' && current_pos_ + 1 < source_.size() && source_[current_pos_ + 1] == '*') {
-            current_pos_ += 2;
-            column_ += 2;
+        if (source_[current_pos_ + 1] == '*') {
+            size_t end = FindBlockCommentEnd(source_, current_pos_ + 2);
             
-            while (current_pos_ + 1 < source_.size() &&
-                   !(source_[current_pos_] == '*' && source_[current_pos_ + 1] == '/')) {
-                if (source_[current_pos_] == '\n') {
-                    line_++;
-                    column_ = 1;
-                } else {
-                    column_++;
-                }
-                current_pos_++;
-            }
-            
-            if (current_pos_ + 1 < source_.size()) {
-                current_pos_ += 2;  // Skip */
-                column_ += 2;
+            if (end < source_.size()) {
+                AdvanceTo(end + 2);  // Skip */
             } else {
                 // End of file in multi-line comment
+                AdvanceTo(end);
                 ReportError("Unterminated multi-line comment");
             }
             continue;
@@ -166,6 +193,22 @@ void Lexer::SkipWhitespaceAndComments() {
     }
 }
 
+/**
+ * AdvanceTo - Move forward to a position, updating the line and column
+ */
+void Lexer::AdvanceTo(size_t pos) {
+    size_t last_newline = 0;
+    size_t newlines = CountNewlines(source_, current_pos_, pos, &last_newline);
+    
+    if (newlines > 0) {
+        line_ += newlines;
+        column_ = pos - last_newline;
+    } else {
+        column_ += pos - current_pos_;
+    }
+    current_pos_ = pos;
+}
+
 /**
  * ScanIdentifierOrKeyword - Scan an identifier or keyword from the input
  */
@@ -173,22 +216,19 @@ Token Lexer::ScanIdentifierOrKeyword() {
     size_t start_pos = current_pos_;
     unsigned start_column = column_;
     
-    while (current_pos_ < source_.size() &&
-           (std::isalnum(source_[current_pos_]) || source_[current_pos_] == '_')) {
-        current_pos_++;
-        column_++;
-    }
+    current_pos_ = FindIdentifierEnd(source_, current_pos_);
+    column_ += current_pos_ - start_pos;
     
-    std::string lexeme = source_.substr(start_pos, current_pos_ - start_pos);
+    std::string_view lexeme = source_.substr(start_pos, current_pos_ - start_pos);
     
     // Check if it's a keyword
-    auto it = keywords.find(lexeme);
-    if (it != keywords.end()) {
-        return Token(it->second, lexeme, lexeme, line_, start_column);
+    TokenKind kind = LookupKeyword(lexeme);
+    if (kind != TokenKind::IDENTIFIER) {
+        return Token(kind, lexeme, line_, start_column);
     }
     
     // It's an identifier
-    return Token(TokenKind::IDENTIFIER, lexeme, lexeme, line_, start_column);
+    return Token(Symbol::Intern(lexeme), lexeme, line_, start_column);
 }
 
 /**
@@ -268,10 +308,10 @@ Token Lexer::ScanNumber() {
         }
     }
     
-    std::string lexeme = source_.substr(start_pos, current_pos_ - start_pos);
+    std::string_view lexeme = source_.substr(start_pos, current_pos_ - start_pos);
     TokenKind kind = is_float ? TokenKind::FLOAT_LITERAL : TokenKind::INT_LITERAL;
     
-    return Token(kind, lexeme, lexeme, line_, start_column);
+    return Token(kind, lexeme, line_, start_column);
 }
 
 /**
@@ -280,7 +320,6 @@ Token Lexer::ScanNumber() {
 Token Lexer::ScanString() {
     size_t start_pos = current_pos_;
     unsigned start_column = column_;
-    std::string value;
     
     current_pos_++;  // Skip "
     column_++;
@@ -298,18 +337,14 @@ Token Lexer::ScanString() {
             column_++;
             c = source_[current_pos_];
             
+            // Escapes are only validated here; Token::GetValue decodes them
             switch (c) {
-                case 'n': value += '\n'; break;
-                case 'r': value += '\r'; break;
-                case 't': value += '\t'; break;
-                case '\\': value += '\\'; break;
-                case '"': value += '"'; break;
-                case '\'': value += '\''; break;
+                case 'n': case 'r': case 't':
+                case '\\': case '"': case '\'':
+                    break;
                 default:
                     ReportError("Invalid escape sequence in string literal");
             }
-        } else {
-            value += c;
         }
         
         current_pos_++;
@@ -323,8 +358,8 @@ Token Lexer::ScanString() {
     current_pos_++;  // Skip closing "
     column_++;
     
-    std::string lexeme = source_.substr(start_pos, current_pos_ - start_pos);
-    return Token(TokenKind::STRING_LITERAL, lexeme, value, line_, start_column);
+    std::string_view lexeme = source_.substr(start_pos, current_pos_ - start_pos);
+    return Token(TokenKind::STRING_LITERAL, lexeme, line_, start_column);
 }
 
 /**
@@ -333,7 +368,6 @@ Token Lexer::ScanString() {
 Token Lexer::ScanChar() {
     size_t start_pos = current_pos_;
     unsigned start_column = column_;
-    char value;
     
     current_pos_++;  // Skip '
     column_++;
@@ -351,20 +385,15 @@ Token Lexer::ScanChar() {
             ReportError("Unterminated character literal");
         }
         
+        // Escapes are only validated here; Token::GetValue decodes them
         char c = source_[current_pos_];
         switch (c) {
-            case 'n': value = '\n'; break;
-            case 'r': value = '\r'; break;
-            case 't': value = '\t'; break;
-            case '\\': value = '\\'; break;
-            case '\'': value = '\''; break;
-            case '"': value = '"'; break;
+            case 'n': case 'r': case 't':
+            case '\\': case '\'': case '"':
+                break;
             default:
                 ReportError("Invalid escape sequence in character literal");
-                value = c;  // Default value
         }
-    } else {
-        value = source_[current_pos_];
     }
     
     current_pos_++;  // Skip character
@@ -377,8 +406,8 @@ Token Lexer::ScanChar() {
     current_pos_++;  // Skip closing '
     column_++;
     
-    std::string lexeme = source_.substr(start_pos, current_pos_ - start_pos);
-    return Token(TokenKind::CHAR_LITERAL, lexeme, std::string(1, value), line_, start_column);
+    std::string_view lexeme = source_.substr(start_pos, current_pos_ - start_pos);
+    return Token(TokenKind::CHAR_LITERAL, lexeme, line_, start_column);
 }
 
 /**
@@ -398,200 +427,212 @@ Token Lexer::ScanOperatorOrPunctuation() {
                 if (source_[current_pos_] == '+') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::PLUS_PLUS, "++", "++", line_, start_column);
+                    return MakeToken(TokenKind::PLUS_PLUS, start_pos, start_column);
                 } else if (source_[current_pos_] == '=') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::PLUS_EQUAL, "+=", "+=", line_, start_column);
+                    return MakeToken(TokenKind::PLUS_EQUAL, start_pos, start_column);
                 }
             }
-            return Token(TokenKind::PLUS, "+", "+", line_, start_column);
+            return MakeToken(TokenKind::PLUS, start_pos, start_column);
         
         case '-':
             if (current_pos_ < source_.size()) {
                 if (source_[current_pos_] == '-') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::MINUS_MINUS, "--", "--", line_, start_column);
+                    return MakeToken(TokenKind::MINUS_MINUS, start_pos, start_column);
                 } else if (source_[current_pos_] == '=') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::MINUS_EQUAL, "-=", "-=", line_, start_column);
+                    return MakeToken(TokenKind::MINUS_EQUAL, start_pos, start_column);
                 } else if (source_[current_pos_] == '>') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::ARROW, "->", "->", line_, start_column);
+                    return MakeToken(TokenKind::ARROW, start_pos, start_column);
                 }
             }
-            return Token(TokenKind::MINUS, "-", "-", line_, start_column);
+            return MakeToken(TokenKind::MINUS, start_pos, start_column);
         
         case '*':
             if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                 current_pos_++;
                 column_++;
-                return Token(TokenKind::STAR_EQUAL, "*=", "*=", line_, start_column);
+                return MakeToken(TokenKind::STAR_EQUAL, start_pos, start_column);
             }
-            return Token(TokenKind::STAR, "*", "*", line_, start_column);
+            return MakeToken(TokenKind::STAR, start_pos, start_column);
         
         case '/':
             if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                 current_pos_++;
                 column_++;
-                return Token(TokenKind::SLASH_EQUAL, "/=", "/=", line_, start_column);
+                return MakeToken(TokenKind::SLASH_EQUAL, start_pos, start_column);
             }
-            return Token(TokenKind::SLASH, "/", "/", line_, start_column);
+            return MakeToken(TokenKind::SLASH, start_pos, start_column);
         
         case '%':
             if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                 current_pos_++;
                 column_++;
-                return Token(TokenKind::PERCENT_EQUAL, "%=", "%=", line_, start_column);
+                return MakeToken(TokenKind::PERCENT_EQUAL, start_pos, start_column);
             }
-            return Token(TokenKind::PERCENT, "%", "%", line_, start_column);
+            return MakeToken(TokenKind::PERCENT, start_pos, start_column);
         
         case '&':
             if (current_pos_ < source_.size()) {
                 if (source_[current_pos_] == '&') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::AMP_AMP, "&&", "&&", line_, start_column);
+                    return MakeToken(TokenKind::AMP_AMP, start_pos, start_column);
                 } else if (source_[current_pos_] == '=') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::AMP_EQUAL, "&=", "&=", line_, start_column);
+                    return MakeToken(TokenKind::AMP_EQUAL, start_pos, start_column);
                 }
             }
-            return Token(TokenKind::AMP, "&", "&", line_, start_column);
+            return MakeToken(TokenKind::AMP, start_pos, start_column);
         
         case '|':
             if (current_pos_ < source_.size()) {
                 if (source_[current_pos_] == '|') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::PIPE_PIPE, "||", "||", line_, start_column);
+                    return MakeToken(TokenKind::PIPE_PIPE, start_pos, start_column);
                 } else if (source_[current_pos_] == '=') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::PIPE_EQUAL, "|=", "|=", line_, start_column);
+                    return MakeToken(TokenKind::PIPE_EQUAL, start_pos, start_column);
                 }
             }
-            return Token(TokenKind::PIPE, "|", "|", line_, start_column);
+            return MakeToken(TokenKind::PIPE, start_pos, start_column);
         
         case '^':
             if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                 current_pos_++;
                 column_++;
-                return Token(TokenKind::CARET_EQUAL, "^=", "^=", line_, start_column);
+                return MakeToken(TokenKind::CARET_EQUAL, start_pos, start_column);
             }
-            return Token(TokenKind::CARET, "^", "^", line_, start_column);
+            return MakeToken(TokenKind::CARET, start_pos, start_column);
         
         case '~':
-            return Token(TokenKind::TILDE, "~", "~", line_, start_column);
+            return MakeToken(TokenKind::TILDE, start_pos, start_column);
         
         case '!':
             if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                 current_pos_++;
                 column_++;
-                return Token(TokenKind::BANG_EQUAL, "!=", "!=", line_, start_column);
+                return MakeToken(TokenKind::BANG_EQUAL, start_pos, start_column);
             }
-            return Token(TokenKind::BANG, "!", "!", line_, start_column);
+            return MakeToken(TokenKind::BANG, start_pos, start_column);
         
         case '=':
             if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                 current_pos_++;
                 column_++;
-                return Token(TokenKind::EQUAL_EQUAL, "==", "==", line_, start_column);
+                return MakeToken(TokenKind::EQUAL_EQUAL, start_pos, start_column);
             }
-            return Token(TokenKind::EQUAL, "=", "=", line_, start_column);
+            return MakeToken(TokenKind::EQUAL, start_pos, start_column);
         
         case '<':
             if (current_pos_ < source_.size()) {
                 if (source_[current_pos_] == '=') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::LESS_EQUAL, "<=", "<=", line_, start_column);
+                    return MakeToken(TokenKind::LESS_EQUAL, start_pos, start_column);
                 } else if (source_[current_pos_] == '<') {
                     current_pos_++;
                     column_++;
                     if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                         current_pos_++;
                         column_++;
-                        return Token(TokenKind::LESS_LESS_EQUAL, "<<=", "<<=", line_, start_column);
+                        return MakeToken(TokenKind::LESS_LESS_EQUAL, start_pos, start_column);
                     }
-                    return Token(TokenKind::LESS_LESS, "<<", "<<", line_, start_column);
+                    return MakeToken(TokenKind::LESS_LESS, start_pos, start_column);
                 }
             }
-            return Token(TokenKind::LESS, "<", "<", line_, start_column);
+            return MakeToken(TokenKind::LESS, start_pos, start_column);
         
         case '>':
             if (current_pos_ < source_.size()) {
                 if (source_[current_pos_] == '=') {
                     current_pos_++;
                     column_++;
-                    return Token(TokenKind::GREATER_EQUAL, ">=", ">=", line_, start_column);
+                    return MakeToken(TokenKind::GREATER_EQUAL, start_pos, start_column);
                 } else if (source_[current_pos_] == '>') {
                     current_pos_++;
                     column_++;
                     if (current_pos_ < source_.size() && source_[current_pos_] == '=') {
                         current_pos_++;
                         column_++;
-                        return Token(TokenKind::GREATER_GREATER_EQUAL, ">>=", ">>=", line_, start_column);
+                        return MakeToken(TokenKind::GREATER_GREATER_EQUAL, start_pos, start_column);
                     }
-                    return Token(TokenKind::GREATER_GREATER, ">>", ">>", line_, start_column);
+                    return MakeToken(TokenKind::GREATER_GREATER, start_pos, start_column);
                 }
             }
-            return Token(TokenKind::GREATER, ">", ">", line_, start_column);
+            return MakeToken(TokenKind::GREATER, start_pos, start_column);
         
         case '.':
-            return Token(TokenKind::DOT, ".", ".", line_, start_column);
+            return MakeToken(TokenKind::DOT, start_pos, start_column);
         
         case ',':
-            return Token(TokenKind::COMMA, ",", ",", line_, start_column);
+            return MakeToken(TokenKind::COMMA, start_pos, start_column);
         
         case ';':
-            return Token(TokenKind::SEMICOLON, ";", ";", line_, start_column);
+            return MakeToken(TokenKind::SEMICOLON, start_pos, start_column);
         
         case ':':
-            return Token(TokenKind::COLON, ":", ":", line_, start_column);
+            return MakeToken(TokenKind::COLON, start_pos, start_column);
         
         case '?':
-            return Token(TokenKind::QUESTION, "?", "?", line_, start_column);
+            return MakeToken(TokenKind::QUESTION, start_pos, start_column);
         
         case '(':
-            return Token(TokenKind::LEFT_PAREN, "(", "(", line_, start_column);
+            return MakeToken(TokenKind::LEFT_PAREN, start_pos, start_column);
         
         case ')':
-            return Token(TokenKind::RIGHT_PAREN, ")", ")", line_, start_column);
+            return MakeToken(TokenKind::RIGHT_PAREN, start_pos, start_column);
         
         case '[':
-            return Token(TokenKind::LEFT_BRACKET, "[", "[", line_, start_column);
+            return MakeToken(TokenKind::LEFT_BRACKET, start_pos, start_column);
         
         case ']':
-            return Token(TokenKind::RIGHT_BRACKET, "]", "]", line_, start_column);
+            return MakeToken(TokenKind::RIGHT_BRACKET, start_pos, start_column);
         
         case '{':
-            return Token(TokenKind::LEFT_BRACE, "{", "{", line_, start_column);
+            return MakeToken(TokenKind::LEFT_BRACE, start_pos, start_column);
         
         case '}':
-            return Token(TokenKind::RIGHT_BRACE, "}", "}", line_, start_column);
+            return MakeToken(TokenKind::RIGHT_BRACE, start_pos, start_column);
         
         default:
-            return Token(TokenKind::UNKNOWN, std::string(1, c), std::string(1, c), line_, start_column);
+            return Token(TokenKind::UNKNOWN, source_.substr(start_pos, 1), line_, start_column);
     }
 }
 
+/**
+ * MakeToken - Create a token spanning from a start position to the current one
+ */
+Token Lexer::MakeToken(TokenKind kind, size_t start_pos, unsigned start_column) {
+    return Token(kind, source_.substr(start_pos, current_pos_ - start_pos), line_, start_column);
+}
+
 /**
  * CreateToken - Create a token with the current line and column
  */
-Token Lexer::CreateToken(TokenKind kind, const std::string& lexeme) {
-    return Token(kind, lexeme, lexeme, line_, column_ - lexeme.size());
+Token Lexer::CreateToken(TokenKind kind, std::string_view lexeme) {
+    return Token(kind, lexeme, line_, column_ - lexeme.size());
 }
 
 /**
  * ReportError - Report a lexical error
  */
 void Lexer::ReportError(const std::string& message) {
-    std::cerr << filename_ << ":" << line_ << ":" << column_ << ": error: " << message << std::endl;
+    if (diag_reporter_) {
+        diag_reporter_->ReportError(message, GetFilename(), line_, column_);
+        return;
+    }
+    
+    std::cerr << GetFilename() << ":" << line_ << ":" << column_ << ": error: " << message << std::endl;
     
     // Find the start of the current line
     size_t line_start = current_pos_;
@@ -9,15 +9,25 @@
 #define DSLANG_LEXER_H
 
 #include "token.h"
+#include "source.h"
+#include <memory>
 #include <string>
+#include <string_view>
 
 namespace dsLang {
 
+class DiagnosticReporter;
+
 /**
  * Lexer - Lexical analyzer for dsLang
  * 
  * The lexer converts source code text into a sequence of tokens. It provides
  * methods to get the next token and peek at the next token without consuming it.
+ * 
+ * The lexer never copies token text: every token's lexeme is a slice of the
+ * SourceBuffer being lexed, which the lexer keeps alive. Callers that hold on
+ * to tokens past the lexer's lifetime must keep the buffer alive themselves
+ * (see GetSourceBuffer()).
  */
 class Lexer {
 public:
@@ -29,6 +39,16 @@ public:
      */
     Lexer(const std::string& source_code, const std::string& filename);
     
+    /**
+     * Constructor - Initialize the lexer over an existing source buffer
+     * 
+     * This is the zero-copy path: use SourceBuffer::OpenFile to memory-map
+     * the input and tokens will point directly into the mapping.
+     * 
+     * @param buffer The source buffer to tokenize
+     */
+    explicit Lexer(std::shared_ptr<const SourceBuffer> buffer);
+    
     /**
      * GetNextToken - Get the next token from the input
      * 
@@ -48,7 +68,23 @@ public:
      * 
      * @return The source filename
      */
-    const std::string& GetFilename() const { return filename_; }
+    const std::string& GetFilename() const { return buffer_->GetName(); }
+    
+    /**
+     * GetSourceBuffer - Get the buffer that token lexemes point into
+     * 
+     * @return The source buffer
+     */
+    const std::shared_ptr<const SourceBuffer>& GetSourceBuffer() const { return buffer_; }
+    
+    /**
+     * SetDiagnosticReporter - Send lexical errors to a reporter
+     * 
+     * Without a reporter, errors are printed straight to stderr.
+     * 
+     * @param diag_reporter The reporter, or nullptr
+     */
+    void SetDiagnosticReporter(DiagnosticReporter* diag_reporter) { diag_reporter_ = diag_reporter; }
     
 private:
     /**
@@ -56,6 +92,13 @@ private:
      */
     void SkipWhitespaceAndComments();
     
+    /**
+     * AdvanceTo - Move forward to a position, updating the line and column
+     * 
+     * @param pos The new position, at or after the current one
+     */
+    void AdvanceTo(size_t pos);
+    
     /**
      * ScanIdentifierOrKeyword - Scan an identifier or keyword from the input
      * 
@@ -98,7 +141,17 @@ private:
      * @param lexeme The lexeme (exact text in source)
      * @return The created token
      */
-    Token CreateToken(TokenKind kind, const std::string& lexeme);
+    Token CreateToken(TokenKind kind, std::string_view lexeme);
+    
+    /**
+     * MakeToken - Create a token spanning from a start position to the current one
+     * 
+     * @param kind The token kind
+     * @param start_pos The position of the token's first byte
+     * @param start_column The column of the token's first byte
+     * @return The created token
+     */
+    Token MakeToken(TokenKind kind, size_t start_pos, unsigned start_column);
     
     /**
      * ReportError - Report a lexical error
@@ -108,13 +161,14 @@ private:
     void ReportError(const std::string& message);
     
 private:
-    std::string source_;        // The source code
-    std::string filename_;      // The source filename
+    std::shared_ptr<const SourceBuffer> buffer_; // Owner of the source text
+    std::string_view source_;   // The source code
     size_t current_pos_;        // Current position in the source
     unsigned line_;             // Current line number
     unsigned column_;           // Current column number
     bool peeked_token_;         // Whether we have peeked at a token
     Token next_token_;          // The next token (for peeking)
+    DiagnosticReporter* diag_reporter_; // Receives errors, if set
 };
 
 } // namespace dsLang
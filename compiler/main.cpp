@@ -1,3 +1,4 @@
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <sstream>
@@ -6,63 +7,414 @@
 #include <memory>
 #include <cstring>
 #include <cerrno>
+#include <cstdlib>
+#include <filesystem>
 
-// For LLVM include errors, we'll comment these out for now
-// and fix the include paths later
-// #include "llvm/IR/LLVMContext.h"
-// #include "llvm/IR/Module.h"
-// #include "llvm/IR/IRBuilder.h"
-// #include "llvm/IR/Verifier.h"
-// #include "llvm/Support/TargetSelect.h"
-// #include "llvm/Support/FileSystem.h"
-// #include "llvm/Support/raw_ostream.h"
-// #include "llvm/Target/TargetMachine.h"
-// #include "llvm/Target/TargetOptions.h"
-// #include "llvm/MC/TargetRegistry.h"
-// #include "llvm/Support/TargetSelect.h"
-// #include "llvm/IR/LegacyPassManager.h"
-
+#include "cache.h"
 #include "diagnostic.h"
+#include "jit.h"
+#include "source.h"
 #include "lexer.h"
 #include "parser.h"
 #include "ast.h"
 #include "codegen.h"
 #include "sema.h"
+#include "server.h"
+#include "shard.h"
+#include "threadpool.h"
+#include "timing.h"
+#include "tokenbuffer.h"
+#include "version.h"
 
 // Display usage information
 void printUsage(const char* progName) {
     std::cerr << "dsLang Compiler (dscc) - Cross compiler for dsOS\n\n";
-    std::cerr << "Usage: " << progName << " [options] input_file\n";
+    std::cerr << "Usage: " << progName << " [options] input_file...\n";
     std::cerr << "Options:\n";
-    std::cerr << "  -o <file>     Specify output file name\n";
+    std::cerr << "  -o <file>     Specify output file name (single input only)\n";
     std::cerr << "  -S            Output assembly code\n";
     std::cerr << "  -c            Output object file (default)\n";
     std::cerr << "  -O<level>     Optimization level (0-3)\n";
+    std::cerr << "  -j <n>        Compile up to n files in parallel (default: one per CPU)\n";
+    std::cerr << "  --codegen-shards=<n>\n";
+    std::cerr << "                Split each file's functions across n threads, writing\n";
+    std::cerr << "                one output per shard (<name>.part<k>.o)\n";
+    std::cerr << "  --run         Compile a program for this machine and run it in-process,\n";
+    std::cerr << "                exiting with its return value (single input only). The\n";
+    std::cerr << "                entry must return int or void\n";
+    std::cerr << "  --entry=<name>\n";
+    std::cerr << "                Function --run calls (default: main, else kernel_main)\n";
+    std::cerr << "  --jit-hot-calls=<n>\n";
+    std::cerr << "                With --run, functions are compiled at -O0 on first call and\n";
+    std::cerr << "                recompiled at -O2 (or the -O level, if higher) after n calls\n";
+    std::cerr << "                (default: 1000)\n";
+    std::cerr << "  --jit-eager   With --run, compile the whole program at the -O level up front\n";
+    std::cerr << "  --server      Stay resident and serve JSON requests on stdin/stdout; takes\n";
+    std::cerr << "                no other options, as requests carry their own settings\n";
+    std::cerr << "  --cache       Reuse outputs of earlier identical compiles and the code\n";
+    std::cerr << "                of unchanged functions\n";
+    std::cerr << "  --cache-dir=<dir>\n";
+    std::cerr << "                Cache directory (implies --cache; default: $DSCC_CACHE_DIR,\n";
+    std::cerr << "                else $XDG_CACHE_HOME/dscc, else ~/.cache/dscc)\n";
+    std::cerr << "  --cache-max-size=<mb>\n";
+    std::cerr << "                Evict least recently used outputs beyond this size (default: 1024)\n";
+    std::cerr << "  --cache-stats Print cache statistics and exit\n";
+    std::cerr << "  -ftime-report Print the time spent in each phase, function and LLVM pass\n";
+    std::cerr << "  -ftime-report-json=<file>\n";
+    std::cerr << "                Write the time report as JSON ('-' for stdout)\n";
+    std::cerr << "  -fmem-report  Add heap usage to the time report; compiles one file\n";
+    std::cerr << "                at a time\n";
+    std::cerr << "  -ftime-trace[=<file>]\n";
+    std::cerr << "                Write a Chrome trace-event timeline of the compile (default:\n";
+    std::cerr << "                the output file with a .json extension, or dscc-trace.json)\n";
+    std::cerr << "  -ftime-trace-granularity=<us>\n";
+    std::cerr << "                Leave spans shorter than this out of the timeline (default: 500)\n";
+    std::cerr << "                The report and trace options cannot be combined with --run\n";
+    std::cerr << "  --version     Display the compiler version\n";
     std::cerr << "  -v            Verbose output\n";
     std::cerr << "  -h, --help    Display this help message\n";
 }
 
-// Read file content into a string
-std::string readFile(const std::string& filename) {
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        std::cerr << "Error opening file '" << filename << "': " << strerror(errno) << std::endl;
-        return "";
+// Options shared by every file of one invocation
+struct CompileOptions {
+    bool outputAssembly = false;
+    bool verbose = false;
+    unsigned optLevel = 0;
+    unsigned codegenShards = 1;
+    dsLang::CompileCache* cache = nullptr;
+};
+
+// Map a source file into memory for zero-copy lexing
+std::shared_ptr<dsLang::SourceBuffer> openSource(const std::string& filename) {
+    std::string error;
+    auto buffer = dsLang::SourceBuffer::OpenFile(filename, &error);
+    if (!buffer) {
+        std::cerr << "Error opening file '" << filename << "': " << error << std::endl;
+    }
+    return buffer;
+}
+
+// Replace a filename's extension, or append one if it has none
+std::string replaceExtension(const std::string& filename, const std::string& extension) {
+    size_t dotPos = filename.find_last_of('.');
+    size_t slashPos = filename.find_last_of('/');
+    if (dotPos != std::string::npos && (slashPos == std::string::npos || dotPos > slashPos)) {
+        return filename.substr(0, dotPos) + extension;
+    }
+    return filename + extension;
+}
+
+// Derive the default output name by replacing the input's extension
+std::string defaultOutputFilename(const std::string& inputFilename, bool outputAssembly) {
+    return replaceExtension(inputFilename, outputAssembly ? ".s" : ".o");
+}
+
+// Identify this build of the compiler for cache keys, so that a rebuilt
+// dscc never reuses outputs of the previous one
+std::string compilerIdentity(const char* argv0) {
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::path exe = fs::read_symlink("/proc/self/exe", ec);
+    if (ec) {
+        exe = argv0;
+    }
+    
+    std::ostringstream identity;
+    identity << fs::file_size(exe, ec);
+    identity << ":" << fs::last_write_time(exe, ec).time_since_epoch().count();
+    return identity.str();
+}
+
+// Map and tokenize a source file up front; tokens refer directly into the
+// mapped buffer. Returns null if the file cannot be read.
+std::unique_ptr<dsLang::TokenBuffer> lexFile(const std::string& inputFilename,
+                                             dsLang::DiagnosticReporter& diagReporter,
+                                             dsLang::TimeReport* report) {
+    dsLang::ScopedTimer timer(report, "Lexing");
+    std::shared_ptr<dsLang::SourceBuffer> source = openSource(inputFilename);
+    if (!source) {
+        return nullptr;
+    }
+    
+    dsLang::Lexer lexer(source);
+    lexer.SetDiagnosticReporter(&diagReporter);
+    return dsLang::TokenBuffer::Tokenize(lexer);
+}
+
+// Parse and analyze a file's tokens. Returns null, after the diagnostics
+// have been printed, if the program has errors.
+std::unique_ptr<dsLang::CompilationUnit> analyzeTokens(const std::string& inputFilename,
+                                                       const dsLang::TokenBuffer& tokens,
+                                                       dsLang::TypeContext& types,
+                                                       dsLang::DiagnosticReporter& diagReporter,
+                                                       const CompileOptions& options,
+                                                       std::ostream& log,
+                                                       dsLang::TimeReport* report) {
+    // Parse the tokens
+    std::unique_ptr<dsLang::CompilationUnit> program;
+    {
+        dsLang::ScopedTimer timer(report, "Parsing");
+        dsLang::Parser parser(tokens, diagReporter, types);
+        program = parser.Parse();
+    }
+    
+    // Check if there were any errors during parsing
+    if (diagReporter.HasErrors()) {
+        std::cerr << inputFilename << ": error: parsing failed with errors\n";
+        return nullptr;
+    }
+    
+    if (options.verbose) {
+        log << "Parsing completed successfully\n";
+    }
+    
+    // Perform semantic analysis
+    {
+        dsLang::ScopedTimer timer(report, "Semantic analysis");
+        auto semanticAnalyzer = dsLang::CreateSemanticAnalyzer(diagReporter);
+        semanticAnalyzer->Analyze(program.get());
+    }
+    
+    // Check if there were any errors during semantic analysis
+    if (diagReporter.HasErrors()) {
+        std::cerr << inputFilename << ": error: semantic analysis failed with errors\n";
+        return nullptr;
+    }
+    
+    if (options.verbose) {
+        log << "Semantic analysis completed successfully\n";
+    }
+    return program;
+}
+
+// Compile one source file to one output file
+//
+// Everything a compile touches (diagnostics, types, AST, LLVM context) is
+// created here, so any number of these can run on different threads at
+// once. Verbose progress goes to `log` so the caller can print it in input
+// order; diagnostics are printed as they are reported.
+//
+// `report`, if not null, receives the time spent in each phase.
+bool compileFile(const std::string& inputFilename, const std::string& outputFilename,
+                 const CompileOptions& options, std::ostream& log, dsLang::TimeReport* report) {
+    dsLang::ScopedTimer totalTimer(report, "Total");
+    
+    if (options.verbose) {
+        log << "Input file: " << inputFilename << "\n";
+        log << "Output file: " << outputFilename << "\n";
+        log << "Optimization level: " << options.optLevel << "\n";
+    }
+    
+    // Create diagnostic reporter for error messages
+    dsLang::DiagnosticReporter diagReporter;
+    
+    // The type context owns every type and must outlive the AST
+    dsLang::TypeContext types;
+    
+    // The tokens also key the cache
+    std::unique_ptr<dsLang::TokenBuffer> tokens = lexFile(inputFilename, diagReporter, report);
+    if (!tokens) {
+        return false;
+    }
+    
+    // Parse and check even when the output is cached, so that the same
+    // input always prints the same warnings
+    std::unique_ptr<dsLang::CompilationUnit> program =
+        analyzeTokens(inputFilename, *tokens, types, diagReporter, options, log, report);
+    if (!program) {
+        return false;
+    }
+    
+    // Reuse the output of an identical earlier compile. Sharded output is
+    // several files and is not cached.
+    std::string cacheKey;
+    if (options.cache && options.codegenShards == 1) {
+        dsLang::ScopedTimer timer(report, "Cache lookup");
+        cacheKey = options.cache->ComputeKey(inputFilename, *tokens, "x86_64-elf", options.optLevel,
+                                             options.outputAssembly ? "asm" : "obj");
+        if (options.cache->Retrieve(cacheKey, outputFilename)) {
+            if (options.verbose) {
+                log << "Output copied from cache to: " << outputFilename << "\n";
+            }
+            return true;
+        }
+    }
+    
+    // Split code generation across threads if requested
+    if (options.codegenShards > 1) {
+        std::vector<std::string> shardFilenames;
+        for (unsigned i = 0; i < options.codegenShards; i++) {
+            shardFilenames.push_back(dsLang::GetShardFilename(outputFilename, i));
+        }
+        
+        dsLang::ScopedTimer timer(report, "Parallel code generation");
+        if (!dsLang::EmitShards(program.get(), inputFilename, "x86_64-elf",
+                                shardFilenames, options.outputAssembly, options.optLevel)) {
+            std::cerr << inputFilename << ": error: parallel code generation failed\n";
+            return false;
+        }
+        
+        if (options.verbose) {
+            for (const auto& shardFilename : shardFilenames) {
+                log << "Output written to: " << shardFilename << "\n";
+            }
+        }
+        return true;
+    }
+    
+    // Generate LLVM IR; the generator owns this file's LLVMContext
+    dsLang::CodeGenerator codegen(inputFilename, "x86_64-elf", options.optLevel);
+    
+    // On a whole-file miss, still reuse the code of unchanged functions
+    if (options.cache) {
+        codegen.SetFunctionCache(options.cache);
+    }
+    codegen.SetTimeReport(report);
+    
+    if (!codegen.Generate(program.get())) {
+        return false;
+    }
+    
+    if (options.verbose) {
+        log << "Code generation completed successfully\n";
+    }
+    
+    // Emit the requested kind of output
+    bool written = options.outputAssembly ? codegen.EmitAssembly(outputFilename)
+                                          : codegen.EmitObject(outputFilename);
+    if (!written) {
+        std::cerr << inputFilename << ": error: could not write " << outputFilename << "\n";
+        return false;
+    }
+    
+    if (options.verbose) {
+        log << "Output written to: " << outputFilename << "\n";
+    }
+    
+    if (!cacheKey.empty()) {
+        options.cache->Store(cacheKey, outputFilename);
+    }
+    
+    return true;
+}
+
+// Find the function --run calls: the named one, or else main or the
+// kernel's entry point. It must be defined here and take no arguments.
+dsLang::FuncDecl* findEntry(dsLang::CompilationUnit* program, const std::string& entry) {
+    std::vector<std::string> candidates = {entry};
+    if (entry.empty()) {
+        candidates = {"main", "kernel_main"};
+    }
+    
+    for (const auto& candidate : candidates) {
+        for (auto decl : program->GetDecls()) {
+            auto func = dynamic_cast<dsLang::FuncDecl*>(decl);
+            if (func && func->GetBody() && func->GetName() == candidate && func->GetParams().empty()) {
+                return func;
+            }
+        }
+    }
+    return nullptr;
+}
+
+// Compile one source file for this machine and run its entry point in the
+// compiler process. Returns the entry's return value, or 1 if the program
+// could not be compiled or run.
+//
+// With `tiering`, functions are compiled as they are first called and hot
+// ones are recompiled while the program runs; otherwise the whole program
+// is compiled at the -O level before it starts.
+int runFile(const std::string& inputFilename, const std::string& entry, const CompileOptions& options,
+            const dsLang::TieringOptions* tiering) {
+    dsLang::DiagnosticReporter diagReporter;
+    dsLang::TypeContext types;
+    
+    std::unique_ptr<dsLang::TokenBuffer> tokens = lexFile(inputFilename, diagReporter, nullptr);
+    if (!tokens) {
+        return 1;
+    }
+    
+    std::unique_ptr<dsLang::CompilationUnit> program =
+        analyzeTokens(inputFilename, *tokens, types, diagReporter, options, std::cerr, nullptr);
+    if (!program) {
+        return 1;
+    }
+    
+    dsLang::FuncDecl* entryDecl = findEntry(program.get(), entry);
+    if (!entryDecl) {
+        std::cerr << inputFilename << ": error: no function "
+                  << (entry.empty() ? "'main' or 'kernel_main'" : "'" + entry + "'")
+                  << " taking no arguments to run\n";
+        return 1;
+    }
+    
+    // Only int and void results can become an exit status. The entry is
+    // called as int (*)(), and narrower results (bool, char, short) are not
+    // extended to 32 bits by the callee, so they are refused too.
+    dsLang::Type* returnType = static_cast<dsLang::FunctionType*>(entryDecl->GetType())->GetReturnType();
+    if (!returnType->IsVoid() && !returnType->IsInt()) {
+        std::cerr << inputFilename << ": error: '" << entryDecl->GetName()
+                  << "' must return int or void to be run\n";
+        return 1;
+    }
+    
+    std::string error;
+    std::unique_ptr<dsLang::JitSession> session = tiering
+        ? dsLang::JitSession::CreateLazy(*tiering, &error)
+        : dsLang::JitSession::Create(&error);
+    if (!session) {
+        std::cerr << "Error: could not start the JIT: " << error << "\n";
+        return 1;
+    }
+    
+    // The module calls the standard library of the host, not of dsOS. A
+    // lazy session wants it unoptimized.
+    dsLang::CodeGenerator codegen(inputFilename, dsLang::JitSession::GetHostTriple(),
+                                  tiering ? 0 : options.optLevel);
+    if (!codegen.Generate(program.get())) {
+        return 1;
+    }
+    
+    if (options.verbose) {
+        std::cerr << "Running " << entryDecl->GetName() << "\n";
+    }
+    
+    int result = 0;
+    if (!session->AddModule(codegen.TakeModule(), &error) ||
+        !session->Run(entryDecl->GetName(), !returnType->IsVoid(), &result, &error)) {
+        std::cerr << inputFilename << ": error: could not run program: " << error << "\n";
+        return 1;
     }
     
-    std::stringstream buffer;
-    buffer << file.rdbuf();
-    return buffer.str();
+    if (options.verbose && tiering) {
+        std::cerr << "Recompiled " << session->GetTierUpCount() << " hot functions at -O"
+                  << tiering->opt_level << "\n";
+    }
+    return result;
 }
 
 // Main compiler entry point
 int main(int argc, char** argv) {
     // Default values
-    std::string inputFilename;
-    std::string outputFilename = "a.out";
-    bool outputAssembly = false;
-    bool verbose = false;
-    int optLevel = 0;
+    std::vector<std::string> inputFilenames;
+    std::string outputFilename;
+    CompileOptions options;
+    size_t jobs = 0;
+    bool useCache = false;
+    bool printCacheStats = false;
+    std::string cacheDir;
+    uint64_t cacheMaxSize = 1024ull * 1024 * 1024;
+    bool timeReport = false;
+    bool memReport = false;
+    std::string timeReportJson;
+    bool timeTrace = false;
+    std::string timeTraceFile;
+    unsigned timeTraceGranularity = 500;
+    bool run = false;
+    std::string entry;
+    bool jitEager = false;
+    dsLang::TieringOptions tiering;
+    bool server = false;
     
     // Parse command line arguments
     for (int i = 1; i < argc; i++) {
@@ -72,15 +424,93 @@ int main(int argc, char** argv) {
             if (arg == "-o" && i + 1 < argc) {
                 outputFilename = argv[++i];
             } else if (arg == "-S") {
-                outputAssembly = true;
+                options.outputAssembly = true;
+            } else if (arg == "-c") {
+                options.outputAssembly = false;
             } else if (arg == "-v") {
-                verbose = true;
+                options.verbose = true;
             } else if (arg.substr(0, 2) == "-O") {
-                optLevel = std::stoi(arg.substr(2, 1));
+                int optLevel = std::stoi(arg.substr(2, 1));
                 if (optLevel < 0 || optLevel > 3) {
                     std::cerr << "Invalid optimization level. Using default (0).\n";
                     optLevel = 0;
                 }
+                options.optLevel = static_cast<unsigned>(optLevel);
+            } else if (arg.substr(0, 2) == "-j") {
+                // Accept both "-j 4" and "-j4"
+                std::string count = arg.size() > 2 ? arg.substr(2) : (i + 1 < argc ? argv[++i] : "");
+                char* end = nullptr;
+                long value = std::strtol(count.c_str(), &end, 10);
+                if (count.empty() || *end != '\0' || value < 1) {
+                    std::cerr << "Invalid job count: " << count << "\n";
+                    return 1;
+                }
+                jobs = static_cast<size_t>(value);
+            } else if (arg.compare(0, 17, "--codegen-shards=") == 0) {
+                std::string count = arg.substr(17);
+                char* end = nullptr;
+                long value = std::strtol(count.c_str(), &end, 10);
+                if (count.empty() || *end != '\0' || value < 1 || value > 256) {
+                    std::cerr << "Invalid shard count: " << count << "\n";
+                    return 1;
+                }
+                options.codegenShards = static_cast<unsigned>(value);
+            } else if (arg == "--run") {
+                run = true;
+            } else if (arg.compare(0, 8, "--entry=") == 0) {
+                entry = arg.substr(8);
+            } else if (arg.compare(0, 16, "--jit-hot-calls=") == 0) {
+                std::string count = arg.substr(16);
+                char* end = nullptr;
+                long value = std::strtol(count.c_str(), &end, 10);
+                if (count.empty() || *end != '\0' || value < 1 || value > 1000000000) {
+                    std::cerr << "Invalid hot call count: " << count << "\n";
+                    return 1;
+                }
+                tiering.hot_call_count = static_cast<uint32_t>(value);
+            } else if (arg == "--jit-eager") {
+                jitEager = true;
+            } else if (arg == "--server") {
+                server = true;
+            } else if (arg == "--cache") {
+                useCache = true;
+            } else if (arg.compare(0, 12, "--cache-dir=") == 0) {
+                useCache = true;
+                cacheDir = arg.substr(12);
+            } else if (arg.compare(0, 17, "--cache-max-size=") == 0) {
+                std::string size = arg.substr(17);
+                char* end = nullptr;
+                long value = std::strtol(size.c_str(), &end, 10);
+                if (size.empty() || *end != '\0' || value < 1) {
+                    std::cerr << "Invalid cache size: " << size << "\n";
+                    return 1;
+                }
+                cacheMaxSize = static_cast<uint64_t>(value) * 1024 * 1024;
+            } else if (arg == "--cache-stats") {
+                printCacheStats = true;
+            } else if (arg == "-ftime-report") {
+                timeReport = true;
+            } else if (arg.compare(0, 19, "-ftime-report-json=") == 0) {
+                timeReportJson = arg.substr(19);
+            } else if (arg == "-fmem-report") {
+                memReport = true;
+            } else if (arg == "-ftime-trace") {
+                timeTrace = true;
+            } else if (arg.compare(0, 13, "-ftime-trace=") == 0) {
+                timeTrace = true;
+                timeTraceFile = arg.substr(13);
+            } else if (arg.compare(0, 25, "-ftime-trace-granularity=") == 0) {
+                std::string granularity = arg.substr(25);
+                char* end = nullptr;
+                long value = std::strtol(granularity.c_str(), &end, 10);
+                if (granularity.empty() || *end != '\0' || value < 0) {
+                    std::cerr << "Invalid trace granularity: " << granularity << "\n";
+                    return 1;
+                }
+                timeTraceGranularity = static_cast<unsigned>(value);
+            } else if (arg == "--version") {
+                std::cout << "dscc " << DSLANG_VERSION << "\n";
+                return 0;
             } else if (arg == "-h" || arg == "--help") {
                 printUsage(argv[0]);
                 return 0;
@@ -91,163 +521,163 @@ int main(int argc, char** argv) {
             }
         } else {
             // Input filename
-            inputFilename = arg;
+            inputFilenames.push_back(arg);
         }
     }
     
-    // Check if input file was provided
-    if (inputFilename.empty()) {
-        std::cerr << "Error: No input file specified.\n";
-        printUsage(argv[0]);
-        return 1;
-    }
-    
-    // Set default output filename if not specified
-    if (outputFilename == "a.out") {
-        size_t dotPos = inputFilename.find_last_of('.');
-        if (dotPos != std::string::npos) {
-            outputFilename = inputFilename.substr(0, dotPos);
-        } else {
-            outputFilename = inputFilename;
-        }
-        
-        if (outputAssembly) {
-            outputFilename += ".s";
-        } else {
-            outputFilename += ".o";
+    // Serve editor requests until shutdown. Requests carry their own
+    // settings, so refuse options the server would silently ignore.
+    if (server) {
+        if (argc > 2) {
+            std::cerr << "Error: --server takes no other options or input files.\n";
+            return 1;
         }
+        return dsLang::CompileServer(std::cin, std::cout).Run();
     }
     
-    if (verbose) {
-        std::cout << "Input file: " << inputFilename << "\n";
-        std::cout << "Output file: " << outputFilename << "\n";
-        std::cout << "Optimization level: " << optLevel << "\n";
+    // The cache outlives every compile and flushes its statistics on exit
+    std::unique_ptr<dsLang::CompileCache> cache;
+    if (useCache || printCacheStats) {
+        cache = std::make_unique<dsLang::CompileCache>(
+            cacheDir.empty() ? dsLang::CompileCache::GetDefaultDirectory() : cacheDir,
+            cacheMaxSize, compilerIdentity(argv[0]));
+        options.cache = cache.get();
     }
     
-    // Read the input file
-    std::string sourceCode = readFile(inputFilename);
-    if (sourceCode.empty()) {
-        return 1;
+    if (printCacheStats) {
+        cache->PrintStats(std::cout);
+        return 0;
     }
     
-    // Comment out LLVM code for now until we fix include paths
-    /*
-    // Initialize LLVM targets
-    llvm::InitializeAllTargetInfos();
-    llvm::InitializeAllTargets();
-    llvm::InitializeAllTargetMCs();
-    llvm::InitializeAllAsmParsers();
-    llvm::InitializeAllAsmPrinters();
-    
-    // Create LLVM context and module
-    std::unique_ptr<llvm::LLVMContext> context = std::make_unique<llvm::LLVMContext>();
-    std::unique_ptr<llvm::Module> module = std::make_unique<llvm::Module>(inputFilename, *context);
-    
-    // Set target triple for x86-64 ELF (bare metal)
-    module->setTargetTriple("x86_64-elf");
-    */
-    
-    // Create diagnostic reporter for error messages
-    dsLang::DiagnosticReporter diagReporter;
-    
-    // Tokenize and parse the source code
-    dsLang::Lexer lexer(sourceCode, inputFilename);
-    dsLang::Parser parser(lexer, diagReporter);
-    std::shared_ptr<dsLang::CompilationUnit> program = parser.Parse();
-    
-    // Check if there were any errors during parsing
-    if (diagReporter.HasErrors()) {
-        std::cerr << "Error: Parsing failed with errors\n";
+    // Check if input files were provided
+    if (inputFilenames.empty()) {
+        std::cerr << "Error: No input file specified.\n";
+        printUsage(argv[0]);
         return 1;
     }
     
-    if (verbose) {
-        std::cout << "Parsing completed successfully\n";
+    // Run a program instead of writing output
+    if (run) {
+        if (inputFilenames.size() > 1) {
+            std::cerr << "Error: --run takes a single input file.\n";
+            return 1;
+        }
+        // Reports and traces are only gathered around compiles that write
+        // output, so refuse rather than silently drop them
+        if (timeReport || memReport || !timeReportJson.empty() || timeTrace) {
+            std::cerr << "Error: -ftime-report, -fmem-report and -ftime-trace cannot be used with --run.\n";
+            return 1;
+        }
+        tiering.opt_level = std::max(2u, options.optLevel);
+        return runFile(inputFilenames[0], entry, options, jitEager ? nullptr : &tiering);
     }
     
-    // Perform semantic analysis
-    auto semanticAnalyzer = dsLang::CreateSemanticAnalyzer(diagReporter);
-    semanticAnalyzer->Analyze(program.get());
-    
-    // Check if there were any errors during semantic analysis
-    if (diagReporter.HasErrors()) {
-        std::cerr << "Error: Semantic analysis failed with errors\n";
+    if (!outputFilename.empty() && inputFilenames.size() > 1) {
+        std::cerr << "Error: -o cannot be used with multiple input files.\n";
         return 1;
     }
     
-    if (verbose) {
-        std::cout << "Semantic analysis completed successfully\n";
+    // Pair every input with its output file
+    std::vector<std::string> outputFilenames;
+    for (const auto& inputFilename : inputFilenames) {
+        outputFilenames.push_back(outputFilename.empty()
+            ? defaultOutputFilename(inputFilename, options.outputAssembly)
+            : outputFilename);
     }
     
-    // Generate LLVM IR code - temporarily disabled due to include issues
-    // dsLang::CodeGenerator codegen(inputFilename, "x86_64-elf");
-    // codegen.Generate(static_cast<dsLang::CompilationUnit*>(program.get()));
+    // Compile every file; each runs on its own worker with its own state
+    size_t fileCount = inputFilenames.size();
+    std::vector<char> succeeded(fileCount, 0);
+    std::vector<std::ostringstream> logs(fileCount);
     
-    if (verbose) {
-        std::cout << "Code generation phase skipped due to LLVM include issues\n";
+    if (jobs == 0) {
+        jobs = dsLang::ThreadPool::GetDefaultThreadCount();
     }
     
-    /* Comment out LLVM code till we fix include paths
-    // Verify the generated LLVM IR
-    std::string verifyStr;
-    llvm::raw_string_ostream verifyStream(verifyStr);
-    if (llvm::verifyModule(*module, &verifyStream)) {
-        std::cerr << "Error: Generated module is invalid!\n";
-        std::cerr << verifyStr;
-        return 1;
+    // Every file gets its own time report. Heap counters are process-wide,
+    // so heap figures need files compiled one at a time. Traces get their
+    // phase spans from the reports' timers.
+    std::vector<std::unique_ptr<dsLang::TimeReport>> reports(fileCount);
+    if (timeReport || memReport || !timeReportJson.empty() || timeTrace) {
+        for (size_t i = 0; i < fileCount; i++) {
+            reports[i] = std::make_unique<dsLang::TimeReport>(inputFilenames[i]);
+        }
     }
-    
-    // Get target machine for x86-64
-    std::string targetTriple = "x86_64-elf";
-    std::string error;
-    const llvm::Target* target = llvm::TargetRegistry::lookupTarget(targetTriple, error);
-    
-    if (!target) {
-        std::cerr << "Error looking up target: " << error << "\n";
-        return 1;
+    if (memReport) {
+        if (dsLang::EnableHeapCounting()) {
+            jobs = 1;
+        } else {
+            std::cerr << "Warning: -fmem-report is not supported by this build\n";
+        }
     }
     
-    llvm::TargetOptions opt;
-    std::unique_ptr<llvm::TargetMachine> targetMachine(
-        target->createTargetMachine(targetTriple, "generic", "", opt, llvm::Reloc::Model::Static));
-    
-    module->setDataLayout(targetMachine->createDataLayout());
-    
-    // Open output file
-    std::error_code EC;
-    llvm::raw_fd_ostream outputFile(outputFilename, EC, llvm::sys::fs::OF_None);
-    
-    if (EC) {
-        std::cerr << "Error opening output file: " << EC.message() << "\n";
-        return 1;
+    // Like clang, name the timeline after the output
+    if (timeTrace) {
+        if (timeTraceFile.empty()) {
+            timeTraceFile = fileCount == 1 ? replaceExtension(outputFilenames[0], ".json")
+                                           : "dscc-trace.json";
+        }
+        dsLang::StartTimeTrace(timeTraceGranularity, "dscc");
     }
     
-    // Set up pass manager
-    llvm::legacy::PassManager pass;
-    
-    // Set output file type
-    auto fileType = outputAssembly ? llvm::CGFT_AssemblyFile : llvm::CGFT_ObjectFile;
+    if (jobs == 1 || fileCount == 1) {
+        for (size_t i = 0; i < fileCount; i++) {
+            succeeded[i] = compileFile(inputFilenames[i], outputFilenames[i], options, logs[i],
+                                       reports[i].get());
+        }
+    } else {
+        dsLang::ThreadPool pool(std::min(jobs, fileCount));
+        for (size_t i = 0; i < fileCount; i++) {
+            pool.Submit([&, i] {
+                succeeded[i] = compileFile(inputFilenames[i], outputFilenames[i], options, logs[i],
+                                           reports[i].get());
+            });
+        }
+        pool.Wait();
+    }
     
-    // Generate code
-    if (targetMachine->addPassesToEmitFile(pass, outputFile, nullptr, fileType)) {
-        std::cerr << "Error: Target machine can't emit a file of this type\n";
-        return 1;
+    // Report in input order, regardless of which file finished first
+    int result = 0;
+    for (size_t i = 0; i < fileCount; i++) {
+        std::cout << logs[i].str();
+        if (!succeeded[i]) {
+            result = 1;
+        }
     }
     
-    // Run passes
-    pass.run(*module);
-    outputFile.close();
-    */
+    // Every worker has exited, so the timeline is complete
+    if (timeTrace && !dsLang::FinishTimeTrace(timeTraceFile)) {
+        std::cerr << "Error: could not write " << timeTraceFile << "\n";
+        result = 1;
+    }
     
-    // For now, write a dummy output file to indicate we got this far
-    std::ofstream dummyOutput(outputFilename);
-    dummyOutput << "// Compilation successful up to semantic analysis\n";
-    dummyOutput << "// LLVM code generation disabled due to include path issues\n";
-    dummyOutput.close();
+    if (timeReport || memReport) {
+        for (const auto& report : reports) {
+            report->Print(std::cerr);
+        }
+    }
     
-    if (verbose) {
-        std::cout << "Output written to: " << outputFilename << "\n";
+    if (!timeReportJson.empty()) {
+        dsLang::JsonValue files = dsLang::JsonValue::Array();
+        for (const auto& report : reports) {
+            files.Push(report->ToJson());
+        }
+        dsLang::JsonValue json = dsLang::JsonValue::Object();
+        json.Set("version", DSLANG_VERSION);
+        json.Set("heap_counted", dsLang::IsHeapCountingEnabled());
+        json.Set("files", std::move(files));
+        
+        if (timeReportJson == "-") {
+            std::cout << json.Serialize() << "\n";
+        } else {
+            std::ofstream out(timeReportJson);
+            out << json.Serialize() << "\n";
+            if (!out) {
+                std::cerr << "Error: could not write " << timeReportJson << "\n";
+                result = 1;
+            }
+        }
     }
     
-    return 0;
+    return result;
 }
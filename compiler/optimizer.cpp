@@ -0,0 +1,188 @@
+/**
+ * optimizer.cpp - IR Optimization Implementation for dsLang
+ *
+ * This file builds and runs the new pass manager pipelines.
+ */
+
+#include "optimizer.h"
+#include <llvm/Analysis/CGSCCPassManager.h>
+#include <llvm/Analysis/LoopAnalysisManager.h>
+#include <llvm/Analysis/TargetLibraryInfo.h>
+#include <llvm/IR/PassInstrumentation.h>
+#include <llvm/IR/PassManager.h>
+#include <llvm/Passes/PassBuilder.h>
+#include <llvm/Passes/StandardInstrumentations.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/TargetParser/Triple.h>
+#include <chrono>
+#include <vector>
+
+namespace dsLang {
+
+namespace {
+
+/**
+ * PassTimer - Records the self time of passes and analyses into a report
+ *
+ * A pass's time excludes the passes and analyses that run inside it, so
+ * the records add up to the time spent optimizing. Pass managers and
+ * adaptors only run other passes and are not recorded.
+ */
+class PassTimer {
+public:
+    explicit PassTimer(TimeReport* report) : report_(report) {}
+
+    void Register(llvm::PassInstrumentationCallbacks& callbacks) {
+        callbacks.registerBeforeNonSkippedPassCallback([this](llvm::StringRef pass, llvm::Any) {
+            if (!IsContainer(pass)) {
+                Start(pass);
+            }
+        });
+        callbacks.registerAfterPassCallback(
+            [this](llvm::StringRef pass, llvm::Any, const llvm::PreservedAnalyses&) {
+                if (!IsContainer(pass)) {
+                    Stop();
+                }
+            });
+        callbacks.registerAfterPassInvalidatedCallback(
+            [this](llvm::StringRef pass, const llvm::PreservedAnalyses&) {
+                if (!IsContainer(pass)) {
+                    Stop();
+                }
+            });
+        callbacks.registerBeforeAnalysisCallback([this](llvm::StringRef analysis, llvm::Any) {
+            Start(analysis);
+        });
+        callbacks.registerAfterAnalysisCallback([this](llvm::StringRef, llvm::Any) {
+            Stop();
+        });
+    }
+
+private:
+    struct Running {
+        std::string name;                               // Pass or analysis name
+        std::chrono::steady_clock::time_point start;    // When it last resumed
+        double cpu_start;                               // Thread CPU time then
+    };
+
+    static bool IsContainer(llvm::StringRef pass) {
+        return llvm::isSpecialPass(pass, {"PassManager", "PassAdaptor"});
+    }
+
+    void Start(llvm::StringRef name) {
+        // Pause the enclosing pass
+        if (!running_.empty()) {
+            Record(running_.back(), 0);
+        }
+        running_.push_back({name.str(), std::chrono::steady_clock::now(), GetThreadCpuSeconds()});
+    }
+
+    void Stop() {
+        if (running_.empty()) {
+            return;
+        }
+        Record(running_.back(), 1);
+        running_.pop_back();
+
+        // Resume the enclosing pass
+        if (!running_.empty()) {
+            running_.back().start = std::chrono::steady_clock::now();
+            running_.back().cpu_start = GetThreadCpuSeconds();
+        }
+    }
+
+    void Record(const Running& running, unsigned count) {
+        std::chrono::duration<double> wall = std::chrono::steady_clock::now() - running.start;
+        TimeRecord record;
+        record.name = running.name;
+        record.group = "pass";
+        record.wall = wall.count();
+        record.cpu = GetThreadCpuSeconds() - running.cpu_start;
+        record.count = count;
+        report_->Add(record);
+    }
+
+    TimeReport* report_;                // Report to add to
+    std::vector<Running> running_;      // Passes started and not finished, innermost last
+};
+
+} // anonymous namespace
+
+/**
+ * GetOptimizationLevel - Map a numeric level onto the pass builder's levels
+ */
+static llvm::OptimizationLevel GetOptimizationLevel(unsigned opt_level) {
+    switch (opt_level) {
+        case 0: return llvm::OptimizationLevel::O0;
+        case 1: return llvm::OptimizationLevel::O1;
+        case 2: return llvm::OptimizationLevel::O2;
+        default: return llvm::OptimizationLevel::O3;
+    }
+}
+
+/**
+ * OptimizeModule - Run the optimization pipeline for a level
+ */
+void OptimizeModule(llvm::Module& module, llvm::TargetMachine* target_machine, unsigned opt_level,
+                    TimeReport* report) {
+    llvm::OptimizationLevel level = GetOptimizationLevel(opt_level);
+
+    // Unrolling and vectorization are what clang enables from -O2 up
+    llvm::PipelineTuningOptions tuning;
+    tuning.LoopUnrolling = opt_level >= 2;
+    tuning.LoopInterleaving = opt_level >= 2;
+    tuning.LoopVectorization = opt_level >= 2;
+    tuning.SLPVectorization = opt_level >= 2;
+
+    llvm::LoopAnalysisManager loop_analyses;
+    llvm::FunctionAnalysisManager function_analyses;
+    llvm::CGSCCAnalysisManager cgscc_analyses;
+    llvm::ModuleAnalysisManager module_analyses;
+
+    // Time and trace passes through instrumentation callbacks, which the
+    // pass builder hands to every analysis manager
+    llvm::PassInstrumentationCallbacks callbacks;
+    PassTimer pass_timer(report);
+    if (report) {
+        pass_timer.Register(callbacks);
+    }
+    llvm::TimeProfilingPassesHandler pass_tracer;
+    bool tracing = llvm::timeTraceProfilerEnabled();
+    if (tracing) {
+        pass_tracer.registerCallbacks(callbacks);
+    }
+
+    llvm::PassBuilder builder(target_machine, tuning, std::nullopt,
+                              report || tracing ? &callbacks : nullptr);
+
+    // Register library info before the defaults so ours wins: the kernel
+    // has no C library, so no call may be treated as one
+    llvm::TargetLibraryInfoImpl library_info{llvm::Triple(module.getTargetTriple())};
+    library_info.disableAllFunctions();
+    function_analyses.registerPass([&] { return llvm::TargetLibraryAnalysis(library_info); });
+
+    builder.registerModuleAnalyses(module_analyses);
+    builder.registerCGSCCAnalyses(cgscc_analyses);
+    builder.registerFunctionAnalyses(function_analyses);
+    builder.registerLoopAnalyses(loop_analyses);
+    builder.crossRegisterProxies(loop_analyses, function_analyses, cgscc_analyses, module_analyses);
+
+    llvm::ModulePassManager passes = opt_level == 0
+        ? builder.buildO0DefaultPipeline(level)
+        : builder.buildPerModuleDefaultPipeline(level);
+    passes.run(module, module_analyses);
+}
+
+/**
+ * GetCodeGenOptLevel - Get the backend optimization level for a level
+ */
+llvm::CodeGenOptLevel GetCodeGenOptLevel(unsigned opt_level) {
+    switch (opt_level) {
+        case 0: return llvm::CodeGenOptLevel::None;
+        case 1: return llvm::CodeGenOptLevel::Less;
+        case 2: return llvm::CodeGenOptLevel::Default;
+        default: return llvm::CodeGenOptLevel::Aggressive;
+    }
+}
+
+} // namespace dsLang
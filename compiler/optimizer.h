@@ -0,0 +1,47 @@
+/**
+ * optimizer.h - IR Optimization for dsLang
+ *
+ * This file declares the optimization pipeline that runs over generated
+ * LLVM IR before it is handed to the target backend. It is built on LLVM's
+ * new pass manager and mirrors clang's -O0 through -O3 pipelines.
+ */
+
+#ifndef DSLANG_OPTIMIZER_H
+#define DSLANG_OPTIMIZER_H
+
+#include "timing.h"
+#include <llvm/IR/Module.h>
+#include <llvm/Support/CodeGen.h>
+#include <llvm/Target/TargetMachine.h>
+
+namespace dsLang {
+
+/**
+ * OptimizeModule - Run the optimization pipeline for a level
+ *
+ * Level 0 only runs the passes that are required for correctness (such as
+ * always-inline). Level 1 adds SROA/mem2reg, early CSE and simple loop
+ * cleanups; level 2 adds inlining, GVN, loop rotation/unrolling and the
+ * loop and SLP vectorizers; level 3 additionally enables the aggressive
+ * variants of those passes.
+ *
+ * Code is assumed to be freestanding: no call is recognized as a C library
+ * function, so calls are never rewritten into other library calls.
+ *
+ * @param module The module to optimize in place
+ * @param target_machine The target, used for cost models; may be null
+ * @param opt_level The optimization level (0-3)
+ * @param report Receives the self time of every pass and analysis as
+ *        "pass" records; may be null
+ */
+void OptimizeModule(llvm::Module& module, llvm::TargetMachine* target_machine, unsigned opt_level,
+                    TimeReport* report = nullptr);
+
+/**
+ * GetCodeGenOptLevel - Get the backend optimization level for a level
+ */
+llvm::CodeGenOptLevel GetCodeGenOptLevel(unsigned opt_level);
+
+} // namespace dsLang
+
+#endif // DSLANG_OPTIMIZER_H
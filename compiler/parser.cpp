@@ -7,33 +7,35 @@
 
 #include "parser.h"
 #include "diagnostic.h"
+#include <algorithm>
 #include <iostream>
 #include <sstream>
+#include <unordered_set>
 
 namespace dsLang {
 
-// Factory function to create array types
-std::shared_ptr<ArrayType> CreateArrayType(std::shared_ptr<Type> element_type, std::shared_ptr<Expr> size_expr) {
-    return std::make_shared<ArrayType>(element_type, size_expr);
-}
-
-std::shared_ptr<ArrayType> CreateArrayType(std::shared_ptr<Type> element_type, size_t size) {
-    return std::make_shared<ArrayType>(element_type, size);
+/**
+ * Parser constructor - Initialize the parser with a lexer
+ */
+Parser::Parser(Lexer& lexer, DiagnosticReporter& diag_reporter, TypeContext& types)
+    : owned_tokens_(TokenBuffer::Tokenize(lexer)), tokens_(owned_tokens_.get()), pos_(0),
+      diag_reporter_(diag_reporter), has_errors_(false),
+      arena_(std::make_unique<ASTArena>()), types_(types) {
 }
 
 /**
- * Parser constructor - Initialize the parser with a lexer
+ * Parser constructor - Initialize the parser with pre-lexed tokens
  */
-Parser::Parser(Lexer& lexer, DiagnosticReporter& diag_reporter)
-    : lexer_(lexer), diag_reporter_(diag_reporter), has_errors_(false) {
-    // Initialize the current token
-    current_token_ = lexer_.GetNextToken();
+Parser::Parser(const TokenBuffer& tokens, DiagnosticReporter& diag_reporter, TypeContext& types)
+    : tokens_(&tokens), pos_(0),
+      diag_reporter_(diag_reporter), has_errors_(false),
+      arena_(std::make_unique<ASTArena>()), types_(types) {
 }
 
 /**
  * Parse - Parse the source code and build an AST
  */
-std::shared_ptr<CompilationUnit> Parser::Parse() {
+std::unique_ptr<CompilationUnit> Parser::Parse() {
     return ParseCompilationUnit();
 }
 
@@ -65,45 +67,66 @@ bool Parser::Match(TokenKind kind) {
 /**
  * Advance - Advance to the next token
  */
-Token Parser::Advance() {
-    Token prev = current_token_;
-    current_token_ = lexer_.GetNextToken();
-    return prev;
+void Parser::Advance() {
+    if (!IsAtEnd()) {
+        pos_++;
+    }
 }
 
 /**
  * Peek - Peek at the current token
  */
 Token Parser::Peek() const {
-    return current_token_;
+    return tokens_->GetToken(pos_);
 }
 
 /**
  * PeekNext - Peek at the next token
  */
 Token Parser::PeekNext() const {
-    return lexer_.PeekNextToken();
+    return tokens_->GetToken(pos_ + 1);
+}
+
+/**
+ * PeekAhead - Peek at a token further ahead
+ */
+Token Parser::PeekAhead(size_t distance) const {
+    return tokens_->GetToken(pos_ + distance);
+}
+
+/**
+ * Previous - Get the most recently consumed token
+ */
+Token Parser::Previous() const {
+    return tokens_->GetToken(pos_ > 0 ? pos_ - 1 : 0);
 }
 
 /**
  * Check - Check if the current token is of the expected kind
  */
 bool Parser::Check(TokenKind kind) const {
-    return !IsAtEnd() && current_token_.GetKind() == kind;
+    return !IsAtEnd() && tokens_->GetKind(pos_) == kind;
 }
 
 /**
  * CheckNext - Check if the next token is of the expected kind
  */
 bool Parser::CheckNext(TokenKind kind) const {
-    return !IsAtEnd() && lexer_.PeekNextToken().GetKind() == kind;
+    return CheckAhead(1, kind);
+}
+
+/**
+ * CheckAhead - Check the kind of a token further ahead
+ */
+bool Parser::CheckAhead(size_t distance, TokenKind kind) const {
+    return !IsAtEnd() && tokens_->GetKind(pos_ + distance) == kind;
 }
 
 /**
  * IsAtEnd - Check if we've reached the end of the token stream
  */
 bool Parser::IsAtEnd() const {
-    return current_token_.GetKind() == TokenKind::END_OF_FILE;
+    return tokens_->GetKind(pos_) == TokenKind::END_OF_FILE;
 }
 
 /**
@@ -111,7 +134,7 @@ bool Parser::IsAtEnd() const {
  */
 void Parser::ReportError(const std::string& message) {
     has_errors_ = true;
-    diag_reporter_.ReportError(message, current_token_, lexer_.GetFilename());
+    diag_reporter_.ReportError(message, Peek(), tokens_->GetFilename());
     Synchronize();
 }
 
@@ -123,12 +146,12 @@ void Parser::Synchronize() {
     
     while (!IsAtEnd()) {
         // Skip until we find a token that could be the start of a new statement
-        if (current_token_.GetKind() == TokenKind::SEMICOLON) {
+        if (tokens_->GetKind(pos_) == TokenKind::SEMICOLON) {
             Advance();
             return;
         }
         
-        switch (current_token_.GetKind()) {
+        switch (tokens_->GetKind(pos_)) {
             case TokenKind::KW_STRUCT:
             case TokenKind::KW_ENUM:
             case TokenKind::KW_IF:
@@ -149,8 +172,8 @@ void Parser::Synchronize() {
 /**
  * ParseCompilationUnit - Parse a compilation unit
  */
-std::shared_ptr<CompilationUnit> Parser::ParseCompilationUnit() {
-    std::vector<std::shared_ptr<Decl>> declarations;
+std::unique_ptr<CompilationUnit> Parser::ParseCompilationUnit() {
+    std::vector<Decl*> declarations;
     
     while (!IsAtEnd()) {
         try {
@@ -164,13 +187,240 @@ std::shared_ptr<CompilationUnit> Parser::ParseCompilationUnit() {
         }
     }
     
-    return std::make_shared<CompilationUnit>(declarations);
+    NodeList<Decl> decls = arena_->CopyList<Decl>(declarations);
+    
+    // Hand the arena, and with it every node parsed so far, to the unit
+    return std::make_unique<CompilationUnit>(std::move(arena_), decls);
+}
+
+/**
+ * ParseIncremental - Parse, reusing unchanged top-level declarations
+ */
+std::unique_ptr<CompilationUnit> Parser::ParseIncremental(ParseCache& cache) {
+    // Each parse that reuses declarations keeps their arenas alive. Once
+    // too many partly-dead arenas pile up, start over from one fresh arena.
+    static constexpr size_t kMaxRetainedArenas = 16;
+    
+    // The type context outlives the parse, so the struct and enum types
+    // of the previous version still hold its fields and enumerators.
+    // Empty them all; reused declarations refill theirs below, and the
+    // rest are refilled by parsing, or stay empty if they were deleted.
+    std::unordered_set<ASTArena*> cached_arenas;
+    for (const auto& entry : cache.decls_) {
+        ResetDeclaredType(entry.second.decl);
+        cached_arenas.insert(entry.second.arena.get());
+    }
+    if (cached_arenas.size() > kMaxRetainedArenas) {
+        cache.Clear();
+    }
+    
+    std::vector<Decl*> declarations;
+    std::vector<std::pair<uint64_t, ParseCache::Entry>> reused;
+    std::vector<std::pair<uint64_t, ParseCache::Entry>> parsed;
+    
+    while (!IsAtEnd()) {
+        size_t start = pos_;
+        size_t end = FindDeclarationEnd(start);
+        uint64_t hash = HashTokens(start, end);
+        
+        // Reuse an identical declaration; each cached one is used at most
+        // once. Hashes can collide, so compare the tokens themselves.
+        auto range = cache.decls_.equal_range(hash);
+        auto hit = range.first;
+        while (hit != range.second && !SameTokens(hit->second.tokens, start, end)) {
+            ++hit;
+        }
+        if (hit != range.second) {
+            RestoreDeclaredType(hit->second.decl);
+            declarations.push_back(hit->second.decl);
+            reused.emplace_back(hash, std::move(hit->second));
+            cache.decls_.erase(hit);
+            pos_ = end;
+            continue;
+        }
+        
+        // Parse it. The parser may stop short of or run past the scanned
+        // boundary when recovering from errors, so cache the range it used.
+        unsigned errors_before = diag_reporter_.GetErrorCount();
+        Decl* decl = nullptr;
+        try {
+            decl = ParseDeclaration();
+        } catch (const std::exception& e) {
+            ReportError(e.what());
+            Synchronize();
+        }
+        if (pos_ == start) {
+            Advance();
+        }
+        
+        if (decl) {
+            declarations.push_back(decl);
+            if (diag_reporter_.GetErrorCount() == errors_before) {
+                parsed.emplace_back(HashTokens(start, pos_),
+                                    ParseCache::Entry{decl, CopyTokens(start, pos_), nullptr});
+            }
+        }
+    }
+    
+    // The new arena holds the freshly parsed nodes and the declaration list
+    NodeList<Decl> decls = arena_->CopyList<Decl>(declarations);
+    std::shared_ptr<ASTArena> arena(std::move(arena_));
+    
+    std::vector<std::shared_ptr<ASTArena>> arenas;
+    arenas.push_back(arena);
+    for (const auto& entry : reused) {
+        if (std::find(arenas.begin(), arenas.end(), entry.second.arena) == arenas.end()) {
+            arenas.push_back(entry.second.arena);
+        }
+    }
+    
+    // Remember exactly this unit's declarations for the next parse
+    cache.decls_.clear();
+    for (auto& entry : reused) {
+        cache.decls_.emplace(entry.first, std::move(entry.second));
+    }
+    for (auto& entry : parsed) {
+        entry.second.arena = arena;
+        cache.decls_.emplace(entry.first, std::move(entry.second));
+    }
+    cache.reused_count_ = reused.size();
+    cache.parsed_count_ = declarations.size() - reused.size();
+    
+    return std::make_unique<CompilationUnit>(std::move(arenas), decls);
+}
+
+/**
+ * FindDeclarationEnd - Find the end of the top-level declaration at a token
+ */
+size_t Parser::FindDeclarationEnd(size_t start) const {
+    size_t size = tokens_->GetSize();
+    int depth = 0;
+    
+    for (size_t i = start; i < size; i++) {
+        switch (tokens_->GetKind(i)) {
+            case TokenKind::END_OF_FILE:
+                return i;
+            case TokenKind::LEFT_BRACE:
+            case TokenKind::LEFT_PAREN:
+            case TokenKind::LEFT_BRACKET:
+                depth++;
+                break;
+            case TokenKind::RIGHT_PAREN:
+            case TokenKind::RIGHT_BRACKET:
+                depth--;
+                break;
+            case TokenKind::RIGHT_BRACE:
+                if (--depth <= 0) {
+                    return tokens_->GetKind(i + 1) == TokenKind::SEMICOLON ? i + 2 : i + 1;
+                }
+                break;
+            case TokenKind::SEMICOLON:
+                if (depth <= 0) {
+                    return i + 1;
+                }
+                break;
+            default:
+                break;
+        }
+    }
+    return size;
+}
+
+/**
+ * HashTokens - Hash the kinds and spellings of a range of tokens (FNV-1a)
+ */
+uint64_t Parser::HashTokens(size_t begin, size_t end) const {
+    uint64_t hash = 0xcbf29ce484222325ULL;
+    auto mix = [&hash](unsigned char byte) {
+        hash ^= byte;
+        hash *= 0x100000001b3ULL;
+    };
+    
+    for (size_t i = begin; i < end; i++) {
+        mix(static_cast<unsigned char>(tokens_->GetKind(i)));
+        for (char c : tokens_->GetLexeme(i)) {
+            mix(static_cast<unsigned char>(c));
+        }
+        // Separate spellings so that "ab c" and "a bc" differ
+        mix(0xFF);
+    }
+    return hash;
+}
+
+/**
+ * CopyTokens - Copy the kinds and spellings of a range of tokens
+ */
+std::vector<std::pair<TokenKind, std::string>> Parser::CopyTokens(size_t begin, size_t end) const {
+    std::vector<std::pair<TokenKind, std::string>> tokens;
+    tokens.reserve(end - begin);
+    for (size_t i = begin; i < end; i++) {
+        tokens.emplace_back(tokens_->GetKind(i), std::string(tokens_->GetLexeme(i)));
+    }
+    return tokens;
+}
+
+/**
+ * SameTokens - Check if a range of tokens has the given kinds and spellings
+ */
+bool Parser::SameTokens(const std::vector<std::pair<TokenKind, std::string>>& tokens,
+                        size_t begin, size_t end) const {
+    if (tokens.size() != end - begin) {
+        return false;
+    }
+    for (size_t i = begin; i < end; i++) {
+        const auto& token = tokens[i - begin];
+        if (token.first != tokens_->GetKind(i) || token.second != tokens_->GetLexeme(i)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * ResetDeclaredType - Empty the struct or enum type a declaration defined
+ */
+void Parser::ResetDeclaredType(Decl* decl) {
+    if (auto struct_decl = dynamic_cast<StructDecl*>(decl)) {
+        struct_decl->GetType()->ClearFields();
+    } else if (auto enum_decl = dynamic_cast<EnumDecl*>(decl)) {
+        types_.ClearEnumerators(types_.GetEnumType(enum_decl->GetName()));
+    }
+}
+
+/**
+ * RestoreDeclaredType - Define a struct or enum type again from a reused declaration
+ */
+void Parser::RestoreDeclaredType(Decl* decl) {
+    if (auto struct_decl = dynamic_cast<StructDecl*>(decl)) {
+        StructType* type = struct_decl->GetType();
+        if (!defined_types_.insert(type).second) {
+            ReportError("Redefinition of struct '" + struct_decl->GetName() + "'");
+            return;
+        }
+        for (VarDecl* field : struct_decl->GetFields()) {
+            if (field->GetType()) {
+                type->AddField(field->GetName(), field->GetType());
+            }
+        }
+        type->SetComplete();
+    } else if (auto enum_decl = dynamic_cast<EnumDecl*>(decl)) {
+        EnumType* type = types_.GetEnumType(enum_decl->GetName());
+        if (!defined_types_.insert(type).second) {
+            ReportError("Redefinition of enum '" + enum_decl->GetName() + "'");
+            return;
+        }
+        for (const auto& value : enum_decl->GetValues()) {
+            if (!types_.AddEnumerator(type, value.first, value.second)) {
+                ReportError("Redefinition of enumerator '" + value.first + "'");
+            }
+        }
+    }
 }
 
 /**
  * ParseDeclaration - Parse a declaration
  */
-std::shared_ptr<Decl> Parser::ParseDeclaration() {
+Decl* Parser::ParseDeclaration() {
     if (Match(TokenKind::KW_STRUCT)) {
         return ParseStructDeclaration();
     }
@@ -181,7 +431,7 @@ std::shared_ptr<Decl> Parser::ParseDeclaration() {
     
     // Look for function, method, or variable declarations
     // Parse type first
-    std::shared_ptr<Type> type = ParseType();
+    ParseType();
     
     // Check for identifier
     if (!Check(TokenKind::IDENTIFIER)) {
@@ -189,7 +439,7 @@ std::shared_ptr<Decl> Parser::ParseDeclaration() {
         return nullptr;
     }
     
-    std::string name = current_token_.GetLexeme();
+    std::string name(tokens_->GetLexeme(pos_));
     Advance();
     
     // Function or method declaration
@@ -204,7 +454,7 @@ std::shared_ptr<Decl> Parser::ParseDeclaration() {
 /**
  * ParseType - Parse a type
  */
-std::shared_ptr<Type> Parser::ParseType() {
+Type* Parser::ParseType() {
     bool is_unsigned = false;
     
     // Check for unsigned qualifier
@@ -219,24 +469,32 @@ std::shared_ptr<Type> Parser::ParseType() {
         Match(TokenKind::KW_FLOAT) || Match(TokenKind::KW_DOUBLE)) {
         
         // Get the previously consumed token for type creation
-        Token type_token = Peek();
-        auto type = CreateType(type_token, is_unsigned);
+        Token type_token = Previous();
+        Type* type = CreateType(type_token, is_unsigned);
         
         // Check for pointer type
         while (Match(TokenKind::STAR)) {
-            type = std::make_shared<PointerType>(type);
+            type = types_.GetPointerType(type);
         }
         
         // Check for array type
         if (Match(TokenKind::LEFT_BRACKET)) {
             if (Match(TokenKind::RIGHT_BRACKET)) {
                 // Unsized array, treat as pointer for now
-                type = std::make_shared<PointerType>(type);
+                type = types_.GetPointerType(type);
             } else {
                 // Sized array
                 auto size_expr = ParseExpression();
                 Consume(TokenKind::RIGHT_BRACKET, "Expected ']' after array size");
-                type = CreateArrayType(type, size_expr);
+                
+                // Fold the size, so that the type is uniqued and does not
+                // point into this parse's arena
+                int64_t size = 0;
+                if (size_expr && (!EvaluateConstant(size_expr, &size) || size < 0)) {
+                    ReportError("Array size must be a non-negative constant integer expression");
+                    size = 0;
+                }
+                type = types_.GetArrayType(type, static_cast<size_t>(size));
             }
         }
         
@@ -250,30 +508,15 @@ std::shared_ptr<Type> Parser::ParseType() {
             return nullptr;
         }
         
-        std::string name = current_token_.GetLexeme();
+        std::string name(tokens_->GetLexeme(pos_));
         Advance();
         
-        // Try to find existing struct type
-        auto struct_it = struct_types_.find(name);
-        if (struct_it != struct_types_.end()) {
-            std::shared_ptr<Type> type = struct_it->second;
-            
-            // Check for pointer type
-            while (Match(TokenKind::STAR)) {
-                type = std::make_shared<PointerType>(type);
-            }
-            
-            return type;
-        }
-        
-        // Create a new struct type
-        auto struct_type = std::make_shared<StructType>(name);
-        struct_types_.insert(std::make_pair(name, struct_type));
-        std::shared_ptr<Type> type = struct_type;
+        // Get or create the struct type
+        Type* type = types_.GetStructType(name);
         
         // Check for pointer type
         while (Match(TokenKind::STAR)) {
-            type = std::make_shared<PointerType>(type);
+            type = types_.GetPointerType(type);
         }
         
         return type;
@@ -286,31 +529,15 @@ std::shared_ptr<Type> Parser::ParseType() {
             return nullptr;
         }
         
-        std::string name = current_token_.GetLexeme();
+        std::string name(tokens_->GetLexeme(pos_));
         Advance();
         
-        // Try to find existing enum type
-        auto enum_it = enum_types_.find(name);
-        if (enum_it != enum_types_.end()) {
-            std::shared_ptr<Type> type = enum_it->second;
-            
-            // Check for pointer type
-            while (Match(TokenKind::STAR)) {
-                type = std::make_shared<PointerType>(type);
-            }
-            
-            return type;
-        }
-        
-        // Create a new enum type - use IntType as base
-        auto base_type = std::make_shared<IntType>();
-        auto enum_type = std::make_shared<EnumType>(name, base_type);
-        enum_types_.insert(std::make_pair(name, enum_type));
-        std::shared_ptr<Type> type = enum_type;
+        // Get or create the enum type
+        Type* type = types_.GetEnumType(name);
         
         // Check for pointer type
         while (Match(TokenKind::STAR)) {
-            type = std::make_shared<PointerType>(type);
+            type = types_.GetPointerType(type);
         }
         
         return type;
@@ -323,70 +550,57 @@ std::shared_ptr<Type> Parser::ParseType() {
 /**
  * CreateType - Create a type from the specified token
  */
-std::shared_ptr<Type> Parser::CreateType(const Token& type_token, bool is_unsigned) {
+Type* Parser::CreateType(const Token& type_token, bool is_unsigned) {
+    auto sign_kind = is_unsigned ? PrimitiveType::SignKind::UNSIGNED
+                                 : PrimitiveType::SignKind::SIGNED;
+    
     switch (type_token.GetKind()) {
         case TokenKind::KW_VOID:
-            return std::make_shared<VoidType>();
+            return types_.GetVoidType();
         case TokenKind::KW_BOOL:
-            return std::make_shared<BoolType>();
+            return types_.GetBoolType();
         case TokenKind::KW_CHAR:
-            if (is_unsigned) {
-                return std::make_shared<CharType>(PrimitiveType::SignKind::UNSIGNED);
-            } else {
-                return std::make_shared<CharType>();
-            }
+            return types_.GetCharType(sign_kind);
         case TokenKind::KW_SHORT:
-            if (is_unsigned) {
-                return std::make_shared<ShortType>(PrimitiveType::SignKind::UNSIGNED);
-            } else {
-                return std::make_shared<ShortType>();
-            }
+            return types_.GetShortType(sign_kind);
         case TokenKind::KW_INT:
-            if (is_unsigned) {
-                return std::make_shared<IntType>(PrimitiveType::SignKind::UNSIGNED);
-            } else {
-                return std::make_shared<IntType>();
-            }
+            return types_.GetIntType(sign_kind);
         case TokenKind::KW_LONG:
-            if (is_unsigned) {
-                return std::make_shared<LongType>(PrimitiveType::SignKind::UNSIGNED);
-            } else {
-                return std::make_shared<LongType>();
-            }
+            return types_.GetLongType(sign_kind);
         case TokenKind::KW_FLOAT:
-            return std::make_shared<FloatType>();
+            return types_.GetFloatType();
         case TokenKind::KW_DOUBLE:
-            return std::make_shared<DoubleType>();
+            return types_.GetDoubleType();
         default:
             // Unreachable
-            return std::make_shared<IntType>();
+            return types_.GetIntType();
     }
 }
 
 /**
  * ParseStructDeclaration - Parse a struct declaration
  */
-std::shared_ptr<StructDecl> Parser::ParseStructDeclaration() {
+StructDecl* Parser::ParseStructDeclaration() {
     // Struct name
     if (!Check(TokenKind::IDENTIFIER)) {
         ReportError("Expected struct name");
         return nullptr;
     }
     
-    std::string name = current_token_.GetLexeme();
+    Symbol name = tokens_->GetSymbol(pos_);
     Advance();
     
-    // Get or create struct type
-    std::shared_ptr<StructType> type;
-    auto struct_it = struct_types_.find(name);
-    if (struct_it != struct_types_.end()) {
-        type = struct_it->second;
+    // Register the struct type so that references to it resolve by name.
+    // The type may be complete from an earlier parse of an edited file, as
+    // the server keeps its types; this definition replaces those fields.
+    StructType* type = types_.GetStructType(name.GetName());
+    if (!defined_types_.insert(type).second) {
+        ReportError("Redefinition of struct '" + name.GetName() + "'");
     } else {
-        type = std::make_shared<StructType>(name);
-        struct_types_.insert(std::make_pair(name, type));
+        type->ClearFields();
     }
     
-    std::vector<std::shared_ptr<VarDecl>> fields;
+    std::vector<VarDecl*> fields;
     
     // Parse struct body
     Consume(TokenKind::LEFT_BRACE, "Expected '{' after struct name");
@@ -400,10 +614,10 @@ std::shared_ptr<StructDecl> Parser::ParseStructDeclaration() {
             continue;
         }
         
-        std::string field_name = current_token_.GetLexeme();
+        Symbol field_name = tokens_->GetSymbol(pos_);
         Advance();
         
-        std::shared_ptr<Expr> initializer = nullptr;
+        Expr* initializer = nullptr;
         
         // Check for initializer
         if (Match(TokenKind::EQUAL)) {
@@ -412,40 +626,44 @@ std::shared_ptr<StructDecl> Parser::ParseStructDeclaration() {
         
         Consume(TokenKind::SEMICOLON, "Expected ';' after field declaration");
         
-        fields.push_back(std::make_shared<VarDecl>(field_name, field_type, initializer));
+        fields.push_back(arena_->Create<VarDecl>(field_name, field_type, initializer));
+        if (field_type) {
+            type->AddField(field_name.GetName(), field_type);
+        }
     }
     
     Consume(TokenKind::RIGHT_BRACE, "Expected '}' after struct body");
     
-    return std::make_shared<StructDecl>(name, fields);
+    // Complete the type, so that its layout is known from here on
+    type->SetComplete();
+    
+    return arena_->Create<StructDecl>(name, type, arena_->CopyList<VarDecl>(fields));
 }
 
 /**
  * ParseEnumDeclaration - Parse an enum declaration
  */
-std::shared_ptr<EnumDecl> Parser::ParseEnumDeclaration() {
+EnumDecl* Parser::ParseEnumDeclaration() {
     // Enum name
     if (!Check(TokenKind::IDENTIFIER)) {
         ReportError("Expected enum name");
         return nullptr;
     }
     
-    std::string name = current_token_.GetLexeme();
+    Symbol name = tokens_->GetSymbol(pos_);
     Advance();
     
-    // Get or create enum type
-    std::shared_ptr<EnumType> type;
-    auto enum_it = enum_types_.find(name);
-    if (enum_it != enum_types_.end()) {
-        type = enum_it->second;
+    // Get or create enum type. As with structs, the enumerators of an
+    // earlier parse of an edited file are replaced by this definition's.
+    EnumType* type = types_.GetEnumType(name.GetName());
+    if (!defined_types_.insert(type).second) {
+        ReportError("Redefinition of enum '" + name.GetName() + "'");
     } else {
-        // Create a new enum type with IntType as base
-        auto base_type = std::make_shared<IntType>();
-        type = std::make_shared<EnumType>(name, base_type);
-        enum_types_.insert(std::make_pair(name, type));
+        types_.ClearEnumerators(type);
     }
     
-    std::vector<std::pair<std::string, std::shared_ptr<Expr>>> values;
+    std::vector<std::pair<std::string, int64_t>> values;
+    int64_t next_value = 0;
     
     // Parse enum body
     Consume(TokenKind::LEFT_BRACE, "Expected '{' after enum name");
@@ -458,30 +676,23 @@ std::shared_ptr<EnumDecl> Parser::ParseEnumDeclaration() {
             continue;
         }
         
-        std::string value_name = current_token_.GetLexeme();
+        std::string value_name(tokens_->GetLexeme(pos_));
         Advance();
         
-        std::shared_ptr<Expr> value = nullptr;
-        
-        // Check for explicit value
+        // An explicit value must be constant; otherwise count up from the previous value
+        int64_t value = next_value;
         if (Match(TokenKind::EQUAL)) {
-            value = ParseExpression();
-        } else {
-            // If no explicit value, use previous value + 1 or 0 if first
-            if (values.empty()) {
-                // First value defaults to 0
-                auto int_type = std::make_shared<IntType>();
-                value = std::make_shared<LiteralExpr>(0LL, int_type);
-            } else {
-                // Create an expression that adds 1 to the previous value
-                auto prev_value = values.back().second;
-                auto int_type = std::make_shared<IntType>();
-                auto one = std::make_shared<LiteralExpr>(1LL, int_type);
-                value = std::make_shared<BinaryExpr>(BinaryExpr::Op::ADD, prev_value, one, int_type);
+            Expr* value_expr = ParseExpression();
+            if (value_expr && !EvaluateConstant(value_expr, &value)) {
+                ReportError("Enum value must be a constant integer expression");
             }
         }
         
+        if (!types_.AddEnumerator(type, value_name, value)) {
+            ReportError("Redefinition of enumerator '" + value_name + "'");
+        }
         values.push_back(std::make_pair(value_name, value));
+        next_value = static_cast<int64_t>(static_cast<uint64_t>(value) + 1);
         
         // Comma after enum value is optional for the last value
         if (!Check(TokenKind::RIGHT_BRACE)) {
@@ -491,34 +702,110 @@ std::shared_ptr<EnumDecl> Parser::ParseEnumDeclaration() {
     
     Consume(TokenKind::RIGHT_BRACE, "Expected '}' after enum body");
     
-    // Extract values for the enum declaration
-    std::vector<std::pair<std::string, int64_t>> value_pairs;
-    for (const auto& pair : values) {
-        // We should properly evaluate the expressions here, but for simplicity,
-        // we'll just assume they're all literals
-        auto literal = std::dynamic_pointer_cast<LiteralExpr>(pair.second);
-        if (literal && literal->GetLiteralKind() == LiteralExpr::Kind::INT) {
-            value_pairs.push_back(std::make_pair(pair.first, literal->GetIntValue()));
-        } else {
-            // Default to 0 if not a literal
-            value_pairs.push_back(std::make_pair(pair.first, 0));
+    return arena_->Create<EnumDecl>(name, type->GetBaseType(), values);
+}
+
+/**
+ * EvaluateConstant - Fold an integer constant expression
+ *
+ * Arithmetic wraps like the generated code, in 64 bits; division by zero
+ * and overlong shifts are not constant.
+ */
+bool Parser::EvaluateConstant(Expr* expr, int64_t* value) const {
+    if (auto literal = dynamic_cast<LiteralExpr*>(expr)) {
+        switch (literal->GetLiteralKind()) {
+            case LiteralExpr::Kind::INT:
+                *value = literal->GetIntValue();
+                return true;
+            case LiteralExpr::Kind::CHAR:
+                *value = literal->GetCharValue();
+                return true;
+            case LiteralExpr::Kind::BOOL:
+                *value = literal->GetBoolValue() ? 1 : 0;
+                return true;
+            default:
+                return false;
         }
     }
     
-    return std::make_shared<EnumDecl>(name, type->GetBaseType(), value_pairs);
+    if (auto var = dynamic_cast<VarExpr*>(expr)) {
+        return types_.LookupEnumerator(var->GetName(), value) != nullptr;
+    }
+    
+    if (auto unary = dynamic_cast<UnaryExpr*>(expr)) {
+        int64_t operand;
+        if (!EvaluateConstant(unary->GetOperand(), &operand)) {
+            return false;
+        }
+        switch (unary->GetOp()) {
+            case UnaryExpr::Op::NEGATE:
+                *value = static_cast<int64_t>(0 - static_cast<uint64_t>(operand));
+                return true;
+            case UnaryExpr::Op::NOT:
+                *value = ~operand;
+                return true;
+            case UnaryExpr::Op::LOGICAL_NOT:
+                *value = !operand;
+                return true;
+            default:
+                return false;
+        }
+    }
+    
+    if (auto binary = dynamic_cast<BinaryExpr*>(expr)) {
+        int64_t lhs, rhs;
+        if (!EvaluateConstant(binary->GetLeft(), &lhs) || !EvaluateConstant(binary->GetRight(), &rhs)) {
+            return false;
+        }
+        uint64_t ulhs = static_cast<uint64_t>(lhs);
+        uint64_t urhs = static_cast<uint64_t>(rhs);
+        switch (binary->GetOp()) {
+            case BinaryExpr::Op::ADD:           *value = static_cast<int64_t>(ulhs + urhs); return true;
+            case BinaryExpr::Op::SUB:           *value = static_cast<int64_t>(ulhs - urhs); return true;
+            case BinaryExpr::Op::MUL:           *value = static_cast<int64_t>(ulhs * urhs); return true;
+            case BinaryExpr::Op::BIT_AND:       *value = lhs & rhs; return true;
+            case BinaryExpr::Op::BIT_OR:        *value = lhs | rhs; return true;
+            case BinaryExpr::Op::BIT_XOR:       *value = lhs ^ rhs; return true;
+            case BinaryExpr::Op::EQUAL:         *value = lhs == rhs; return true;
+            case BinaryExpr::Op::NOT_EQUAL:     *value = lhs != rhs; return true;
+            case BinaryExpr::Op::LESS:          *value = lhs < rhs; return true;
+            case BinaryExpr::Op::GREATER:       *value = lhs > rhs; return true;
+            case BinaryExpr::Op::LESS_EQUAL:    *value = lhs <= rhs; return true;
+            case BinaryExpr::Op::GREATER_EQUAL: *value = lhs >= rhs; return true;
+            case BinaryExpr::Op::LOGICAL_AND:   *value = lhs && rhs; return true;
+            case BinaryExpr::Op::LOGICAL_OR:    *value = lhs || rhs; return true;
+            case BinaryExpr::Op::DIV:
+            case BinaryExpr::Op::MOD:
+                if (rhs == 0 || (lhs == INT64_MIN && rhs == -1)) {
+                    return false;
+                }
+                *value = binary->GetOp() == BinaryExpr::Op::DIV ? lhs / rhs : lhs % rhs;
+                return true;
+            case BinaryExpr::Op::SHIFT_LEFT:
+            case BinaryExpr::Op::SHIFT_RIGHT:
+                if (rhs < 0 || rhs >= 64) {
+                    return false;
+                }
+                *value = binary->GetOp() == BinaryExpr::Op::SHIFT_LEFT
+                    ? static_cast<int64_t>(ulhs << rhs) : lhs >> rhs;
+                return true;
+        }
+    }
+    
+    return false;
 }
 
 /**
  * ParseFunctionDeclaration - Parse a function declaration
  */
-std::shared_ptr<FuncDecl> Parser::ParseFunctionDeclaration() {
+FuncDecl* Parser::ParseFunctionDeclaration() {
     // Function name
     if (!Check(TokenKind::IDENTIFIER)) {
         ReportError("Expected function name");
         return nullptr;
     }
     
-    std::string name = current_token_.GetLexeme();
+    Symbol name = tokens_->GetSymbol(pos_);
     Advance();
     
     // Function return type
@@ -527,7 +814,7 @@ std::shared_ptr<FuncDecl> Parser::ParseFunctionDeclaration() {
     // Function parameters
     Consume(TokenKind::LEFT_PAREN, "Expected '(' after function name");
     
-    std::vector<std::shared_ptr<ParamDecl>> parameters;
+    std::vector<ParamDecl*> parameters;
     
     if (!Check(TokenKind::RIGHT_PAREN)) {
         do {
@@ -541,7 +828,7 @@ std::shared_ptr<FuncDecl> Parser::ParseFunctionDeclaration() {
     Consume(TokenKind::RIGHT_PAREN, "Expected ')' after function parameters");
     
     // Function body
-    std::shared_ptr<BlockStmt> body = nullptr;
+    BlockStmt* body = nullptr;
     
     if (Match(TokenKind::SEMICOLON)) {
         // Function declaration without body
@@ -549,13 +836,13 @@ std::shared_ptr<FuncDecl> Parser::ParseFunctionDeclaration() {
         body = ParseBlockStatement();
     }
     
-    return std::make_shared<FuncDecl>(name, return_type, parameters, body);
+    return arena_->Create<FuncDecl>(name, return_type, arena_->CopyList<ParamDecl>(parameters), body);
 }
 
 /**
  * ParseMethodDeclaration - Parse a method declaration (Objective-C style)
  */
-std::shared_ptr<MethodDecl> Parser::ParseMethodDeclaration() {
+MethodDecl* Parser::ParseMethodDeclaration() {
     // Method return type
     auto return_type = ParseType();
     
@@ -570,11 +857,11 @@ std::shared_ptr<MethodDecl> Parser::ParseMethodDeclaration() {
         return nullptr;
     }
     
-    std::string selector = current_token_.GetLexeme();
+    std::string selector(tokens_->GetLexeme(pos_));
     Advance();
     
     // Method parameters
-    std::vector<std::shared_ptr<ParamDecl>> parameters;
+    std::vector<ParamDecl*> parameters;
     std::vector<std::string> selector_parts;
     
     if (Match(TokenKind::COLON)) {
@@ -588,7 +875,7 @@ std::shared_ptr<MethodDecl> Parser::ParseMethodDeclaration() {
             
             // Next selector part
             if (Check(TokenKind::IDENTIFIER) && CheckNext(TokenKind::COLON)) {
-                selector_parts.push_back(current_token_.GetLexeme());
+                selector_parts.emplace_back(tokens_->GetLexeme(pos_));
                 Advance();
                 Consume(TokenKind::COLON, "Expected ':' after selector part");
             }
@@ -602,7 +889,7 @@ std::shared_ptr<MethodDecl> Parser::ParseMethodDeclaration() {
     }
     
     // Method body
-    std::shared_ptr<BlockStmt> body = nullptr;
+    BlockStmt* body = nullptr;
     
     if (Match(TokenKind::SEMICOLON)) {
         // Method declaration without body
@@ -610,13 +897,14 @@ std::shared_ptr<MethodDecl> Parser::ParseMethodDeclaration() {
         body = ParseBlockStatement();
     }
     
-    return std::make_shared<MethodDecl>(full_selector, return_type, receiver_type, parameters, body);
+    return arena_->Create<MethodDecl>(Symbol::Intern(full_selector), return_type, receiver_type,
+                                     arena_->CopyList<ParamDecl>(parameters), body);
 }
 
 /**
  * ParseParameterDeclaration - Parse a parameter declaration
  */
-std::shared_ptr<ParamDecl> Parser::ParseParameterDeclaration() {
+ParamDecl* Parser::ParseParameterDeclaration() {
     // Parameter type
     auto type = ParseType();
     
@@ -626,16 +914,16 @@ std::shared_ptr<ParamDecl> Parser::ParseParameterDeclaration() {
         return nullptr;
     }
     
-    std::string name = current_token_.GetLexeme();
+    Symbol name = tokens_->GetSymbol(pos_);
     Advance();
     
-    return std::make_shared<ParamDecl>(name, type);
+    return arena_->Create<ParamDecl>(name, type);
 }
 
 /**
  * ParseVariableDeclaration - Parse a variable declaration
  */
-std::shared_ptr<VarDecl> Parser::ParseVariableDeclaration() {
+VarDecl* Parser::ParseVariableDeclaration() {
     // Variable type
     auto type = ParseType();
     
@@ -645,10 +933,10 @@ std::shared_ptr<VarDecl> Parser::ParseVariableDeclaration() {
         return nullptr;
     }
     
-    std::string name = current_token_.GetLexeme();
+    Symbol name = tokens_->GetSymbol(pos_);
     Advance();
     
-    std::shared_ptr<Expr> initializer = nullptr;
+    Expr* initializer = nullptr;
     
     // Check for initializer
     if (Match(TokenKind::EQUAL)) {
@@ -657,13 +945,13 @@ std::shared_ptr<VarDecl> Parser::ParseVariableDeclaration() {
     
     Consume(TokenKind::SEMICOLON, "Expected ';' after variable declaration");
     
-    return std::make_shared<VarDecl>(name, type, initializer);
+    return arena_->Create<VarDecl>(name, type, initializer);
 }
 
 /**
  * ParseStatement - Parse a statement
  */
-std::shared_ptr<Stmt> Parser::ParseStatement() {
+Stmt* Parser::ParseStatement() {
     if (Match(TokenKind::KW_IF)) {
         return ParseIfStatement();
     }
@@ -709,8 +997,8 @@ std::shared_ptr<Stmt> Parser::ParseStatement() {
 /**
  * ParseBlockStatement - Parse a block statement
  */
-std::shared_ptr<BlockStmt> Parser::ParseBlockStatement() {
-    std::vector<std::shared_ptr<Stmt>> statements;
+BlockStmt* Parser::ParseBlockStatement() {
+    std::vector<Stmt*> statements;
     
     while (!Check(TokenKind::RIGHT_BRACE) && !IsAtEnd()) {
         statements.push_back(ParseStatement());
@@ -718,49 +1006,49 @@ std::shared_ptr<BlockStmt> Parser::ParseBlockStatement() {
     
     Consume(TokenKind::RIGHT_BRACE, "Expected '}' after block");
     
-    return std::make_shared<BlockStmt>(statements);
+    return arena_->Create<BlockStmt>(arena_->CopyList<Stmt>(statements));
 }
 
 /**
  * ParseIfStatement - Parse an if statement
  */
-std::shared_ptr<IfStmt> Parser::ParseIfStatement() {
+IfStmt* Parser::ParseIfStatement() {
     Consume(TokenKind::LEFT_PAREN, "Expected '(' after 'if'");
     auto condition = ParseExpression();
     Consume(TokenKind::RIGHT_PAREN, "Expected ')' after if condition");
     
     auto then_branch = ParseStatement();
-    std::shared_ptr<Stmt> else_branch = nullptr;
+    Stmt* else_branch = nullptr;
     
     if (Match(TokenKind::KW_ELSE)) {
         else_branch = ParseStatement();
     }
     
-    return std::make_shared<IfStmt>(condition, then_branch, else_branch);
+    return arena_->Create<IfStmt>(condition, then_branch, else_branch);
 }
 
 /**
  * ParseWhileStatement - Parse a while statement
  */
-std::shared_ptr<WhileStmt> Parser::ParseWhileStatement() {
+WhileStmt* Parser::ParseWhileStatement() {
     Consume(TokenKind::LEFT_PAREN, "Expected '(' after 'while'");
     auto condition = ParseExpression();
     Consume(TokenKind::RIGHT_PAREN, "Expected ')' after while condition");
     
     auto body = ParseStatement();
     
-    return std::make_shared<WhileStmt>(condition, body);
+    return arena_->Create<WhileStmt>(condition, body);
 }
 
 /**
  * ParseForStatement - Parse a for statement
  */
-std::shared_ptr<ForStmt> Parser::ParseForStatement() {
+ForStmt* Parser::ParseForStatement() {
     Consume(TokenKind::LEFT_PAREN, "Expected '(' after 'for'");
     
-    std::shared_ptr<Stmt> initializer = nullptr;
-    std::shared_ptr<Expr> condition = nullptr;
-    std::shared_ptr<Expr> increment = nullptr;
+    Stmt* initializer = nullptr;
+    Expr* condition = nullptr;
+    Expr* increment = nullptr;
     
     // Initializer
     if (Match(TokenKind::SEMICOLON)) {
@@ -792,39 +1080,39 @@ std::shared_ptr<ForStmt> Parser::ParseForStatement() {
     
     auto body = ParseStatement();
     
-    return std::make_shared<ForStmt>(initializer, condition, increment, body);
+    return arena_->Create<ForStmt>(initializer, condition, increment, body);
 }
 
 /**
  * ParseExpressionStatement - Parse an expression statement
  */
-std::shared_ptr<ExprStmt> Parser::ParseExpressionStatement() {
+ExprStmt* Parser::ParseExpressionStatement() {
     auto expr = ParseExpression();
     
     Consume(TokenKind::SEMICOLON, "Expected ';' after expression");
     
-    return std::make_shared<ExprStmt>(expr);
+    return arena_->Create<ExprStmt>(expr);
 }
 
 /**
  * ParseDeclarationStatement - Parse a declaration statement
  */
-std::shared_ptr<DeclStmt> Parser::ParseDeclarationStatement() {
-    auto decl = std::dynamic_pointer_cast<VarDecl>(ParseDeclaration());
+DeclStmt* Parser::ParseDeclarationStatement() {
+    auto decl = dynamic_cast<VarDecl*>(ParseDeclaration());
     
     if (!decl) {
         ReportError("Expected variable declaration");
         return nullptr;
     }
     
-    return std::make_shared<DeclStmt>(decl);
+    return arena_->Create<DeclStmt>(decl);
 }
 
 /**
  * ParseReturnStatement - Parse a return statement
  */
-std::shared_ptr<ReturnStmt> Parser::ParseReturnStatement() {
-    std::shared_ptr<Expr> value = nullptr;
+ReturnStmt* Parser::ParseReturnStatement() {
+    Expr* value = nullptr;
     
     // Check if the return statement has a value
     if (!Check(TokenKind::SEMICOLON)) {
@@ -833,23 +1121,23 @@ std::shared_ptr<ReturnStmt> Parser::ParseReturnStatement() {
     
     Consume(TokenKind::SEMICOLON, "Expected ';' after return value");
     
-    return std::make_shared<ReturnStmt>(value);
+    return arena_->Create<ReturnStmt>(value);
 }
 
 /**
  * ParseBreakStatement - Parse a break statement
  */
-std::shared_ptr<BreakStmt> Parser::ParseBreakStatement() {
+BreakStmt* Parser::ParseBreakStatement() {
     Consume(TokenKind::SEMICOLON, "Expected ';' after 'break'");
-    return std::make_shared<BreakStmt>();
+    return arena_->Create<BreakStmt>();
 }
 
 /**
  * ParseContinueStatement - Parse a continue statement
  */
-std::shared_ptr<ContinueStmt> Parser::ParseContinueStatement() {
+ContinueStmt* Parser::ParseContinueStatement() {
     Consume(TokenKind::SEMICOLON, "Expected ';' after 'continue'");
-    return std::make_shared<ContinueStmt>();
+    return arena_->Create<ContinueStmt>();
 }
 
 //===----------------------------------------------------------------------===//
@@ -861,6 +1149,6 @@ std::shared_ptr<ContinueStmt> Parser::ParseContinueStatement() {
  * 
  * This is the top-level expression parsing function.
  */
-std::shared_ptr<Expr> Parser::ParseExpression() {
+Expr* Parser::ParseExpression() {
     return ParseAssignment();
 }
@@ -9,39 +9,118 @@
 #define DSLANG_PARSER_H
 
 #include "lexer.h"
+#include "tokenbuffer.h"
 #include "ast.h"
 #include "type.h"
 #include <memory>
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace dsLang {
 
 class DiagnosticReporter;
 
+/**
+ * ParseCache - Top-level declarations remembered between parses of a file
+ * 
+ * Each entry maps a hash of a declaration's tokens (kinds and spellings,
+ * not positions) to the Decl built from them and the arena it lives in.
+ * Entries keep the tokens themselves too, since a hash match alone does
+ * not prove the declaration is unchanged.
+ * A cache must always be used with the same TypeContext, since cached
+ * declarations point at its types.
+ */
+class ParseCache {
+public:
+    ParseCache() : reused_count_(0), parsed_count_(0) {}
+    
+    /**
+     * Clear - Forget every cached declaration
+     */
+    void Clear() { decls_.clear(); }
+    
+    /**
+     * GetReusedCount - Declarations reused by the last incremental parse
+     */
+    size_t GetReusedCount() const { return reused_count_; }
+    
+    /**
+     * GetParsedCount - Declarations parsed by the last incremental parse
+     */
+    size_t GetParsedCount() const { return parsed_count_; }
+    
+private:
+    friend class Parser;
+    
+    struct Entry {
+        Decl* decl;                                             // The declaration
+        std::vector<std::pair<TokenKind, std::string>> tokens;  // Tokens it was parsed from
+        std::shared_ptr<ASTArena> arena;                        // Arena holding its nodes
+    };
+    
+    std::unordered_multimap<uint64_t, Entry> decls_;    // Entries by token hash
+    size_t reused_count_;                               // Reused by the last parse
+    size_t parsed_count_;                               // Parsed by the last parse
+};
+
 /**
  * Parser - Parser for dsLang
  * 
  * The parser converts a sequence of tokens into an Abstract Syntax Tree (AST).
  * It uses a recursive descent parsing approach.
+ * 
+ * The parser works over a TokenBuffer and addresses tokens by index, so
+ * lookahead of any distance and backtracking (Mark/Reset) are O(1).
  */
 class Parser {
 public:
     /**
      * Constructor - Initialize the parser with a lexer
      * 
+     * The lexer's entire input is tokenized up front into a buffer owned
+     * by the parser.
+     * 
      * @param lexer The lexer to get tokens from
      * @param diag_reporter The diagnostic reporter for error handling
+     * @param types The type context that owns all types the parser creates
      */
-    Parser(Lexer& lexer, DiagnosticReporter& diag_reporter);
+    Parser(Lexer& lexer, DiagnosticReporter& diag_reporter, TypeContext& types);
+    
+    /**
+     * Constructor - Initialize the parser with pre-lexed tokens
+     * 
+     * @param tokens The tokens to parse; must outlive the parser
+     * @param diag_reporter The diagnostic reporter for error handling
+     * @param types The type context that owns all types the parser creates
+     */
+    Parser(const TokenBuffer& tokens, DiagnosticReporter& diag_reporter, TypeContext& types);
     
     /**
      * Parse - Parse the source code and build an AST
      * 
-     * @return The root node of the AST
+     * @return The root node of the AST, which owns all of the tree's nodes
      */
-    std::shared_ptr<CompilationUnit> Parse();
+    std::unique_ptr<CompilationUnit> Parse();
+    
+    /**
+     * ParseIncremental - Parse, reusing unchanged top-level declarations
+     * 
+     * Each top-level declaration's token range is hashed; declarations
+     * whose tokens match an entry in the cache are reused as-is and only
+     * the others are parsed. Declarations that parsed with errors are never
+     * cached, so their diagnostics are reported again on the next parse.
+     * The struct and enum types defined by cached declarations are emptied
+     * first and redefined by whichever declarations define them this time.
+     * On return the cache holds exactly the declarations of the new unit.
+     * 
+     * @param cache The declarations of earlier parses of the same file
+     * @return The root node of the AST, which shares unchanged nodes with
+     *         earlier units
+     */
+    std::unique_ptr<CompilationUnit> ParseIncremental(ParseCache& cache);
     
     /**
      * HasErrors - Check if any errors were encountered during parsing
@@ -70,10 +149,8 @@ private:
     
     /**
      * Advance - Advance to the next token
-     * 
-     * @return The consumed token
      */
-    Token Advance();
+    void Advance();
     
     /**
      * Peek - Peek at the current token
@@ -89,6 +166,21 @@ private:
      */
     Token PeekNext() const;
     
+    /**
+     * PeekAhead - Peek at a token further ahead
+     * 
+     * @param distance How many tokens past the current one (0 is the current token)
+     * @return The token, or END_OF_FILE if past the end
+     */
+    Token PeekAhead(size_t distance) const;
+    
+    /**
+     * Previous - Get the most recently consumed token
+     * 
+     * @return The previous token
+     */
+    Token Previous() const;
+    
     /**
      * Check - Check if the current token is of the expected kind
      * 
@@ -105,6 +197,29 @@ private:
      */
     bool CheckNext(TokenKind kind) const;
     
+    /**
+     * CheckAhead - Check the kind of a token further ahead
+     * 
+     * @param distance How many tokens past the current one (0 is the current token)
+     * @param kind The expected token kind
+     * @return True if the token is of the expected kind, false otherwise
+     */
+    bool CheckAhead(size_t distance, TokenKind kind) const;
+    
+    /**
+     * Mark - Remember the current position for backtracking
+     * 
+     * @return The position to pass to Reset
+     */
+    size_t Mark() const { return pos_; }
+    
+    /**
+     * Reset - Return to a position saved by Mark
+     * 
+     * @param mark The saved position
+     */
+    void Reset(size_t mark) { pos_ = mark; }
+    
     /**
      * IsAtEnd - Check if we've reached the end of the token stream
      * 
@@ -135,63 +250,75 @@ private:
      * 
      * @return The compilation unit node
      */
-    std::shared_ptr<CompilationUnit> ParseCompilationUnit();
+    std::unique_ptr<CompilationUnit> ParseCompilationUnit();
     
     /**
      * ParseDeclaration - Parse a declaration
      * 
      * @return The declaration node
      */
-    std::shared_ptr<Decl> ParseDeclaration();
+    Decl* ParseDeclaration();
     
     /**
      * ParseFunctionDeclaration - Parse a function declaration
      * 
      * @return The function declaration node
      */
-    std::shared_ptr<FuncDecl> ParseFunctionDeclaration();
+    FuncDecl* ParseFunctionDeclaration();
     
     /**
      * ParseMethodDeclaration - Parse a method declaration (Objective-C style)
      * 
      * @return The method declaration node
      */
-    std::shared_ptr<MethodDecl> ParseMethodDeclaration();
+    MethodDecl* ParseMethodDeclaration();
     
     /**
      * ParseVariableDeclaration - Parse a variable declaration
      * 
      * @return The variable declaration node
      */
-    std::shared_ptr<VarDecl> ParseVariableDeclaration();
+    VarDecl* ParseVariableDeclaration();
     
     /**
      * ParseParameterDeclaration - Parse a parameter declaration
      * 
      * @return The parameter declaration node
      */
-    std::shared_ptr<ParamDecl> ParseParameterDeclaration();
+    ParamDecl* ParseParameterDeclaration();
     
     /**
      * ParseStructDeclaration - Parse a struct declaration
      * 
      * @return The struct declaration node
      */
-    std::shared_ptr<StructDecl> ParseStructDeclaration();
+    StructDecl* ParseStructDeclaration();
     
     /**
      * ParseEnumDeclaration - Parse an enum declaration
      * 
      * @return The enum declaration node
      */
-    std::shared_ptr<EnumDecl> ParseEnumDeclaration();
+    EnumDecl* ParseEnumDeclaration();
+    
+    /**
+     * EvaluateConstant - Fold an integer constant expression
+     * 
+     * Literals, earlier enumerators and the non-assigning operators on them
+     * are constant.
+     * 
+     * @param expr The expression
+     * @param value Receives the value
+     * @return False if the expression is not constant or cannot be evaluated
+     */
+    bool EvaluateConstant(Expr* expr, int64_t* value) const;
     
     /**
      * ParseType - Parse a type
      * 
      * @return The type
      */
-    std::shared_ptr<Type> ParseType();
+    Type* ParseType();
     
     //===----------------------------------------------------------------------===//
     // Statements
@@ -202,70 +329,70 @@ private:
      * 
      * @return The statement node
      */
-    std::shared_ptr<Stmt> ParseStatement();
+    Stmt* ParseStatement();
     
     /**
      * ParseBlockStatement - Parse a block statement
      * 
      * @return The block statement node
      */
-    std::shared_ptr<BlockStmt> ParseBlockStatement();
+    BlockStmt* ParseBlockStatement();
     
     /**
      * ParseExpressionStatement - Parse an expression statement
      * 
      * @return The expression statement node
      */
-    std::shared_ptr<ExprStmt> ParseExpressionStatement();
+    ExprStmt* ParseExpressionStatement();
     
     /**
      * ParseIfStatement - Parse an if statement
      * 
      * @return The if statement node
      */
-    std::shared_ptr<IfStmt> ParseIfStatement();
+    IfStmt* ParseIfStatement();
     
     /**
      * ParseWhileStatement - Parse a while statement
      * 
      * @return The while statement node
      */
-    std::shared_ptr<WhileStmt> ParseWhileStatement();
+    WhileStmt* ParseWhileStatement();
     
     /**
      * ParseForStatement - Parse a for statement
      * 
      * @return The for statement node
      */
-    std::shared_ptr<ForStmt> ParseForStatement();
+    ForStmt* ParseForStatement();
     
     /**
      * ParseReturnStatement - Parse a return statement
      * 
      * @return The return statement node
      */
-    std::shared_ptr<ReturnStmt> ParseReturnStatement();
+    ReturnStmt* ParseReturnStatement();
     
     /**
      * ParseBreakStatement - Parse a break statement
      * 
      * @return The break statement node
      */
-    std::shared_ptr<BreakStmt> ParseBreakStatement();
+    BreakStmt* ParseBreakStatement();
     
     /**
      * ParseContinueStatement - Parse a continue statement
      * 
      * @return The continue statement node
      */
-    std::shared_ptr<ContinueStmt> ParseContinueStatement();
+    ContinueStmt* ParseContinueStatement();
     
     /**
      * ParseDeclarationStatement - Parse a declaration statement
      * 
      * @return The declaration statement node
      */
-    std::shared_ptr<DeclStmt> ParseDeclarationStatement();
+    DeclStmt* ParseDeclarationStatement();
     
     //===----------------------------------------------------------------------===//
     // Expressions
@@ -276,112 +403,112 @@ private:
      * 
      * @return The expression node
      */
-    std::shared_ptr<Expr> ParseExpression();
+    Expr* ParseExpression();
     
     /**
      * ParseAssignment - Parse an assignment expression
      * 
      * @return The assignment expression node
      */
-    std::shared_ptr<Expr> ParseAssignment();
+    Expr* ParseAssignment();
     
     /**
      * ParseLogicalOr - Parse a logical OR expression
      * 
      * @return The logical OR expression node
      */
-    std::shared_ptr<Expr> ParseLogicalOr();
+    Expr* ParseLogicalOr();
     
     /**
      * ParseLogicalAnd - Parse a logical AND expression
      * 
      * @return The logical AND expression node
      */
-    std::shared_ptr<Expr> ParseLogicalAnd();
+    Expr* ParseLogicalAnd();
     
     /**
      * ParseEquality - Parse an equality expression
      * 
      * @return The equality expression node
      */
-    std::shared_ptr<Expr> ParseEquality();
+    Expr* ParseEquality();
     
     /**
      * ParseComparison - Parse a comparison expression
      * 
      * @return The comparison expression node
      */
-    std::shared_ptr<Expr> ParseComparison();
+    Expr* ParseComparison();
     
     /**
      * ParseBitwiseOr - Parse a bitwise OR expression
      * 
      * @return The bitwise OR expression node
      */
-    std::shared_ptr<Expr> ParseBitwiseOr();
+    Expr* ParseBitwiseOr();
     
     /**
      * ParseBitwiseXor - Parse a bitwise XOR expression
      * 
      * @return The bitwise XOR expression node
      */
-    std::shared_ptr<Expr> ParseBitwiseXor();
+    Expr* ParseBitwiseXor();
     
     /**
      * ParseBitwiseAnd - Parse a bitwise AND expression
      * 
      * @return The bitwise AND expression node
      */
-    std::shared_ptr<Expr> ParseBitwiseAnd();
+    Expr* ParseBitwiseAnd();
     
     /**
      * ParseShift - Parse a shift expression
      * 
      * @return The shift expression node
      */
-    std::shared_ptr<Expr> ParseShift();
+    Expr* ParseShift();
     
     /**
      * ParseAdditive - Parse an additive expression
      * 
      * @return The additive expression node
      */
-    std::shared_ptr<Expr> ParseAdditive();
+    Expr* ParseAdditive();
     
     /**
      * ParseMultiplicative - Parse a multiplicative expression
      * 
      * @return The multiplicative expression node
      */
-    std::shared_ptr<Expr> ParseMultiplicative();
+    Expr* ParseMultiplicative();
     
     /**
      * ParseUnary - Parse a unary expression
      * 
      * @return The unary expression node
      */
-    std::shared_ptr<Expr> ParseUnary();
+    Expr* ParseUnary();
     
     /**
      * ParsePostfix - Parse a postfix expression
      * 
      * @return The postfix expression node
      */
-    std::shared_ptr<Expr> ParsePostfix();
+    Expr* ParsePostfix();
     
     /**
      * ParsePrimary - Parse a primary expression
      * 
      * @return The primary expression node
      */
-    std::shared_ptr<Expr> ParsePrimary();
+    Expr* ParsePrimary();
     
     /**
      * ParseMessageExpression - Parse a message expression (Objective-C style)
      * 
      * @return The message expression node
      */
-    std::shared_ptr<Expr> ParseMessageExpression();
+    Expr* ParseMessageExpression();
     
     /**
      * ParseFunctionCall - Parse a function call
@@ -389,7 +516,7 @@ private:
      * @param callee The function being called
      * @return The function call expression node
      */
-    std::shared_ptr<Expr> ParseFunctionCall(std::shared_ptr<Expr> callee);
+    Expr* ParseFunctionCall(Expr* callee);
     
     /**
      * ParseSubscript - Parse an array subscript
@@ -397,14 +524,14 @@ private:
      * @param array The array expression
      * @return The subscript expression node
      */
-    std::shared_ptr<Expr> ParseSubscript(std::shared_ptr<Expr> array);
+    Expr* ParseSubscript(Expr* array);
     
     /**
      * ParseCastExpression - Parse a cast expression
      * 
      * @return The cast expression node
      */
-    std::shared_ptr<Expr> ParseCastExpression();
+    Expr* ParseCastExpression();
     
     //===----------------------------------------------------------------------===//
     // Helper Methods
@@ -418,9 +545,9 @@ private:
      * @param right The right operand
      * @return The binary expression node
      */
-    std::shared_ptr<BinaryExpr> MakeBinaryExpr(BinaryExpr::Op op, 
-                                               std::shared_ptr<Expr> left, 
-                                               std::shared_ptr<Expr> right);
+    BinaryExpr* MakeBinaryExpr(BinaryExpr::Op op, 
+                               Expr* left, 
+                               Expr* right);
     
     /**
      * MakeUnaryExpr - Create a unary expression node
@@ -429,8 +556,51 @@ private:
      * @param operand The operand
      * @return The unary expression node
      */
-    std::shared_ptr<UnaryExpr> MakeUnaryExpr(UnaryExpr::Op op, 
-                                             std::shared_ptr<Expr> operand);
+    UnaryExpr* MakeUnaryExpr(UnaryExpr::Op op, 
+                             Expr* operand);
+    
+    /**
+     * FindDeclarationEnd - Find the end of the top-level declaration at a token
+     * 
+     * A declaration ends after a ';' outside any brackets, or after the '}'
+     * that closes its outermost brace (plus one ';' directly after it).
+     * 
+     * @param start The index of the declaration's first token
+     * @return The index just past its last token
+     */
+    size_t FindDeclarationEnd(size_t start) const;
+    
+    /**
+     * HashTokens - Hash the kinds and spellings of a range of tokens
+     */
+    uint64_t HashTokens(size_t begin, size_t end) const;
+    
+    /**
+     * CopyTokens - Copy the kinds and spellings of a range of tokens
+     */
+    std::vector<std::pair<TokenKind, std::string>> CopyTokens(size_t begin, size_t end) const;
+    
+    /**
+     * SameTokens - Check if a range of tokens has the given kinds and spellings
+     */
+    bool SameTokens(const std::vector<std::pair<TokenKind, std::string>>& tokens,
+                    size_t begin, size_t end) const;
+    
+    /**
+     * ResetDeclaredType - Empty the struct or enum type a declaration defined
+     * 
+     * @param decl A declaration from an earlier parse
+     */
+    void ResetDeclaredType(Decl* decl);
+    
+    /**
+     * RestoreDeclaredType - Define a struct or enum type again from a reused declaration
+     * 
+     * Reports a redefinition if the type was already defined by this parse.
+     * 
+     * @param decl A declaration reused from an earlier parse
+     */
+    void RestoreDeclaredType(Decl* decl);
     
     /**
      * CreateType - Create a type from the specified tokens
@@ -439,17 +609,17 @@ private:
      * @param is_unsigned Whether the type is unsigned
      * @return The type
      */
-    std::shared_ptr<Type> CreateType(const Token& type_token, bool is_unsigned);
+    Type* CreateType(const Token& type_token, bool is_unsigned);
     
 private:
-    Lexer& lexer_;                                   // The lexer to get tokens from
+    std::unique_ptr<TokenBuffer> owned_tokens_;      // Tokens lexed by this parser, if any
+    const TokenBuffer* tokens_;                      // The tokens being parsed
+    size_t pos_;                                     // Index of the current token
     DiagnosticReporter& diag_reporter_;              // The diagnostic reporter
-    Token current_token_;                            // The current token
     bool has_errors_ = false;                        // Whether any errors were encountered
-    
-    // Type cache to avoid creating duplicate types
-    std::unordered_map<std::string, std::shared_ptr<StructType>> struct_types_;
-    std::unordered_map<std::string, std::shared_ptr<EnumType>> enum_types_;
+    std::unique_ptr<ASTArena> arena_;                // Arena for the unit being parsed
+    TypeContext& types_;                             // Owner of all types
+    std::unordered_set<const Type*> defined_types_;  // Structs and enums defined by this parse
 };
 
 } // namespace dsLang
@@ -0,0 +1,277 @@
+/**
+ * server.cpp - Resident Compile Server Implementation for dsLang
+ *
+ * This file implements the request loop and handlers of `dscc --server`.
+ */
+
+#include "server.h"
+#include "codegen.h"
+#include "lexer.h"
+#include "sema.h"
+#include <sstream>
+
+namespace dsLang {
+
+namespace {
+
+/**
+ * ErrorCapture - Collect what is printed to std::cerr while it is alive
+ *
+ * The code generator reports its failures on std::cerr, which a client
+ * talking to the server over stdin and stdout would never see. Requests
+ * are served one at a time, so swapping the stream buffer is safe.
+ */
+class ErrorCapture {
+public:
+    ErrorCapture() : saved_(std::cerr.rdbuf(buffer_.rdbuf())) {}
+    ~ErrorCapture() { std::cerr.rdbuf(saved_); }
+
+    ErrorCapture(const ErrorCapture&) = delete;
+    ErrorCapture& operator=(const ErrorCapture&) = delete;
+
+    /**
+     * GetText - Get everything printed so far
+     */
+    std::string GetText() const { return buffer_.str(); }
+
+private:
+    std::ostringstream buffer_;     // Receives std::cerr's output
+    std::streambuf* saved_;         // std::cerr's own buffer
+};
+
+} // anonymous namespace
+
+/**
+ * Constructor
+ */
+CompileServer::CompileServer(std::istream& in, std::ostream& out)
+    : in_(in), out_(out) {
+}
+
+/**
+ * Run - Serve requests until shutdown or end of input
+ */
+int CompileServer::Run() {
+    std::string line;
+    bool shutdown = false;
+
+    while (!shutdown && std::getline(in_, line)) {
+        if (line.find_first_not_of(" \t\r") == std::string::npos) {
+            continue;
+        }
+
+        JsonValue request;
+        std::string error;
+        JsonValue response;
+        if (!JsonValue::Parse(line, &request, &error) || !request.IsObject()) {
+            response = JsonValue::Object();
+            response.Set("ok", false);
+            response.Set("error", error.empty() ? "request must be a JSON object" : error);
+        } else {
+            response = HandleRequest(request, &shutdown);
+        }
+
+        out_ << response.Serialize() << '\n';
+        out_.flush();
+    }
+    return 0;
+}
+
+/**
+ * HandleRequest - Dispatch one request on its method
+ */
+JsonValue CompileServer::HandleRequest(const JsonValue& request, bool* shutdown) {
+    const std::string& method = request["method"].AsString();
+    JsonValue response;
+
+    if (method == "check") {
+        response = HandleCheck(request);
+    } else if (method == "compile") {
+        response = HandleCompile(request);
+    } else if (method == "forget") {
+        units_.erase(request["file"].AsString());
+        response = JsonValue::Object();
+        response.Set("ok", true);
+    } else if (method == "shutdown") {
+        *shutdown = true;
+        response = JsonValue::Object();
+        response.Set("ok", true);
+    } else {
+        response = JsonValue::Object();
+        response.Set("ok", false);
+        response.Set("error", "unknown method '" + method + "'");
+    }
+
+    // Put the id first so clients can match responses at a glance
+    JsonValue result = JsonValue::Object();
+    result.Set("id", request["id"]);
+    for (const char* key : {"ok", "error", "cached", "output", "log", "diagnostics"}) {
+        const JsonValue& value = response[key];
+        if (!value.IsNull()) {
+            result.Set(key, value);
+        }
+    }
+    return result;
+}
+
+/**
+ * HandleCheck - Parse and analyze a file, reporting diagnostics only
+ */
+JsonValue CompileServer::HandleCheck(const JsonValue& request) {
+    JsonValue response = JsonValue::Object();
+    bool cached = false;
+    std::string error;
+
+    AnalyzedUnit* analyzed = Analyze(request, &cached, &error);
+    if (!analyzed) {
+        response.Set("ok", false);
+        response.Set("error", error);
+        return response;
+    }
+
+    response.Set("ok", !analyzed->diagnostics.HasErrors());
+    response.Set("cached", cached);
+    response.Set("diagnostics", DiagnosticsToJson(analyzed->diagnostics));
+    return response;
+}
+
+/**
+ * HandleCompile - Analyze a file and write its object or assembly output
+ */
+JsonValue CompileServer::HandleCompile(const JsonValue& request) {
+    JsonValue response = JsonValue::Object();
+    bool cached = false;
+    std::string error;
+
+    AnalyzedUnit* analyzed = Analyze(request, &cached, &error);
+    if (!analyzed) {
+        response.Set("ok", false);
+        response.Set("error", error);
+        return response;
+    }
+
+    response.Set("cached", cached);
+    response.Set("diagnostics", DiagnosticsToJson(analyzed->diagnostics));
+    if (analyzed->diagnostics.HasErrors()) {
+        response.Set("ok", false);
+        return response;
+    }
+
+    const std::string& output = request["output"].AsString();
+    if (output.empty()) {
+        response.Set("ok", false);
+        response.Set("error", "compile request has no \"output\"");
+        return response;
+    }
+
+    double opt = request["opt"].AsNumber(0);
+    unsigned opt_level = opt <= 0 ? 0 : opt >= 3 ? 3 : static_cast<unsigned>(opt);
+
+    // A fresh LLVMContext per request; targets and TargetMachines are
+    // pooled process-wide, so this is cheap after the first compile
+    bool written;
+    std::string log;
+    {
+        ErrorCapture capture;
+        CodeGenerator codegen(analyzed->source->GetName(), "x86_64-elf", opt_level);
+        written = codegen.Generate(analyzed->unit.get()) &&
+                  (request["assembly"].AsBool() ? codegen.EmitAssembly(output)
+                                                : codegen.EmitObject(output));
+        log = capture.GetText();
+    }
+    if (!log.empty()) {
+        response.Set("log", log);
+    }
+    response.Set("ok", written);
+    if (written) {
+        response.Set("output", output);
+    } else {
+        response.Set("error", "code generation failed");
+    }
+    return response;
+}
+
+/**
+ * Analyze - Get the up-to-date analyzed unit for a request
+ */
+CompileServer::AnalyzedUnit* CompileServer::Analyze(const JsonValue& request, bool* cached,
+                                                    std::string* error) {
+    const std::string& file = request["file"].AsString();
+    if (file.empty()) {
+        *error = "request has no \"file\"";
+        return nullptr;
+    }
+
+    // Unsaved editor contents take precedence over the file on disk
+    std::shared_ptr<SourceBuffer> source;
+    const JsonValue& text = request["text"];
+    if (text.IsString()) {
+        source = SourceBuffer::FromString(text.AsString(), file);
+    } else {
+        source = SourceBuffer::OpenFile(file, error);
+        if (!source) {
+            return nullptr;
+        }
+    }
+
+    // Reuse the previous analysis if the text is unchanged
+    std::unique_ptr<AnalyzedUnit>& slot = units_[file];
+    if (slot && slot->source->GetText() == source->GetText()) {
+        *cached = true;
+        return slot.get();
+    }
+
+    // Carry the types and parse cache over from the previous version so
+    // that unchanged declarations are reused rather than reparsed. The
+    // cached declarations' struct and enum types are reset and redefined
+    // by ParseIncremental, so edited or deleted ones keep no stale layout.
+    auto analyzed = std::make_unique<AnalyzedUnit>();
+    analyzed->source = source;
+    if (slot) {
+        analyzed->types = std::move(slot->types);
+        analyzed->parse_cache = std::move(slot->parse_cache);
+    } else {
+        analyzed->types = std::make_unique<TypeContext>();
+        analyzed->parse_cache = std::make_unique<ParseCache>();
+    }
+
+    Lexer lexer(source);
+    lexer.SetDiagnosticReporter(&analyzed->diagnostics);
+    Parser parser(lexer, analyzed->diagnostics, *analyzed->types);
+    analyzed->unit = parser.ParseIncremental(*analyzed->parse_cache);
+
+    if (!analyzed->diagnostics.HasErrors()) {
+        auto semantic_analyzer = CreateSemanticAnalyzer(analyzed->diagnostics);
+        semantic_analyzer->Analyze(analyzed->unit.get());
+    }
+
+    slot = std::move(analyzed);
+    *cached = false;
+    return slot.get();
+}
+
+/**
+ * DiagnosticsToJson - Convert reported diagnostics to the wire format
+ */
+JsonValue CompileServer::DiagnosticsToJson(const DiagnosticReporter& diagnostics) {
+    JsonValue result = JsonValue::Array();
+    for (const auto& diagnostic : diagnostics.GetDiagnostics()) {
+        const char* severity = "note";
+        switch (diagnostic.GetLevel()) {
+            case Diagnostic::Level::ERROR: severity = "error"; break;
+            case Diagnostic::Level::WARNING: severity = "warning"; break;
+            case Diagnostic::Level::NOTE: severity = "note"; break;
+        }
+
+        JsonValue entry = JsonValue::Object();
+        entry.Set("file", diagnostic.GetFilename());
+        entry.Set("line", diagnostic.GetLine());
+        entry.Set("column", diagnostic.GetColumn());
+        entry.Set("severity", severity);
+        entry.Set("message", diagnostic.GetMessage());
+        result.Push(std::move(entry));
+    }
+    return result;
+}
+
+} // namespace dsLang
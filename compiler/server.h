@@ -0,0 +1,102 @@
+/**
+ * server.h - Resident Compile Server for dsLang
+ *
+ * This file defines the CompileServer class behind `dscc --server`. The
+ * server stays resident and answers compile and check requests from an
+ * editor, keeping parsed units and LLVM backend state warm between
+ * requests.
+ *
+ * Protocol: one JSON object per line on stdin, one JSON response per line
+ * on stdout, in request order.
+ *
+ *   {"id": 1, "method": "check", "file": "kernel.ds", "text": "..."}
+ *   {"id": 2, "method": "compile", "file": "kernel.ds", "output": "kernel.o",
+ *    "opt": 2, "assembly": false}
+ *   {"id": 3, "method": "forget", "file": "kernel.ds"}
+ *   {"id": 4, "method": "shutdown"}
+ *
+ * "text" is optional and holds unsaved editor contents; without it the file
+ * is read from disk. Every response echoes "id" and has "ok" plus a
+ * "diagnostics" array of {"file", "line", "column", "severity", "message"}.
+ * "cached" reports whether the parsed unit was reused, and "log" holds any
+ * messages code generation printed (such as why it failed). Malformed
+ * requests get {"ok": false, "error": "..."}.
+ */
+
+#ifndef DSLANG_SERVER_H
+#define DSLANG_SERVER_H
+
+#include "ast.h"
+#include "diagnostic.h"
+#include "json.h"
+#include "parser.h"
+#include "source.h"
+#include "type.h"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+namespace dsLang {
+
+/**
+ * CompileServer - Answers compile requests over a line-based JSON protocol
+ */
+class CompileServer {
+public:
+    /**
+     * Constructor
+     *
+     * @param in The stream requests are read from
+     * @param out The stream responses are written to
+     */
+    CompileServer(std::istream& in, std::ostream& out);
+
+    /**
+     * Run - Serve requests until shutdown or end of input
+     *
+     * @return The process exit code
+     */
+    int Run();
+
+private:
+    /**
+     * AnalyzedUnit - A parsed and checked source file kept between requests
+     */
+    struct AnalyzedUnit {
+        std::shared_ptr<SourceBuffer> source;           // The text the unit was built from
+        std::unique_ptr<TypeContext> types;             // Types of the unit
+        std::unique_ptr<ParseCache> parse_cache;        // Declarations kept for reparsing
+        std::unique_ptr<CompilationUnit> unit;          // The AST
+        DiagnosticReporter diagnostics;                 // Lexer, parser and sema output
+
+        AnalyzedUnit() : diagnostics(false) {}
+    };
+
+    JsonValue HandleRequest(const JsonValue& request, bool* shutdown);
+    JsonValue HandleCheck(const JsonValue& request);
+    JsonValue HandleCompile(const JsonValue& request);
+
+    /**
+     * Analyze - Get the up-to-date analyzed unit for a request
+     *
+     * Reuses the cached unit if the source text has not changed, and
+     * otherwise reparses incrementally, reusing unchanged declarations.
+     *
+     * @param request The request naming the file and optional text
+     * @param cached Set to whether the cached unit was reused
+     * @param error Receives a description of the failure, if any
+     * @return The unit, or nullptr if the source could not be read
+     */
+    AnalyzedUnit* Analyze(const JsonValue& request, bool* cached, std::string* error);
+
+    static JsonValue DiagnosticsToJson(const DiagnosticReporter& diagnostics);
+
+    std::istream& in_;                                                  // Request stream
+    std::ostream& out_;                                                 // Response stream
+    std::unordered_map<std::string, std::unique_ptr<AnalyzedUnit>> units_;  // Units by file
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_SERVER_H
@@ -0,0 +1,65 @@
+/**
+ * shard.cpp - Parallel Code Generation Implementation for dsLang
+ *
+ * This file implements splitting code generation for one compilation unit
+ * across a pool of threads.
+ */
+
+#include "shard.h"
+#include "codegen.h"
+#include "threadpool.h"
+#include <llvm/Support/TimeProfiler.h>
+
+namespace dsLang {
+
+/**
+ * EmitShards - Generate and emit a compilation unit as several objects
+ */
+bool EmitShards(CompilationUnit* unit, const std::string& module_name,
+                const std::string& target_triple,
+                const std::vector<std::string>& output_filenames,
+                bool output_assembly, unsigned opt_level) {
+    unsigned shard_count = static_cast<unsigned>(output_filenames.size());
+    std::vector<char> succeeded(shard_count, 0);
+
+    {
+        ThreadPool pool(shard_count);
+        for (unsigned i = 0; i < shard_count; ++i) {
+            pool.Submit([&, i] {
+                llvm::TimeTraceScope scope("Code generation shard", output_filenames[i]);
+                CodeGenerator codegen(module_name + ".part" + std::to_string(i), target_triple,
+                                      opt_level);
+                codegen.SetShard(i, shard_count);
+                if (!codegen.Generate(unit)) {
+                    return;
+                }
+                succeeded[i] = output_assembly ? codegen.EmitAssembly(output_filenames[i])
+                                               : codegen.EmitObject(output_filenames[i]);
+            });
+        }
+        pool.Wait();
+    }
+
+    for (char ok : succeeded) {
+        if (!ok) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * GetShardFilename - Get the output file of one shard
+ */
+std::string GetShardFilename(const std::string& output_filename, unsigned shard_index) {
+    std::string part = ".part" + std::to_string(shard_index);
+
+    size_t dot_pos = output_filename.find_last_of('.');
+    size_t slash_pos = output_filename.find_last_of('/');
+    if (dot_pos == std::string::npos || (slash_pos != std::string::npos && dot_pos < slash_pos)) {
+        return output_filename + part;
+    }
+    return output_filename.substr(0, dot_pos) + part + output_filename.substr(dot_pos);
+}
+
+} // namespace dsLang
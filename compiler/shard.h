@@ -0,0 +1,50 @@
+/**
+ * shard.h - Parallel Code Generation for dsLang
+ *
+ * This file declares EmitShards, which splits one compilation unit's
+ * functions across several code generators running on their own threads
+ * and writes one object file per shard, in the style of LLVM's split-module
+ * code generation.
+ */
+
+#ifndef DSLANG_SHARD_H
+#define DSLANG_SHARD_H
+
+#include "ast.h"
+#include <string>
+#include <vector>
+
+namespace dsLang {
+
+/**
+ * EmitShards - Generate and emit a compilation unit as several objects
+ *
+ * One shard is created per output file. Each shard gets its own
+ * CodeGenerator (and so its own LLVMContext) and runs on its own thread;
+ * the AST and its types are only read. Linking all the outputs together
+ * is equivalent to linking the single object the unsharded path emits.
+ *
+ * @param unit The compilation unit to generate
+ * @param module_name The base name of the shard modules
+ * @param target_triple The target to generate code for
+ * @param output_filenames One output file per shard
+ * @param output_assembly Emit assembly instead of object code
+ * @param opt_level The optimization level (0-3)
+ * @return True if every shard was generated and written
+ */
+bool EmitShards(CompilationUnit* unit, const std::string& module_name,
+                const std::string& target_triple,
+                const std::vector<std::string>& output_filenames,
+                bool output_assembly, unsigned opt_level);
+
+/**
+ * GetShardFilename - Get the output file of one shard
+ *
+ * The shard number is inserted before the extension, so "kernel.o" becomes
+ * "kernel.part0.o", "kernel.part1.o" and so on.
+ */
+std::string GetShardFilename(const std::string& output_filename, unsigned shard_index);
+
+} // namespace dsLang
+
+#endif // DSLANG_SHARD_H
@@ -0,0 +1,94 @@
+/**
+ * source.cpp - Source Buffer Implementation for dsLang
+ *
+ * This file implements memory-mapped and in-memory source buffers.
+ */
+
+#include "source.h"
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace dsLang {
+
+/**
+ * OpenFile - Memory-map a source file
+ */
+std::shared_ptr<SourceBuffer> SourceBuffer::OpenFile(const std::string& filename,
+                                                     std::string* error) {
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer(filename));
+
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        if (error) {
+            *error = strerror(errno);
+        }
+        return nullptr;
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+        // Empty files cannot be mapped, but they are valid (empty) sources
+        if (st.st_size == 0) {
+            ::close(fd);
+            return buffer;
+        }
+
+        void* addr = ::mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        if (addr != MAP_FAILED) {
+            // The lexer walks the file front to back exactly once
+            ::madvise(addr, static_cast<size_t>(st.st_size), MADV_SEQUENTIAL);
+            ::close(fd);
+
+            buffer->data_ = static_cast<const char*>(addr);
+            buffer->size_ = static_cast<size_t>(st.st_size);
+            buffer->mapped_ = true;
+            return buffer;
+        }
+    }
+    ::close(fd);
+
+    // Not a regular file or mmap failed, read it the slow way
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open()) {
+        if (error) {
+            *error = strerror(errno);
+        }
+        return nullptr;
+    }
+
+    std::stringstream contents;
+    contents << file.rdbuf();
+    buffer->storage_ = contents.str();
+    buffer->data_ = buffer->storage_.data();
+    buffer->size_ = buffer->storage_.size();
+    return buffer;
+}
+
+/**
+ * FromString - Create a buffer holding a copy of in-memory source text
+ */
+std::shared_ptr<SourceBuffer> SourceBuffer::FromString(const std::string& text,
+                                                       const std::string& name) {
+    std::shared_ptr<SourceBuffer> buffer(new SourceBuffer(name));
+    buffer->storage_ = text;
+    buffer->data_ = buffer->storage_.data();
+    buffer->size_ = buffer->storage_.size();
+    return buffer;
+}
+
+/**
+ * Destructor - Unmap or release the underlying storage
+ */
+SourceBuffer::~SourceBuffer() {
+    if (mapped_) {
+        ::munmap(const_cast<char*>(data_), size_);
+    }
+}
+
+} // namespace dsLang
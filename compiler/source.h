@@ -0,0 +1,90 @@
+/**
+ * source.h - Source Buffers for dsLang
+ *
+ * This file defines the SourceBuffer class which holds the text of a source
+ * file for the lifetime of a compilation. Files are memory-mapped when
+ * possible so that the lexer and its tokens can refer directly into the
+ * mapped bytes instead of copying them.
+ */
+
+#ifndef DSLANG_SOURCE_H
+#define DSLANG_SOURCE_H
+
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace dsLang {
+
+/**
+ * SourceBuffer - Immutable view of a source file's contents
+ *
+ * A SourceBuffer either owns a memory mapping of a file or a heap copy of
+ * an in-memory string. Either way the bytes never move, so string_views
+ * handed out by GetText() stay valid for as long as the buffer is alive.
+ */
+class SourceBuffer {
+public:
+    /**
+     * OpenFile - Memory-map a source file
+     *
+     * Falls back to reading the file into memory if it cannot be mapped.
+     *
+     * @param filename The path of the file to open
+     * @param error Receives a description of the failure, if any
+     * @return The buffer, or nullptr if the file could not be read
+     */
+    static std::shared_ptr<SourceBuffer> OpenFile(const std::string& filename,
+                                                  std::string* error = nullptr);
+
+    /**
+     * FromString - Create a buffer holding a copy of in-memory source text
+     *
+     * @param text The source text
+     * @param name The name used for diagnostics
+     * @return The buffer
+     */
+    static std::shared_ptr<SourceBuffer> FromString(const std::string& text,
+                                                    const std::string& name);
+
+    /**
+     * Destructor - Unmap or release the underlying storage
+     */
+    ~SourceBuffer();
+
+    SourceBuffer(const SourceBuffer&) = delete;
+    SourceBuffer& operator=(const SourceBuffer&) = delete;
+
+    /**
+     * GetText - Get the full source text
+     */
+    std::string_view GetText() const { return std::string_view(data_, size_); }
+
+    /**
+     * GetSize - Get the size of the source text in bytes
+     */
+    size_t GetSize() const { return size_; }
+
+    /**
+     * GetName - Get the name of the source (usually the file path)
+     */
+    const std::string& GetName() const { return name_; }
+
+    /**
+     * IsMapped - Check if the buffer is backed by a memory mapping
+     */
+    bool IsMapped() const { return mapped_; }
+
+private:
+    SourceBuffer(const std::string& name) : name_(name) {}
+
+    std::string name_;          // The source name
+    std::string storage_;       // Owned text when not memory-mapped
+    const char* data_ = "";     // Start of the source text
+    size_t size_ = 0;           // Length of the source text
+    bool mapped_ = false;       // Whether data_ is an mmap'd region
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_SOURCE_H
@@ -0,0 +1,115 @@
+/**
+ * symbol.cpp - Interned Identifier Implementation for dsLang
+ *
+ * This file implements the process-wide intern table behind Symbol.
+ */
+
+#include "symbol.h"
+#include <atomic>
+#include <cstdlib>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace dsLang {
+
+namespace {
+
+/**
+ * SymbolTable - Process-wide table of interned names
+ *
+ * Names are stored in fixed-size chunks that never move, so GetName can
+ * index them without taking the lock and the lookup map can key on views
+ * into the stored strings.
+ */
+class SymbolTable {
+public:
+    static constexpr uint32_t kChunkBits = 12;
+    static constexpr uint32_t kChunkSize = 1u << kChunkBits;
+    static constexpr uint32_t kMaxChunks = 1u << 12;
+
+    static SymbolTable& Get() {
+        static SymbolTable table;
+        return table;
+    }
+
+    ~SymbolTable() {
+        for (auto& chunk : chunks_) {
+            delete[] chunk.load(std::memory_order_relaxed);
+        }
+    }
+
+    uint32_t Intern(std::string_view name) {
+        {
+            std::shared_lock<std::shared_mutex> lock(mutex_);
+            auto it = ids_.find(name);
+            if (it != ids_.end()) {
+                return it->second;
+            }
+        }
+
+        std::unique_lock<std::shared_mutex> lock(mutex_);
+
+        // Another thread may have interned the name while we were unlocked
+        auto it = ids_.find(name);
+        if (it != ids_.end()) {
+            return it->second;
+        }
+
+        uint32_t id = count_++;
+        uint32_t chunk_index = id >> kChunkBits;
+        if (chunk_index >= kMaxChunks) {
+            // Sixteen million distinct identifiers; nothing sensible to do
+            std::abort();
+        }
+
+        std::string* chunk = chunks_[chunk_index].load(std::memory_order_relaxed);
+        if (!chunk) {
+            chunk = new std::string[kChunkSize];
+            chunks_[chunk_index].store(chunk, std::memory_order_release);
+        }
+
+        std::string& slot = chunk[id & (kChunkSize - 1)];
+        slot.assign(name.data(), name.size());
+        ids_.emplace(std::string_view(slot), id);
+        return id;
+    }
+
+    const std::string& GetName(uint32_t id) const {
+        std::string* chunk = chunks_[id >> kChunkBits].load(std::memory_order_acquire);
+        return chunk[id & (kChunkSize - 1)];
+    }
+
+private:
+    SymbolTable() : count_(0) {
+        for (auto& chunk : chunks_) {
+            chunk.store(nullptr, std::memory_order_relaxed);
+        }
+
+        // Id 0 is the empty symbol
+        Intern(std::string_view());
+    }
+
+    mutable std::shared_mutex mutex_;                       // Guards ids_ and count_
+    std::unordered_map<std::string_view, uint32_t> ids_;    // Name -> id
+    std::atomic<std::string*> chunks_[kMaxChunks];          // Stable name storage
+    uint32_t count_;                                        // Number of interned names
+};
+
+} // anonymous namespace
+
+/**
+ * Intern - Get the symbol for a piece of text
+ */
+Symbol Symbol::Intern(std::string_view name) {
+    return Symbol(SymbolTable::Get().Intern(name));
+}
+
+/**
+ * GetName - Get the text of the symbol
+ */
+const std::string& Symbol::GetName() const {
+    return SymbolTable::Get().GetName(id_);
+}
+
+} // namespace dsLang
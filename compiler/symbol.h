@@ -0,0 +1,85 @@
+/**
+ * symbol.h - Interned Identifiers for dsLang
+ *
+ * This file defines the Symbol class, a compact handle to an identifier
+ * stored once in a process-wide intern table. The lexer interns identifiers
+ * as it scans them, and the AST and code generator carry and compare the
+ * resulting symbols instead of strings.
+ */
+
+#ifndef DSLANG_SYMBOL_H
+#define DSLANG_SYMBOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+
+namespace dsLang {
+
+/**
+ * Symbol - Interned identifier
+ *
+ * Two symbols are equal if and only if they were interned from the same
+ * text, so comparing and hashing a symbol is an integer operation. The
+ * default-constructed symbol is the empty string. Interning is thread-safe
+ * and interned names live until the process exits.
+ */
+class Symbol {
+public:
+    /**
+     * Default constructor - The empty symbol
+     */
+    Symbol() : id_(0) {}
+
+    /**
+     * Intern - Get the symbol for a piece of text
+     *
+     * @param name The identifier text
+     * @return The unique symbol for that text
+     */
+    static Symbol Intern(std::string_view name);
+
+    /**
+     * GetName - Get the text of the symbol
+     */
+    const std::string& GetName() const;
+
+    /**
+     * GetId - Get the dense integer id of the symbol
+     */
+    uint32_t GetId() const { return id_; }
+
+    /**
+     * IsEmpty - Check if this is the empty symbol
+     */
+    bool IsEmpty() const { return id_ == 0; }
+
+    bool operator==(Symbol other) const { return id_ == other.id_; }
+    bool operator!=(Symbol other) const { return id_ != other.id_; }
+    bool operator<(Symbol other) const { return id_ < other.id_; }
+
+private:
+    explicit Symbol(uint32_t id) : id_(id) {}
+
+    uint32_t id_;   // Index into the intern table
+};
+
+} // namespace dsLang
+
+namespace std {
+
+/**
+ * hash<Symbol> - Symbols hash to their id
+ */
+template <>
+struct hash<dsLang::Symbol> {
+    size_t operator()(dsLang::Symbol symbol) const noexcept {
+        return symbol.GetId();
+    }
+};
+
+} // namespace std
+
+#endif // DSLANG_SYMBOL_H
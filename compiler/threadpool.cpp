@@ -0,0 +1,97 @@
+/**
+ * threadpool.cpp - Worker Threads Implementation for dsLang
+ *
+ * This file implements the ThreadPool class.
+ */
+
+#include "threadpool.h"
+#include "timing.h"
+
+namespace dsLang {
+
+/**
+ * Constructor - Start the workers
+ */
+ThreadPool::ThreadPool(size_t thread_count) : active_(0), stopping_(false) {
+    if (thread_count == 0) {
+        thread_count = GetDefaultThreadCount();
+    }
+
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i) {
+        workers_.emplace_back(&ThreadPool::WorkerLoop, this);
+    }
+}
+
+/**
+ * Destructor - Finish all queued jobs and join the workers
+ */
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    job_ready_.notify_all();
+
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+/**
+ * Submit - Queue a job
+ */
+void ThreadPool::Submit(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        jobs_.push_back(std::move(job));
+    }
+    job_ready_.notify_one();
+}
+
+/**
+ * Wait - Block until every queued job has finished
+ */
+void ThreadPool::Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    all_done_.wait(lock, [this] { return jobs_.empty() && active_ == 0; });
+}
+
+/**
+ * GetDefaultThreadCount - Get the number of hardware threads (at least 1)
+ */
+size_t ThreadPool::GetDefaultThreadCount() {
+    unsigned count = std::thread::hardware_concurrency();
+    return count ? count : 1;
+}
+
+/**
+ * WorkerLoop - Run jobs until the pool is stopped and the queue is empty
+ */
+void ThreadPool::WorkerLoop() {
+    ScopedThreadTrace trace("dscc-worker");
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true) {
+        job_ready_.wait(lock, [this] { return stopping_ || !jobs_.empty(); });
+        if (jobs_.empty()) {
+            // Stopping, and nothing left to run
+            return;
+        }
+
+        std::function<void()> job = std::move(jobs_.front());
+        jobs_.pop_front();
+        ++active_;
+
+        lock.unlock();
+        job();
+        lock.lock();
+
+        --active_;
+        if (jobs_.empty() && active_ == 0) {
+            all_done_.notify_all();
+        }
+    }
+}
+
+} // namespace dsLang
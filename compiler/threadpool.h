@@ -0,0 +1,80 @@
+/**
+ * threadpool.h - Worker Threads for dsLang
+ *
+ * This file defines the ThreadPool class, a fixed set of worker threads
+ * that run queued jobs. The driver uses it to compile several source files
+ * at once.
+ */
+
+#ifndef DSLANG_THREADPOOL_H
+#define DSLANG_THREADPOOL_H
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace dsLang {
+
+/**
+ * ThreadPool - Fixed-size pool of worker threads
+ *
+ * Jobs are run in the order they were queued, each on whichever worker is
+ * free first. Jobs must not throw. Destroying the pool waits for every
+ * queued job to finish.
+ */
+class ThreadPool {
+public:
+    /**
+     * Constructor - Start the workers
+     *
+     * @param thread_count The number of workers; 0 means one per hardware thread
+     */
+    explicit ThreadPool(size_t thread_count = 0);
+
+    /**
+     * Destructor - Finish all queued jobs and join the workers
+     */
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Submit - Queue a job
+     */
+    void Submit(std::function<void()> job);
+
+    /**
+     * Wait - Block until every queued job has finished
+     */
+    void Wait();
+
+    /**
+     * GetThreadCount - Get the number of workers
+     */
+    size_t GetThreadCount() const { return workers_.size(); }
+
+    /**
+     * GetDefaultThreadCount - Get the number of hardware threads (at least 1)
+     */
+    static size_t GetDefaultThreadCount();
+
+private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers_;              // The worker threads
+    std::deque<std::function<void()>> jobs_;        // Jobs not yet started
+    std::mutex mutex_;                              // Guards everything below
+    std::condition_variable job_ready_;             // Signalled when a job is queued
+    std::condition_variable all_done_;              // Signalled when the pool goes idle
+    size_t active_;                                 // Jobs currently running
+    bool stopping_;                                 // Set by the destructor
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_THREADPOOL_H
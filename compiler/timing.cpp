@@ -0,0 +1,520 @@
+/**
+ * timing.cpp - Compile Time and Memory Instrumentation Implementation for dsLang
+ *
+ * This file implements heap counting, thread CPU time, time traces,
+ * TimeReport and ScopedTimer.
+ */
+
+#include "timing.h"
+#include <llvm/Support/FileSystem.h>
+#include <llvm/Support/Threading.h>
+#include <llvm/Support/TimeProfiler.h>
+#include <llvm/Support/raw_ostream.h>
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <new>
+
+// Counted blocks carry a header, allocated with posix_memalign when they
+// are over-aligned. Builds with DSLANG_NO_HEAP_COUNTING keep the standard
+// allocation functions.
+#if !defined(DSLANG_NO_HEAP_COUNTING) && (defined(__unix__) || defined(__APPLE__))
+#define DSLANG_COUNT_HEAP 1
+#endif
+
+namespace dsLang {
+
+namespace {
+
+std::atomic<bool> heap_counting(false);     // Whether allocations are counted
+std::atomic<int64_t> live_bytes(0);         // Bytes allocated and not yet freed
+std::atomic<int64_t> peak_bytes(0);         // Highest live_bytes since the last reset
+
+std::atomic<bool> time_tracing(false);      // Whether -ftime-trace is recording
+unsigned trace_granularity = 0;             // Shortest span kept, in microseconds
+std::string trace_process_name;             // Process name in the trace
+
+// Phases are listed this many at a time; the JSON report has all of them
+constexpr size_t kMaxPrintedFunctions = 15;
+constexpr size_t kMaxPrintedPasses = 20;
+
+} // anonymous namespace
+
+#ifdef DSLANG_COUNT_HEAP
+
+/**
+ * BlockHeader - What the allocation functions keep in front of each block
+ *
+ * Only blocks allocated while counting is on are subtracted when freed, so
+ * freeing older blocks cannot make the live heap (and the figures derived
+ * from it) go negative.
+ */
+struct alignas(std::max_align_t) BlockHeader {
+    int64_t counted_size;       // Bytes added to live_bytes, or 0 if not counted
+};
+
+/**
+ * GetHeaderSize - Get the space in front of a block, keeping its alignment
+ */
+static std::size_t GetHeaderSize(std::size_t alignment) {
+    return std::max(sizeof(BlockHeader), alignment);
+}
+
+/**
+ * GetHeader - Get the header of a block
+ */
+static BlockHeader* GetHeader(void* ptr) {
+    return static_cast<BlockHeader*>(ptr) - 1;
+}
+
+/**
+ * CountAllocation - Add a new block to the live heap if counting is on
+ */
+static void CountAllocation(BlockHeader* header, std::size_t size) {
+    header->counted_size = 0;
+    if (!heap_counting.load(std::memory_order_relaxed)) {
+        return;
+    }
+    header->counted_size = static_cast<int64_t>(size);
+    int64_t live = live_bytes.fetch_add(header->counted_size, std::memory_order_relaxed) + header->counted_size;
+    int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+    while (live > peak && !peak_bytes.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+}
+
+/**
+ * CountDeallocation - Remove a block from the live heap if it was counted
+ */
+static void CountDeallocation(BlockHeader* header) {
+    if (header->counted_size) {
+        live_bytes.fetch_sub(header->counted_size, std::memory_order_relaxed);
+    }
+}
+
+/**
+ * Allocate - Allocate a counted block, retrying through the new handler
+ *
+ * Throws std::bad_alloc once there is no new handler left to try, like
+ * the standard operator new.
+ *
+ * @param size The size of the block
+ * @param alignment The block's alignment, or 0 for the default
+ */
+static void* Allocate(std::size_t size, std::size_t alignment) {
+    std::size_t header_size = GetHeaderSize(alignment);
+    if (size > SIZE_MAX - header_size) {
+        throw std::bad_alloc();
+    }
+    for (;;) {
+        void* raw = nullptr;
+        if (alignment <= alignof(std::max_align_t)) {
+            raw = std::malloc(header_size + size);
+        } else if (posix_memalign(&raw, alignment, header_size + size) != 0) {
+            raw = nullptr;
+        }
+        if (raw) {
+            void* ptr = static_cast<char*>(raw) + header_size;
+            CountAllocation(GetHeader(ptr), size);
+            return ptr;
+        }
+
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+/**
+ * AllocateNothrow - Allocate a counted block, or return null on failure
+ *
+ * A new handler may throw std::bad_alloc, so this catches rather than
+ * only checking for a missing handler.
+ */
+static void* AllocateNothrow(std::size_t size, std::size_t alignment) noexcept {
+    try {
+        return Allocate(size, alignment);
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+/**
+ * Deallocate - Free a block from Allocate
+ *
+ * @param ptr The block, or null
+ * @param alignment The alignment it was allocated with, or 0 for the default
+ */
+static void Deallocate(void* ptr, std::size_t alignment) {
+    if (!ptr) {
+        return;
+    }
+    CountDeallocation(GetHeader(ptr));
+    std::free(static_cast<char*>(ptr) - GetHeaderSize(alignment));
+}
+
+#endif // DSLANG_COUNT_HEAP
+
+/**
+ * EnableHeapCounting - Start counting heap allocations
+ */
+bool EnableHeapCounting() {
+#ifdef DSLANG_COUNT_HEAP
+    heap_counting.store(true);
+    return true;
+#else
+    return false;
+#endif
+}
+
+/**
+ * IsHeapCountingEnabled - Check if heap allocations are being counted
+ */
+bool IsHeapCountingEnabled() {
+    return heap_counting.load(std::memory_order_relaxed);
+}
+
+/**
+ * GetThreadCpuSeconds - Get the CPU time used by the calling thread
+ */
+double GetThreadCpuSeconds() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+        return 0;
+    }
+    return static_cast<double>(ts.tv_sec) + static_cast<double>(ts.tv_nsec) * 1e-9;
+}
+
+//===----------------------------------------------------------------------===//
+// Time traces
+//===----------------------------------------------------------------------===//
+
+/**
+ * StartTimeTrace - Start recording a -ftime-trace timeline
+ */
+void StartTimeTrace(unsigned granularity_us, const std::string& process_name) {
+    trace_granularity = granularity_us;
+    trace_process_name = process_name;
+    llvm::timeTraceProfilerInitialize(trace_granularity, trace_process_name);
+    time_tracing.store(true);
+}
+
+/**
+ * FinishTimeTrace - Stop recording and write the timeline as JSON
+ */
+bool FinishTimeTrace(const std::string& filename) {
+    time_tracing.store(false);
+
+    std::error_code ec;
+    llvm::raw_fd_ostream out(filename, ec, llvm::sys::fs::OF_Text);
+    if (!ec) {
+        llvm::timeTraceProfilerWrite(out);
+        out.close();
+    }
+    llvm::timeTraceProfilerCleanup();
+    return !ec && !out.has_error();
+}
+
+/**
+ * Constructor - Start recording this thread if a trace is running
+ */
+ScopedThreadTrace::ScopedThreadTrace(const char* thread_name)
+    : active_(time_tracing.load()) {
+    if (active_) {
+        llvm::set_thread_name(thread_name);
+        llvm::timeTraceProfilerInitialize(trace_granularity, trace_process_name);
+    }
+}
+
+/**
+ * Destructor - Hand this thread's spans over to the trace
+ */
+ScopedThreadTrace::~ScopedThreadTrace() {
+    if (active_) {
+        llvm::timeTraceProfilerFinishThread();
+    }
+}
+
+//===----------------------------------------------------------------------===//
+// TimeReport
+//===----------------------------------------------------------------------===//
+
+/**
+ * Constructor
+ */
+TimeReport::TimeReport(std::string filename)
+    : filename_(std::move(filename)) {
+}
+
+/**
+ * Add - Add a measurement, merging it into any record of the same name
+ */
+void TimeReport::Add(const TimeRecord& record) {
+    std::string key = record.group + '\0' + record.name;
+    auto it = index_.find(key);
+    if (it == index_.end()) {
+        index_.emplace(std::move(key), records_.size());
+        records_.push_back(record);
+        return;
+    }
+
+    TimeRecord& merged = records_[it->second];
+    merged.wall += record.wall;
+    merged.cpu += record.cpu;
+    merged.peak_bytes = std::max(merged.peak_bytes, record.peak_bytes);
+    merged.net_bytes += record.net_bytes;
+    merged.count += record.count;
+}
+
+/**
+ * Print - Print the report as a table
+ */
+void TimeReport::Print(std::ostream& os) const {
+    char line[256];
+
+    // Passes are timed by LLVM callbacks, which do not measure the heap
+    auto print_section = [&](const char* group, const char* title, size_t limit) {
+        bool memory = IsHeapCountingEnabled() && std::string(group) != "pass";
+        std::vector<const TimeRecord*> selected;
+        for (const auto& record : records_) {
+            if (record.group == group) {
+                selected.push_back(&record);
+            }
+        }
+        if (selected.empty()) {
+            return;
+        }
+
+        // Phases keep pipeline order; everything else is slowest first
+        if (limit) {
+            std::stable_sort(selected.begin(), selected.end(),
+                             [](const TimeRecord* a, const TimeRecord* b) { return a->wall > b->wall; });
+        }
+
+        os << "\n";
+        if (memory) {
+            std::snprintf(line, sizeof(line), "  %10s %10s %11s %11s %6s  %s\n",
+                          "Wall (s)", "CPU (s)", "Peak (KiB)", "Net (KiB)", "Runs", title);
+        } else {
+            std::snprintf(line, sizeof(line), "  %10s %10s %6s  %s\n",
+                          "Wall (s)", "CPU (s)", "Runs", title);
+        }
+        os << line;
+
+        size_t printed = 0;
+        for (const TimeRecord* record : selected) {
+            if (limit && printed == limit) {
+                os << "  ... " << selected.size() - printed << " more in the JSON report\n";
+                break;
+            }
+            if (memory) {
+                std::snprintf(line, sizeof(line), "  %10.4f %10.4f %11.1f %11.1f %6u  ",
+                              record->wall, record->cpu, record->peak_bytes / 1024.0,
+                              record->net_bytes / 1024.0, record->count);
+            } else {
+                std::snprintf(line, sizeof(line), "  %10.4f %10.4f %6u  ",
+                              record->wall, record->cpu, record->count);
+            }
+            os << line << record->name << "\n";
+            printed++;
+        }
+    };
+
+    os << "===-------------------------------------------------------------------------===\n";
+    os << "  Compile time report: " << filename_ << "\n";
+    os << "===-------------------------------------------------------------------------===\n";
+    print_section("phase", "Phase", 0);
+    print_section("function", "Function (IR generation)", kMaxPrintedFunctions);
+    print_section("pass", "LLVM pass (self time)", kMaxPrintedPasses);
+    os << "\n";
+}
+
+/**
+ * ToJson - Get the complete report as JSON
+ */
+JsonValue TimeReport::ToJson() const {
+    bool memory = IsHeapCountingEnabled();
+    JsonValue phases = JsonValue::Array();
+    JsonValue functions = JsonValue::Array();
+    JsonValue passes = JsonValue::Array();
+
+    for (const auto& record : records_) {
+        JsonValue entry = JsonValue::Object();
+        entry.Set("name", record.name);
+        entry.Set("wall", record.wall);
+        entry.Set("cpu", record.cpu);
+        entry.Set("count", record.count);
+        if (memory && record.group != "pass") {
+            entry.Set("peak_bytes", static_cast<double>(record.peak_bytes));
+            entry.Set("net_bytes", static_cast<double>(record.net_bytes));
+        }
+
+        if (record.group == "function") {
+            functions.Push(std::move(entry));
+        } else if (record.group == "pass") {
+            passes.Push(std::move(entry));
+        } else {
+            phases.Push(std::move(entry));
+        }
+    }
+
+    JsonValue report = JsonValue::Object();
+    report.Set("file", filename_);
+    report.Set("phases", std::move(phases));
+    report.Set("functions", std::move(functions));
+    report.Set("passes", std::move(passes));
+    return report;
+}
+
+//===----------------------------------------------------------------------===//
+// ScopedTimer
+//===----------------------------------------------------------------------===//
+
+/**
+ * Constructor - Start measuring
+ */
+ScopedTimer::ScopedTimer(TimeReport* report, std::string name, const char* group)
+    : report_(report), name_(report ? std::move(name) : std::string()), group_(group) {
+    if (!report_) {
+        return;
+    }
+
+    // Measure this timer's peak from the current level, remembering the
+    // enclosing timer's peak so far
+    live_start_ = live_bytes.load(std::memory_order_relaxed);
+    outer_peak_ = peak_bytes.exchange(live_start_, std::memory_order_relaxed);
+
+    // Function and pass spans come from the code generator and optimizer
+    tracing_ = std::strcmp(group_, "phase") == 0 && llvm::timeTraceProfilerEnabled();
+    if (tracing_) {
+        llvm::timeTraceProfilerBegin(name_, report_->GetFilename());
+    }
+
+    cpu_start_ = GetThreadCpuSeconds();
+    wall_start_ = std::chrono::steady_clock::now();
+}
+
+/**
+ * Destructor - Stop measuring and add the record
+ */
+ScopedTimer::~ScopedTimer() {
+    if (!report_) {
+        return;
+    }
+
+    std::chrono::duration<double> wall = std::chrono::steady_clock::now() - wall_start_;
+    if (tracing_) {
+        llvm::timeTraceProfilerEnd();
+    }
+
+    TimeRecord record;
+    record.name = std::move(name_);
+    record.group = group_;
+    record.wall = wall.count();
+    record.cpu = GetThreadCpuSeconds() - cpu_start_;
+    record.count = 1;
+
+    // Fold this peak back into the enclosing timer's
+    int64_t peak = peak_bytes.load(std::memory_order_relaxed);
+    peak_bytes.store(std::max(peak, outer_peak_), std::memory_order_relaxed);
+    record.peak_bytes = peak - live_start_;
+    record.net_bytes = live_bytes.load(std::memory_order_relaxed) - live_start_;
+
+    report_->Add(record);
+}
+
+} // namespace dsLang
+
+#ifdef DSLANG_COUNT_HEAP
+
+//===----------------------------------------------------------------------===//
+// Replacement global allocation functions, for heap counting. Every block
+// has a header, so the aligned forms are replaced too.
+//===----------------------------------------------------------------------===//
+
+void* operator new(std::size_t size) {
+    return dsLang::Allocate(size, 0);
+}
+
+void* operator new[](std::size_t size) {
+    return dsLang::Allocate(size, 0);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return dsLang::AllocateNothrow(size, 0);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return dsLang::AllocateNothrow(size, 0);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    return dsLang::Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return dsLang::Allocate(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return dsLang::AllocateNothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return dsLang::AllocateNothrow(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr) noexcept {
+    dsLang::Deallocate(ptr, 0);
+}
+
+void operator delete[](void* ptr) noexcept {
+    dsLang::Deallocate(ptr, 0);
+}
+
+void operator delete(void* ptr, std::size_t) noexcept {
+    dsLang::Deallocate(ptr, 0);
+}
+
+void operator delete[](void* ptr, std::size_t) noexcept {
+    dsLang::Deallocate(ptr, 0);
+}
+
+void operator delete(void* ptr, const std::nothrow_t&) noexcept {
+    dsLang::Deallocate(ptr, 0);
+}
+
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept {
+    dsLang::Deallocate(ptr, 0);
+}
+
+void operator delete(void* ptr, std::align_val_t alignment) noexcept {
+    dsLang::Deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment) noexcept {
+    dsLang::Deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    dsLang::Deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::size_t, std::align_val_t alignment) noexcept {
+    dsLang::Deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    dsLang::Deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+
+void operator delete[](void* ptr, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    dsLang::Deallocate(ptr, static_cast<std::size_t>(alignment));
+}
+
+#endif // DSLANG_COUNT_HEAP
@@ -0,0 +1,189 @@
+/**
+ * timing.h - Compile Time and Memory Instrumentation for dsLang
+ *
+ * This file defines TimeReport, which collects how long each phase of one
+ * compile took (wall-clock and CPU time) and how much heap it used, and
+ * ScopedTimer, which measures one phase into a report. It backs
+ * -ftime-report and -fmem-report.
+ *
+ * Records belong to a group: "phase" for the pipeline stages, "function"
+ * for the IR generation of single functions and "pass" for LLVM passes.
+ * Records with the same group and name are merged, so a pass that runs on
+ * every function appears once with its total time and run count.
+ *
+ * Heap figures come from counting operator new and delete, which is off
+ * unless EnableHeapCounting() is called; until then each allocation only
+ * pays for a small header and one relaxed atomic load. Blocks allocated
+ * before counting started are not subtracted when they are freed. Building
+ * with HEAP_COUNTING=0 (which defines DSLANG_NO_HEAP_COUNTING) keeps the
+ * standard operator new and delete and drops heap counting altogether. The
+ * counters are process-wide, so they are only meaningful while one file is
+ * compiled at a time. Pass records carry no heap figures.
+ *
+ * It also drives -ftime-trace, a Chrome trace-event timeline of the whole
+ * process recorded by LLVM's time trace profiler. Phase timers show up in
+ * it as spans, next to the spans the code generator, the optimizer and
+ * LLVM's back end add, with one row per ThreadPool worker.
+ */
+
+#ifndef DSLANG_TIMING_H
+#define DSLANG_TIMING_H
+
+#include "json.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace dsLang {
+
+/**
+ * EnableHeapCounting - Start counting heap allocations
+ *
+ * @return False if heap counting is not supported on this host or was
+ *         left out of the build
+ */
+bool EnableHeapCounting();
+
+/**
+ * IsHeapCountingEnabled - Check if heap allocations are being counted
+ */
+bool IsHeapCountingEnabled();
+
+/**
+ * GetThreadCpuSeconds - Get the CPU time used by the calling thread
+ */
+double GetThreadCpuSeconds();
+
+/**
+ * StartTimeTrace - Start recording a -ftime-trace timeline
+ *
+ * Records the calling thread, and every ThreadPool worker started from now
+ * on. Spans shorter than the granularity are left out.
+ *
+ * @param granularity_us Shortest span to keep, in microseconds
+ * @param process_name Name of the process in the trace
+ */
+void StartTimeTrace(unsigned granularity_us, const std::string& process_name);
+
+/**
+ * FinishTimeTrace - Stop recording and write the timeline as JSON
+ *
+ * Must be called on the thread that started the trace, once every worker
+ * started since has exited.
+ *
+ * @param filename File to write, or "-" for stdout
+ * @return False if the file could not be written
+ */
+bool FinishTimeTrace(const std::string& filename);
+
+/**
+ * ScopedThreadTrace - Records the calling worker thread while tracing
+ *
+ * Each thread keeps its own spans; they are handed over to the trace when
+ * this object is destroyed, so it must live as long as the thread's work.
+ */
+class ScopedThreadTrace {
+public:
+    explicit ScopedThreadTrace(const char* thread_name);
+    ~ScopedThreadTrace();
+
+    ScopedThreadTrace(const ScopedThreadTrace&) = delete;
+    ScopedThreadTrace& operator=(const ScopedThreadTrace&) = delete;
+
+private:
+    bool active_;       // Whether this thread is being recorded
+};
+
+/**
+ * TimeRecord - Time and memory used by one phase, function or pass
+ */
+struct TimeRecord {
+    std::string name;           // What was measured
+    std::string group;          // "phase", "function" or "pass"
+    double wall = 0;            // Wall-clock seconds
+    double cpu = 0;             // CPU seconds of the measuring thread
+    int64_t peak_bytes = 0;     // Highest heap growth while running
+    int64_t net_bytes = 0;      // Heap growth still live at the end
+    unsigned count = 0;         // Number of runs merged into this record
+};
+
+/**
+ * TimeReport - Timings of one compile
+ *
+ * Not thread-safe; each compile owns its report.
+ */
+class TimeReport {
+public:
+    /**
+     * Constructor
+     *
+     * @param filename The file being compiled
+     */
+    explicit TimeReport(std::string filename);
+
+    /**
+     * GetFilename - Get the file being compiled
+     */
+    const std::string& GetFilename() const { return filename_; }
+
+    /**
+     * Add - Add a measurement, merging it into any record of the same name
+     */
+    void Add(const TimeRecord& record);
+
+    /**
+     * GetRecords - Get the records in the order they were first added
+     */
+    const std::vector<TimeRecord>& GetRecords() const { return records_; }
+
+    /**
+     * Print - Print the report as a table
+     *
+     * Phases are listed in pipeline order; functions and passes are listed
+     * slowest first, up to a limit.
+     */
+    void Print(std::ostream& os) const;
+
+    /**
+     * ToJson - Get the complete report as JSON
+     */
+    JsonValue ToJson() const;
+
+private:
+    std::string filename_;                              // The file being compiled
+    std::vector<TimeRecord> records_;                   // Records in first-added order
+    std::unordered_map<std::string, size_t> index_;     // Records by group and name
+};
+
+/**
+ * ScopedTimer - Measures its own lifetime into a report
+ *
+ * Timers nest: a timer's heap peak includes the peaks of timers inside it.
+ * While -ftime-trace is recording, phase timers also add a span to the
+ * timeline. A null report makes the timer a no-op.
+ */
+class ScopedTimer {
+public:
+    ScopedTimer(TimeReport* report, std::string name, const char* group = "phase");
+    ~ScopedTimer();
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    TimeReport* report_;                                    // Report to add to, or null
+    std::string name_;                                      // Record name
+    const char* group_;                                     // Record group
+    std::chrono::steady_clock::time_point wall_start_;      // Wall clock at start
+    double cpu_start_ = 0;                                  // Thread CPU time at start
+    int64_t live_start_ = 0;                                // Live heap bytes at start
+    int64_t outer_peak_ = 0;                                // Enclosing peak, restored at end
+    bool tracing_ = false;                                  // Whether a trace span is open
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_TIMING_H
@@ -112,4 +112,62 @@ std::string Token::GetTokenName() const {
     }
 }
 
+/**
+ * DecodeEscape - Decode the character following a backslash
+ * 
+ * @param c The escaped character
+ * @param out Receives the decoded character
+ * @return True if the escape sequence is valid, false otherwise
+ */
+static bool DecodeEscape(char c, char& out) {
+    switch (c) {
+        case 'n': out = '\n'; return true;
+        case 'r': out = '\r'; return true;
+        case 't': out = '\t'; return true;
+        case '\\': out = '\\'; return true;
+        case '"': out = '"'; return true;
+        case '\'': out = '\''; return true;
+        default: return false;
+    }
+}
+
+/**
+ * GetValue - Get the token value
+ */
+std::string Token::GetValue() const {
+    if (kind_ != TokenKind::STRING_LITERAL && kind_ != TokenKind::CHAR_LITERAL) {
+        return std::string(lexeme_);
+    }
+    
+    // Strip the opening quote and, if present, the closing one
+    char quote = kind_ == TokenKind::STRING_LITERAL ? '"' : '\'';
+    size_t begin = 1;
+    size_t end = lexeme_.size();
+    if (end >= 2 && lexeme_[end - 1] == quote) {
+        end--;
+    }
+    
+    std::string value;
+    value.reserve(end > begin ? end - begin : 0);
+    
+    for (size_t i = begin; i < end; i++) {
+        char c = lexeme_[i];
+        
+        if (c == '\\' && i + 1 < end) {
+            char decoded;
+            i++;
+            if (DecodeEscape(lexeme_[i], decoded)) {
+                value += decoded;
+            } else if (kind_ == TokenKind::CHAR_LITERAL) {
+                // The lexer has already reported the bad escape; keep the character
+                value += lexeme_[i];
+            }
+        } else {
+            value += c;
+        }
+    }
+    
+    return value;
+}
+
 } // namespace dsLang
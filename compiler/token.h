@@ -7,7 +7,9 @@
 #ifndef DSLANG_TOKEN_H
 #define DSLANG_TOKEN_H
 
+#include "symbol.h"
 #include <string>
+#include <string_view>
 
 namespace dsLang {
 
@@ -107,6 +109,11 @@ enum class TokenKind {
 
 /**
  * Token - Represents a token in the source code
+ * 
+ * Tokens do not own their text. The lexeme is a slice of the source buffer
+ * the token was scanned from, so a token must not outlive that buffer.
+ * Interpreted values (e.g. escape-decoded string literals) are computed on
+ * demand by GetValue(). Identifier tokens also carry their interned Symbol.
  */
 class Token {
 public:
@@ -115,18 +122,34 @@ public:
      * 
      * @param kind The token kind
      * @param lexeme The lexeme (exact text in source)
-     * @param value The token value (interpreted text)
      * @param line The line number
      * @param column The column number
      */
     Token(TokenKind kind,
-          const std::string& lexeme,
-          const std::string& value,
+          std::string_view lexeme,
           unsigned line,
           unsigned column)
         : kind_(kind),
           lexeme_(lexeme),
-          value_(value),
+          line_(line),
+          column_(column) {
+    }
+    
+    /**
+     * Constructor - Create an identifier token
+     * 
+     * @param symbol The interned identifier
+     * @param lexeme The lexeme (exact text in source)
+     * @param line The line number
+     * @param column The column number
+     */
+    Token(Symbol symbol,
+          std::string_view lexeme,
+          unsigned line,
+          unsigned column)
+        : kind_(TokenKind::IDENTIFIER),
+          symbol_(symbol),
+          lexeme_(lexeme),
           line_(line),
           column_(column) {
     }
@@ -136,8 +159,6 @@ public:
      */
     Token()
         : kind_(TokenKind::UNKNOWN),
-          lexeme_(""),
-          value_(""),
           line_(0),
           column_(0) {
     }
@@ -150,12 +171,21 @@ public:
     /**
      * GetLexeme - Get the token lexeme
      */
-    const std::string& GetLexeme() const { return lexeme_; }
+    std::string_view GetLexeme() const { return lexeme_; }
+    
+    /**
+     * GetSymbol - Get the interned identifier (empty for non-identifiers)
+     */
+    Symbol GetSymbol() const { return symbol_; }
     
     /**
      * GetValue - Get the token value
+     * 
+     * For string and character literals this is the text with the quotes
+     * removed and escape sequences decoded. For all other tokens it is the
+     * lexeme itself.
      */
-    const std::string& GetValue() const { return value_; }
+    std::string GetValue() const;
     
     /**
      * GetLine - Get the token line number
@@ -173,11 +203,11 @@ public:
     std::string GetTokenName() const;
     
 private:
-    TokenKind kind_;        // The token kind
-    std::string lexeme_;    // The exact text from source
-    std::string value_;     // The interpreted value
-    unsigned line_;         // The line number
-    unsigned column_;       // The column number
+    TokenKind kind_;            // The token kind
+    Symbol symbol_;             // The interned identifier, if any
+    std::string_view lexeme_;   // The exact text from source
+    unsigned line_;             // The line number
+    unsigned column_;           // The column number
 };
 
 } // namespace dsLang
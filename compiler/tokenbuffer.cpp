@@ -0,0 +1,69 @@
+/**
+ * tokenbuffer.cpp - Pre-Lexed Token Storage Implementation for dsLang
+ *
+ * This file implements lexing a whole source file into a TokenBuffer.
+ */
+
+#include "tokenbuffer.h"
+
+namespace dsLang {
+
+static_assert(static_cast<int>(TokenKind::UNKNOWN) < 256,
+              "TokenBuffer stores token kinds in one byte");
+
+/**
+ * Constructor - Create an empty buffer over a source
+ */
+TokenBuffer::TokenBuffer(std::shared_ptr<const SourceBuffer> buffer)
+    : buffer_(std::move(buffer)), source_(buffer_->GetText()) {
+}
+
+/**
+ * Tokenize - Lex an entire input
+ */
+std::unique_ptr<TokenBuffer> TokenBuffer::Tokenize(Lexer& lexer) {
+    std::unique_ptr<TokenBuffer> tokens(new TokenBuffer(lexer.GetSourceBuffer()));
+
+    // Typical source averages a token every four to five bytes
+    size_t estimate = tokens->source_.size() / 4 + 1;
+    tokens->kinds_.reserve(estimate);
+    tokens->offsets_.reserve(estimate);
+    tokens->lengths_.reserve(estimate);
+    tokens->lines_.reserve(estimate);
+    tokens->columns_.reserve(estimate);
+    tokens->symbols_.reserve(estimate);
+
+    const char* base = tokens->source_.data();
+    while (true) {
+        Token token = lexer.GetNextToken();
+        std::string_view lexeme = token.GetLexeme();
+
+        tokens->kinds_.push_back(static_cast<uint8_t>(token.GetKind()));
+        tokens->offsets_.push_back(static_cast<uint32_t>(lexeme.data() - base));
+        tokens->lengths_.push_back(static_cast<uint32_t>(lexeme.size()));
+        tokens->lines_.push_back(token.GetLine());
+        tokens->columns_.push_back(token.GetColumn());
+        tokens->symbols_.push_back(token.GetSymbol());
+
+        if (token.GetKind() == TokenKind::END_OF_FILE) {
+            break;
+        }
+    }
+
+    return tokens;
+}
+
+/**
+ * GetToken - Reassemble a Token object
+ */
+Token TokenBuffer::GetToken(size_t index) const {
+    index = Clamp(index);
+    TokenKind kind = static_cast<TokenKind>(kinds_[index]);
+
+    if (kind == TokenKind::IDENTIFIER) {
+        return Token(symbols_[index], GetLexeme(index), lines_[index], columns_[index]);
+    }
+    return Token(kind, GetLexeme(index), lines_[index], columns_[index]);
+}
+
+} // namespace dsLang
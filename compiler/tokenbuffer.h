@@ -0,0 +1,111 @@
+/**
+ * tokenbuffer.h - Pre-Lexed Token Storage for dsLang
+ *
+ * This file defines the TokenBuffer class, which holds every token of a
+ * source file in structure-of-arrays form so that the parser can index
+ * tokens by position instead of pulling them from the lexer one at a time.
+ */
+
+#ifndef DSLANG_TOKENBUFFER_H
+#define DSLANG_TOKENBUFFER_H
+
+#include "lexer.h"
+#include "source.h"
+#include "symbol.h"
+#include "token.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace dsLang {
+
+/**
+ * TokenBuffer - All tokens of a source file, stored column-wise
+ *
+ * Each token attribute lives in its own contiguous array, so scanning token
+ * kinds (what the parser does most) touches only one byte per token.
+ * Lexemes are stored as offsets into the source buffer, which the token
+ * buffer keeps alive. The last token is always END_OF_FILE, and indices
+ * past the end refer to it, so any amount of lookahead is safe.
+ */
+class TokenBuffer {
+public:
+    /**
+     * Tokenize - Lex an entire input
+     *
+     * @param lexer The lexer to drain; it is left at end of file
+     * @return The buffer holding every token
+     */
+    static std::unique_ptr<TokenBuffer> Tokenize(Lexer& lexer);
+
+    TokenBuffer(const TokenBuffer&) = delete;
+    TokenBuffer& operator=(const TokenBuffer&) = delete;
+
+    /**
+     * GetSize - Get the number of tokens, including END_OF_FILE
+     */
+    size_t GetSize() const { return kinds_.size(); }
+
+    /**
+     * GetKind - Get the kind of a token
+     */
+    TokenKind GetKind(size_t index) const { return static_cast<TokenKind>(kinds_[Clamp(index)]); }
+
+    /**
+     * GetLexeme - Get the source text of a token
+     */
+    std::string_view GetLexeme(size_t index) const {
+        index = Clamp(index);
+        return source_.substr(offsets_[index], lengths_[index]);
+    }
+
+    /**
+     * GetSymbol - Get the interned identifier of a token (empty if none)
+     */
+    Symbol GetSymbol(size_t index) const { return symbols_[Clamp(index)]; }
+
+    /**
+     * GetLine - Get the line number of a token
+     */
+    unsigned GetLine(size_t index) const { return lines_[Clamp(index)]; }
+
+    /**
+     * GetColumn - Get the column number of a token
+     */
+    unsigned GetColumn(size_t index) const { return columns_[Clamp(index)]; }
+
+    /**
+     * GetToken - Reassemble a Token object
+     */
+    Token GetToken(size_t index) const;
+
+    /**
+     * GetFilename - Get the name of the source file
+     */
+    const std::string& GetFilename() const { return buffer_->GetName(); }
+
+    /**
+     * GetSourceBuffer - Get the buffer that lexemes point into
+     */
+    const std::shared_ptr<const SourceBuffer>& GetSourceBuffer() const { return buffer_; }
+
+private:
+    explicit TokenBuffer(std::shared_ptr<const SourceBuffer> buffer);
+
+    size_t Clamp(size_t index) const { return index < kinds_.size() ? index : kinds_.size() - 1; }
+
+    std::shared_ptr<const SourceBuffer> buffer_;    // Owner of the source text
+    std::string_view source_;                       // The source text
+    std::vector<uint8_t> kinds_;                    // TokenKind of each token
+    std::vector<uint32_t> offsets_;                 // Start of each lexeme in source_
+    std::vector<uint32_t> lengths_;                 // Length of each lexeme
+    std::vector<uint32_t> lines_;                   // Line of each token
+    std::vector<uint32_t> columns_;                 // Column of each token
+    std::vector<Symbol> symbols_;                   // Interned name of identifiers
+};
+
+} // namespace dsLang
+
+#endif // DSLANG_TOKENBUFFER_H
@@ -2,7 +2,8 @@
  * type.cpp - Type System Implementation for dsLang
  * 
  * This file implements the Type class hierarchy used to represent the types
- * of expressions and declarations in dsLang.
+ * of expressions and declarations in dsLang, and the TypeContext that owns
+ * and uniques them.
  */
 
 #include "type.h"
@@ -11,13 +12,6 @@
 
 namespace dsLang {
 
-/**
- * IsEqual - Check if this type is equal to another type
- */
-bool Type::IsEqual(const Type* other) const {
-    return other && kind_ == other->kind_;
-}
-
 /**
  * IsIntegral - Check if this is an integral type (bool, char, short, int, long, enum)
  */
@@ -46,18 +40,6 @@ bool Type::IsScalar() const {
     return IsArithmetic() || IsPointer() || IsEnum();
 }
 
-/**
- * IsEqual - Check if this primitive type is equal to another type
- */
-bool PrimitiveType::IsEqual(const Type* other) const {
-    if (!Type::IsEqual(other)) {
-        return false;
-    }
-    
-    const PrimitiveType* other_primitive = static_cast<const PrimitiveType*>(other);
-    return sign_kind_ == other_primitive->sign_kind_;
-}
-
 /**
  * ToString - Convert the primitive type to a string representation
  */
@@ -149,60 +131,19 @@ std::string PointerType::ToString() const {
     return pointee_type_->ToString() + "*";
 }
 
-/**
- * IsEqual - Check if this pointer type is equal to another type
- */
-bool PointerType::IsEqual(const Type* other) const {
-    if (!Type::IsEqual(other)) {
-        return false;
-    }
-    
-    const PointerType* other_ptr = static_cast<const PointerType*>(other);
-    return pointee_type_->IsEqual(other_ptr->pointee_type_.get());
-}
-
 /**
  * ToString - Convert the array type to a string representation
  */
 std::string ArrayType::ToString() const {
     std::ostringstream oss;
-    if (has_constant_size_) {
-        oss << element_type_->ToString() << "[" << size_ << "]";
-    } else {
-        oss << element_type_->ToString() << "[]"; // Size is not known yet
-    }
+    oss << element_type_->ToString() << "[" << size_ << "]";
     return oss.str();
 }
 
-/**
- * IsEqual - Check if this array type is equal to another type
- */
-bool ArrayType::IsEqual(const Type* other) const {
-    if (!Type::IsEqual(other)) {
-        return false;
-    }
-    
-    const ArrayType* other_array = static_cast<const ArrayType*>(other);
-    
-    // If both arrays have constant size, compare the sizes
-    if (has_constant_size_ && other_array->has_constant_size_) {
-        return size_ == other_array->size_ && 
-               element_type_->IsEqual(other_array->element_type_.get());
-    }
-    
-    // If one has constant size and the other doesn't, they're not equal
-    if (has_constant_size_ != other_array->has_constant_size_) {
-        return false;
-    }
-    
-    // Both don't have constant size, just compare element types
-    return element_type_->IsEqual(other_array->element_type_.get());
-}
-
 /**
  * AddField - Add a field to the struct
  */
-void StructType::AddField(const std::string& name, std::shared_ptr<Type> type) {
+void StructType::AddField(const std::string& name, Type* type) {
     // Cannot add fields to a completed struct
     if (complete_) {
         return;
@@ -232,7 +173,7 @@ size_t StructType::GetFieldOffset(const std::string& name) const {
 /**
  * GetFieldType - Get the type of a field by name
  */
-std::shared_ptr<Type> StructType::GetFieldType(const std::string& name) const {
+Type* StructType::GetFieldType(const std::string& name) const {
     for (const auto& field : fields_) {
         if (field.first == name) {
             return field.second;
@@ -274,11 +215,13 @@ void StructType::SetComplete() {
     
     complete_ = true;
     
-    // Calculate field offsets and struct size
+    // Calculate field offsets and struct size; an empty struct is byte-aligned
     size_t current_offset = 0;
+    alignment_ = 1;
     
     for (const auto& field : fields_) {
-        size_t field_align = field.second->GetAlignment();
+        // Fields of incomplete or function type have been reported already
+        size_t field_align = std::max<size_t>(field.second->GetAlignment(), 1);
         
         // Adjust the current offset to meet the field's alignment requirement
         current_offset = (current_offset + field_align - 1) / field_align * field_align;
@@ -297,45 +240,21 @@ void StructType::SetComplete() {
 }
 
 /**
- * ToString - Convert the struct type to a string representation
+ * ClearFields - Drop the fields and layout, making the struct incomplete
  */
-std::string StructType::ToString() const {
-    return "struct " + name_;
+void StructType::ClearFields() {
+    fields_.clear();
+    field_offsets_.clear();
+    size_ = 0;
+    alignment_ = 0;
+    complete_ = false;
 }
 
 /**
- * IsEqual - Check if this struct type is equal to another type
+ * ToString - Convert the struct type to a string representation
  */
-bool StructType::IsEqual(const Type* other) const {
-    if (!Type::IsEqual(other)) {
-        return false;
-    }
-    
-    const StructType* other_struct = static_cast<const StructType*>(other);
-    
-    // If both are incomplete, compare names
-    if (!complete_ && !other_struct->complete_) {
-        return name_ == other_struct->name_;
-    }
-    
-    // If one is complete and the other is incomplete, they're not equal
-    if (complete_ != other_struct->complete_) {
-        return false;
-    }
-    
-    // Both are complete, compare fields
-    if (fields_.size() != other_struct->fields_.size()) {
-        return false;
-    }
-    
-    for (size_t i = 0; i < fields_.size(); ++i) {
-        if (fields_[i].first != other_struct->fields_[i].first ||
-            !fields_[i].second->IsEqual(other_struct->fields_[i].second.get())) {
-            return false;
-        }
-    }
-    
-    return true;
+std::string StructType::ToString() const {
+    return "struct " + name_;
 }
 
 /**
@@ -345,41 +264,6 @@ std::string EnumType::ToString() const {
     return "enum " + name_;
 }
 
-/**
- * IsEqual - Check if this enum type is equal to another type
- */
-bool EnumType::IsEqual(const Type* other) const {
-    if (!Type::IsEqual(other)) {
-        return false;
-    }
-    
-    const EnumType* other_enum = static_cast<const EnumType*>(other);
-    
-    // Compare names
-    if (name_ != other_enum->name_) {
-        return false;
-    }
-    
-    // Compare base types
-    if (!base_type_->IsEqual(other_enum->base_type_.get())) {
-        return false;
-    }
-    
-    // Compare values
-    if (values_.size() != other_enum->values_.size()) {
-        return false;
-    }
-    
-    for (size_t i = 0; i < values_.size(); ++i) {
-        if (values_[i].first != other_enum->values_[i].first ||
-            values_[i].second != other_enum->values_[i].second) {
-            return false;
-        }
-    }
-    
-    return true;
-}
-
 /**
  * ToString - Convert the function type to a string representation
  */
@@ -406,37 +290,140 @@ std::string FunctionType::ToString() const {
 }
 
 /**
- * IsEqual - Check if this function type is equal to another type
+ * TypeContext constructor - Set up the primitive types
  */
-bool FunctionType::IsEqual(const Type* other) const {
-    if (!Type::IsEqual(other)) {
-        return false;
+TypeContext::TypeContext()
+    : uchar_type_(PrimitiveType::SignKind::UNSIGNED),
+      ushort_type_(PrimitiveType::SignKind::UNSIGNED),
+      uint_type_(PrimitiveType::SignKind::UNSIGNED),
+      ulong_type_(PrimitiveType::SignKind::UNSIGNED) {
+}
+
+/**
+ * GetPointerType - Get the unique pointer type to a pointee
+ */
+PointerType* TypeContext::GetPointerType(Type* pointee_type) {
+    auto it = pointer_types_.find(pointee_type);
+    if (it != pointer_types_.end()) {
+        return it->second;
     }
     
-    const FunctionType* other_func = static_cast<const FunctionType*>(other);
+    PointerType* type = Own(new PointerType(pointee_type));
+    pointer_types_.emplace(pointee_type, type);
+    return type;
+}
+
+/**
+ * GetArrayType - Get the unique array type with a constant size
+ */
+ArrayType* TypeContext::GetArrayType(Type* element_type, size_t size) {
+    auto key = std::make_pair(static_cast<const Type*>(element_type), size);
+    auto it = array_types_.find(key);
+    if (it != array_types_.end()) {
+        return it->second;
+    }
     
-    // Compare return types
-    if (!return_type_->IsEqual(other_func->return_type_.get())) {
-        return false;
+    ArrayType* type = Own(new ArrayType(element_type, size));
+    array_types_.emplace(key, type);
+    return type;
+}
+
+/**
+ * GetFunctionType - Get the unique function type with a signature
+ */
+FunctionType* TypeContext::GetFunctionType(Type* return_type,
+                                           const std::vector<Type*>& param_types,
+                                           bool is_variadic) {
+    FunctionKey key(return_type, param_types, is_variadic);
+    auto it = function_types_.find(key);
+    if (it != function_types_.end()) {
+        return it->second;
+    }
+    
+    FunctionType* type = Own(new FunctionType(return_type, param_types, is_variadic));
+    function_types_.emplace(std::move(key), type);
+    return type;
+}
+
+/**
+ * GetStructType - Get the struct type with a name, creating it if needed
+ */
+StructType* TypeContext::GetStructType(const std::string& name) {
+    auto it = struct_types_.find(name);
+    if (it != struct_types_.end()) {
+        return it->second;
     }
     
-    // Compare variadic flag
-    if (is_variadic_ != other_func->is_variadic_) {
-        return false;
+    StructType* type = Own(new StructType(name));
+    struct_types_.emplace(name, type);
+    return type;
+}
+
+/**
+ * GetEnumType - Get the enum type with a name, creating it if needed
+ */
+EnumType* TypeContext::GetEnumType(const std::string& name) {
+    auto it = enum_types_.find(name);
+    if (it != enum_types_.end()) {
+        return it->second;
     }
     
-    // Compare parameter types
-    if (param_types_.size() != other_func->param_types_.size()) {
+    // Enums are always int-based
+    EnumType* type = Own(new EnumType(name, &int_type_));
+    enum_types_.emplace(name, type);
+    return type;
+}
+
+/**
+ * LookupStructType - Find an existing struct type by name
+ */
+StructType* TypeContext::LookupStructType(const std::string& name) const {
+    auto it = struct_types_.find(name);
+    return it != struct_types_.end() ? it->second : nullptr;
+}
+
+/**
+ * LookupEnumType - Find an existing enum type by name
+ */
+EnumType* TypeContext::LookupEnumType(const std::string& name) const {
+    auto it = enum_types_.find(name);
+    return it != enum_types_.end() ? it->second : nullptr;
+}
+
+/**
+ * AddEnumerator - Add a value to an enum and make its name a constant
+ */
+bool TypeContext::AddEnumerator(EnumType* type, const std::string& name, int64_t value) {
+    if (!enumerators_.emplace(name, std::make_pair(type, value)).second) {
         return false;
     }
-    
-    for (size_t i = 0; i < param_types_.size(); ++i) {
-        if (!param_types_[i]->IsEqual(other_func->param_types_[i].get())) {
-            return false;
+    type->AddValue(name, value);
+    return true;
+}
+
+/**
+ * LookupEnumerator - Find the enum and value an enumerator names
+ */
+EnumType* TypeContext::LookupEnumerator(const std::string& name, int64_t* value) const {
+    auto it = enumerators_.find(name);
+    if (it == enumerators_.end()) {
+        return nullptr;
+    }
+    *value = it->second.second;
+    return it->second.first;
+}
+
+/**
+ * ClearEnumerators - Remove an enum's values and forget their names
+ */
+void TypeContext::ClearEnumerators(EnumType* type) {
+    for (const auto& value : type->GetValues()) {
+        auto it = enumerators_.find(value.first);
+        if (it != enumerators_.end() && it->second.first == type) {
+            enumerators_.erase(it);
         }
     }
-    
-    return true;
+    type->ClearValues();
 }
 
 } // namespace dsLang
@@ -2,20 +2,28 @@
  * type.h - Type System for dsLang
  * 
  * This file defines the Type class hierarchy used to represent the types
- * of expressions and declarations in dsLang.
+ * of expressions and declarations in dsLang, and the TypeContext that owns
+ * and uniques them.
  */
 
 #ifndef DSLANG_TYPE_H
 #define DSLANG_TYPE_H
 
+#include <map>
 #include <memory>
 #include <string>
+#include <tuple>
+#include <unordered_map>
 #include <vector>
 
 namespace dsLang {
 
 /**
  * Type - Base class for all types
+ *
+ * Types are created and owned by a TypeContext, which hands out exactly one
+ * object per distinct type. Types are therefore passed around as plain
+ * pointers and compared by identity.
  */
 class Type {
 public:
@@ -67,8 +75,10 @@ public:
     
     /**
      * IsEqual - Check if this type is equal to another type
+     *
+     * Types are uniqued by their TypeContext, so this is an identity check.
      */
-    virtual bool IsEqual(const Type* other) const;
+    bool IsEqual(const Type* other) const { return this == other; }
     
     /**
      * IsVoid - Check if this is a void type
@@ -216,11 +226,6 @@ public:
      */
     bool IsUnsigned() const { return sign_kind_ == SignKind::UNSIGNED; }
     
-    /**
-     * IsEqual - Check if this type is equal to another type
-     */
-    bool IsEqual(const Type* other) const override;
-    
     /**
      * ToString - Convert the type to a string representation
      */
@@ -424,13 +429,13 @@ public:
     /**
      * Constructor
      */
-    PointerType(std::shared_ptr<Type> pointee_type)
+    PointerType(Type* pointee_type)
         : Type(Kind::POINTER), pointee_type_(pointee_type) {}
     
     /**
      * GetPointeeType - Get the pointee type
      */
-    std::shared_ptr<Type> GetPointeeType() const { return pointee_type_; }
+    Type* GetPointeeType() const { return pointee_type_; }
     
     /**
      * GetSize - Get the size of the type in bytes
@@ -447,72 +452,39 @@ public:
      */
     std::string ToString() const override;
     
-    /**
-     * IsEqual - Check if this type is equal to another type
-     */
-    bool IsEqual(const Type* other) const override;
-    
 private:
-    std::shared_ptr<Type> pointee_type_;
+    Type* pointee_type_;
 };
 
-// Forward declaration to avoid circular dependency
-class Expr;
-
 /**
  * ArrayType - Represents an array type
+ *
+ * Sizes are folded to constants when the type is parsed, so array types
+ * never refer to AST nodes and can be uniqued and outlive any parse.
  */
 class ArrayType : public Type {
 public:
     /**
-     * Constructor with concrete size
-     */
-    ArrayType(std::shared_ptr<Type> element_type, size_t size)
-        : Type(Kind::ARRAY), element_type_(element_type), size_(size), size_expr_(nullptr), has_constant_size_(true) {}
-    
-    /**
-     * Constructor with expression for size (for parsing)
+     * Constructor
      */
-    ArrayType(std::shared_ptr<Type> element_type, std::shared_ptr<Expr> size_expr)
-        : Type(Kind::ARRAY), element_type_(element_type), size_(0), size_expr_(size_expr), has_constant_size_(false) {}
+    ArrayType(Type* element_type, size_t size)
+        : Type(Kind::ARRAY), element_type_(element_type), size_(size) {}
     
     /**
      * GetElementType - Get the element type
      */
-    std::shared_ptr<Type> GetElementType() const { return element_type_; }
+    Type* GetElementType() const { return element_type_; }
     
     /**
      * GetSize - Get the size of the type in bytes
      */
-    size_t GetSize() const override { 
-        if (has_constant_size_)
-            return element_type_->GetSize() * size_; 
-        return 0; // Size not known until size_expr_ is evaluated
-    }
+    size_t GetSize() const override { return element_type_->GetSize() * size_; }
     
     /**
      * GetNumElements - Get the number of elements in the array
      */
     size_t GetNumElements() const { return size_; }
     
-    /**
-     * GetSizeExpr - Get the size expression
-     */
-    std::shared_ptr<Expr> GetSizeExpr() const { return size_expr_; }
-    
-    /**
-     * HasConstantSize - Check if the array has a constant size
-     */
-    bool HasConstantSize() const { return has_constant_size_; }
-    
-    /**
-     * SetSize - Set the size after evaluating the expression
-     */
-    void SetSize(size_t size) {
-        size_ = size;
-        has_constant_size_ = true;
-    }
-    
     /**
      * GetAlignment - Get the alignment of the type in bytes
      */
@@ -523,20 +495,16 @@ public:
      */
     std::string ToString() const override;
     
-    /**
-     * IsEqual - Check if this type is equal to another type
-     */
-    bool IsEqual(const Type* other) const override;
-    
 private:
-    std::shared_ptr<Type> element_type_;
+    Type* element_type_;
     size_t size_;
-    std::shared_ptr<Expr> size_expr_;
-    bool has_constant_size_;
 };
 
 /**
  * StructType - Represents a struct type
+ *
+ * Struct types are nominal: there is one StructType per name in a
+ * TypeContext, and its fields are filled in when the definition is seen.
  */
 class StructType : public Type {
 public:
@@ -554,12 +522,12 @@ public:
     /**
      * AddField - Add a field to the struct
      */
-    void AddField(const std::string& name, std::shared_ptr<Type> type);
+    void AddField(const std::string& name, Type* type);
     
     /**
      * GetFields - Get the fields of the struct
      */
-    const std::vector<std::pair<std::string, std::shared_ptr<Type>>>& GetFields() const { return fields_; }
+    const std::vector<std::pair<std::string, Type*>>& GetFields() const { return fields_; }
     
     /**
      * GetFieldOffsets - Get the field offsets
@@ -574,7 +542,7 @@ public:
     /**
      * GetFieldType - Get the type of a field by name
      */
-    std::shared_ptr<Type> GetFieldType(const std::string& name) const;
+    Type* GetFieldType(const std::string& name) const;
     
     /**
      * GetSize - Get the size of the type in bytes
@@ -597,18 +565,20 @@ public:
     void SetComplete();
     
     /**
-     * ToString - Convert the type to a string representation
+     * ClearFields - Drop the fields and layout, making the struct incomplete
+     *
+     * Used when a declaration of the struct is parsed again after an edit.
      */
-    std::string ToString() const override;
+    void ClearFields();
     
     /**
-     * IsEqual - Check if this type is equal to another type
+     * ToString - Convert the type to a string representation
      */
-    bool IsEqual(const Type* other) const override;
+    std::string ToString() const override;
     
 private:
     std::string name_;
-    std::vector<std::pair<std::string, std::shared_ptr<Type>>> fields_;
+    std::vector<std::pair<std::string, Type*>> fields_;
     std::vector<size_t> field_offsets_;
     mutable size_t size_;
     mutable size_t alignment_;
@@ -617,13 +587,15 @@ private:
 
 /**
  * EnumType - Represents an enum type
+ *
+ * Like structs, enum types are nominal and unique per name.
  */
 class EnumType : public Type {
 public:
     /**
      * Constructor
      */
-    EnumType(const std::string& name, std::shared_ptr<Type> base_type)
+    EnumType(const std::string& name, Type* base_type)
         : Type(Kind::ENUM), name_(name), base_type_(base_type) {}
     
     /**
@@ -634,7 +606,7 @@ public:
     /**
      * GetBaseType - Get the base type of the enum
      */
-    std::shared_ptr<Type> GetBaseType() const { return base_type_; }
+    Type* GetBaseType() const { return base_type_; }
     
     /**
      * AddValue - Add a value to the enum
@@ -648,6 +620,11 @@ public:
      */
     const std::vector<std::pair<std::string, int64_t>>& GetValues() const { return values_; }
     
+    /**
+     * ClearValues - Remove every value from the enum
+     */
+    void ClearValues() { values_.clear(); }
+    
     /**
      * GetSize - Get the size of the type in bytes
      */
@@ -663,14 +640,9 @@ public:
      */
     std::string ToString() const override;
     
-    /**
-     * IsEqual - Check if this type is equal to another type
-     */
-    bool IsEqual(const Type* other) const override;
-    
 private:
     std::string name_;
-    std::shared_ptr<Type> base_type_;
+    Type* base_type_;
     std::vector<std::pair<std::string, int64_t>> values_;
 };
 
@@ -682,8 +654,8 @@ public:
     /**
      * Constructor
      */
-    FunctionType(std::shared_ptr<Type> return_type,
-                 std::vector<std::shared_ptr<Type>> param_types,
+    FunctionType(Type* return_type,
+                 std::vector<Type*> param_types,
                  bool is_variadic = false)
         : Type(Kind::FUNCTION),
           return_type_(return_type),
@@ -693,12 +665,12 @@ public:
     /**
      * GetReturnType - Get the return type
      */
-    std::shared_ptr<Type> GetReturnType() const { return return_type_; }
+    Type* GetReturnType() const { return return_type_; }
     
     /**
      * GetParamTypes - Get the parameter types
      */
-    const std::vector<std::shared_ptr<Type>>& GetParamTypes() const { return param_types_; }
+    const std::vector<Type*>& GetParamTypes() const { return param_types_; }
     
     /**
      * IsVariadic - Check if this is a variadic function
@@ -720,15 +692,177 @@ public:
      */
     std::string ToString() const override;
     
+private:
+    Type* return_type_;
+    std::vector<Type*> param_types_;
+    bool is_variadic_;
+};
+
+/**
+ * TypeContext - Owner and uniquer of all types
+ *
+ * Every type is created through a TypeContext, which hash-conses structural
+ * types (pointers, sized arrays, functions) so that each distinct type exists
+ * exactly once. Two types are equal if and only if they are the same object,
+ * which makes type comparisons and type-keyed lookups a pointer compare
+ * instead of a walk over the type tree.
+ *
+ * The context must outlive every AST and code generator that refers to its
+ * types.
+ */
+class TypeContext {
+public:
+    /**
+     * Constructor
+     */
+    TypeContext();
+    
+    TypeContext(const TypeContext&) = delete;
+    TypeContext& operator=(const TypeContext&) = delete;
+    
     /**
-     * IsEqual - Check if this type is equal to another type
+     * GetVoidType - Get the void type
+     */
+    VoidType* GetVoidType() { return &void_type_; }
+    
+    /**
+     * GetBoolType - Get the bool type
+     */
+    BoolType* GetBoolType() { return &bool_type_; }
+    
+    /**
+     * GetCharType - Get the signed or unsigned char type
+     */
+    CharType* GetCharType(PrimitiveType::SignKind sign_kind = PrimitiveType::SignKind::SIGNED) {
+        return sign_kind == PrimitiveType::SignKind::SIGNED ? &char_type_ : &uchar_type_;
+    }
+    
+    /**
+     * GetShortType - Get the signed or unsigned short type
      */
-    bool IsEqual(const Type* other) const override;
+    ShortType* GetShortType(PrimitiveType::SignKind sign_kind = PrimitiveType::SignKind::SIGNED) {
+        return sign_kind == PrimitiveType::SignKind::SIGNED ? &short_type_ : &ushort_type_;
+    }
+    
+    /**
+     * GetIntType - Get the signed or unsigned int type
+     */
+    IntType* GetIntType(PrimitiveType::SignKind sign_kind = PrimitiveType::SignKind::SIGNED) {
+        return sign_kind == PrimitiveType::SignKind::SIGNED ? &int_type_ : &uint_type_;
+    }
+    
+    /**
+     * GetLongType - Get the signed or unsigned long type
+     */
+    LongType* GetLongType(PrimitiveType::SignKind sign_kind = PrimitiveType::SignKind::SIGNED) {
+        return sign_kind == PrimitiveType::SignKind::SIGNED ? &long_type_ : &ulong_type_;
+    }
+    
+    /**
+     * GetFloatType - Get the float type
+     */
+    FloatType* GetFloatType() { return &float_type_; }
+    
+    /**
+     * GetDoubleType - Get the double type
+     */
+    DoubleType* GetDoubleType() { return &double_type_; }
+    
+    /**
+     * GetPointerType - Get the unique pointer type to a pointee
+     */
+    PointerType* GetPointerType(Type* pointee_type);
+    
+    /**
+     * GetArrayType - Get the unique array type with a constant size
+     */
+    ArrayType* GetArrayType(Type* element_type, size_t size);
+    
+    /**
+     * GetFunctionType - Get the unique function type with a signature
+     */
+    FunctionType* GetFunctionType(Type* return_type,
+                                  const std::vector<Type*>& param_types,
+                                  bool is_variadic = false);
+    
+    /**
+     * GetStructType - Get the struct type with a name, creating it if needed
+     */
+    StructType* GetStructType(const std::string& name);
+    
+    /**
+     * GetEnumType - Get the enum type with a name, creating it if needed
+     */
+    EnumType* GetEnumType(const std::string& name);
+    
+    /**
+     * LookupStructType - Find an existing struct type by name
+     *
+     * @return The struct type, or nullptr if none has been declared
+     */
+    StructType* LookupStructType(const std::string& name) const;
+    
+    /**
+     * LookupEnumType - Find an existing enum type by name
+     *
+     * @return The enum type, or nullptr if none has been declared
+     */
+    EnumType* LookupEnumType(const std::string& name) const;
+    
+    /**
+     * AddEnumerator - Add a value to an enum and make its name a constant
+     *
+     * @return False if the name already is an enumerator
+     */
+    bool AddEnumerator(EnumType* type, const std::string& name, int64_t value);
+    
+    /**
+     * LookupEnumerator - Find the enum and value an enumerator names
+     *
+     * @param value Receives the value of the enumerator
+     * @return The enum type, or nullptr if no enumerator has the name
+     */
+    EnumType* LookupEnumerator(const std::string& name, int64_t* value) const;
+    
+    /**
+     * ClearEnumerators - Remove an enum's values and forget their names
+     *
+     * Used when a declaration of the enum is parsed again after an edit.
+     */
+    void ClearEnumerators(EnumType* type);
     
 private:
-    std::shared_ptr<Type> return_type_;
-    std::vector<std::shared_ptr<Type>> param_types_;
-    bool is_variadic_;
+    using FunctionKey = std::tuple<Type*, std::vector<Type*>, bool>;
+    
+    /**
+     * Own - Take ownership of a newly created type
+     */
+    template <typename T>
+    T* Own(T* type) {
+        types_.emplace_back(type);
+        return type;
+    }
+    
+    VoidType void_type_;      // void
+    BoolType bool_type_;      // bool
+    CharType char_type_;      // char
+    CharType uchar_type_;     // unsigned char
+    ShortType short_type_;    // short
+    ShortType ushort_type_;   // unsigned short
+    IntType int_type_;        // int
+    IntType uint_type_;       // unsigned int
+    LongType long_type_;      // long
+    LongType ulong_type_;     // unsigned long
+    FloatType float_type_;    // float
+    DoubleType double_type_;  // double
+    
+    std::vector<std::unique_ptr<Type>> types_;                          // All non-primitive types
+    std::unordered_map<const Type*, PointerType*> pointer_types_;       // Pointee -> pointer type
+    std::map<std::pair<const Type*, size_t>, ArrayType*> array_types_;  // (Element, size) -> array type
+    std::map<FunctionKey, FunctionType*> function_types_;               // Signature -> function type
+    std::unordered_map<std::string, StructType*> struct_types_;         // Name -> struct type
+    std::unordered_map<std::string, EnumType*> enum_types_;             // Name -> enum type
+    std::unordered_map<std::string, std::pair<EnumType*, int64_t>> enumerators_;    // Name -> enum and value
 };
 
 } // namespace dsLang
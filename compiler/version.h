@@ -0,0 +1,13 @@
+/**
+ * version.h - Version of the dsLang Compiler
+ *
+ * Bump DSLANG_VERSION on every release. Anything that persists compiler
+ * output across runs (such as the compile cache) keys on it.
+ */
+
+#ifndef DSLANG_VERSION_H
+#define DSLANG_VERSION_H
+
+#define DSLANG_VERSION "0.1.0"
+
+#endif // DSLANG_VERSION_H
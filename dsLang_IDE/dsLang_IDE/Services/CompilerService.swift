@@ -43,13 +43,190 @@ class CompilerService {
         return "\(basePath)/build"
     }
     
+    // MARK: - Compile Server
+    
+    /// Resident `dscc --server` process, started on first use so that
+    /// repeated compiles skip process startup and LLVM initialization
+    private var serverProcess: Process?
+    private var serverInput: FileHandle?
+    private var serverOutput: FileHandle?
+    private var serverError: FileHandle?
+    private var serverBuffer = Data()
+    private var nextRequestId = 1
+    
+    /// Serializes use of the server; edits check from here while compiles run
+    private let serverQueue = DispatchQueue(label: "dsLang.CompilerService.server")
+    
+    /// Text the server printed to stderr and nobody has shown yet, drained
+    /// continuously so that the server never blocks on a full pipe
+    private var serverErrorText = ""
+    private let serverErrorLock = NSLock()
+    
+    deinit {
+        stopServer()
+    }
+    
+    /// Sends one request to the compile server and waits for its response
+    /// - Parameter request: The request fields; an "id" is added
+    /// - Returns: The decoded response, or nil if the server is unavailable
+    private func sendServerRequest(_ request: [String: Any]) -> [String: Any]? {
+        if serverProcess?.isRunning != true && !startServer() {
+            return nil
+        }
+        
+        var message = request
+        let requestId = nextRequestId
+        nextRequestId += 1
+        message["id"] = requestId
+        
+        guard var data = try? JSONSerialization.data(withJSONObject: message),
+              let input = serverInput else {
+            return nil
+        }
+        data.append(0x0A)
+        input.write(data)
+        
+        // Responses arrive one per line, in request order
+        while let line = readServerLine() {
+            if let response = (try? JSONSerialization.jsonObject(with: line)) as? [String: Any],
+               response["id"] as? Int == requestId {
+                return response
+            }
+        }
+        
+        // The server went away; fall back to one-shot compiles
+        stopServer()
+        return nil
+    }
+    
+    /// Starts the compile server
+    /// - Returns: Whether the server was started
+    private func startServer() -> Bool {
+        stopServer()
+        
+        let process = Process()
+        let input = Pipe()
+        let output = Pipe()
+        let errors = Pipe()
+        
+        process.executableURL = URL(fileURLWithPath: compilerPath)
+        process.arguments = ["--server"]
+        process.standardInput = input
+        process.standardOutput = output
+        process.standardError = errors
+        
+        errors.fileHandleForReading.readabilityHandler = { [weak self] handle in
+            let text = String(data: handle.availableData, encoding: .utf8) ?? ""
+            guard let self = self, !text.isEmpty else {
+                return
+            }
+            self.serverErrorLock.lock()
+            self.serverErrorText += text
+            self.serverErrorLock.unlock()
+        }
+        
+        do {
+            try process.run()
+        } catch {
+            errors.fileHandleForReading.readabilityHandler = nil
+            return false
+        }
+        
+        serverProcess = process
+        serverInput = input.fileHandleForWriting
+        serverOutput = output.fileHandleForReading
+        serverError = errors.fileHandleForReading
+        serverBuffer = Data()
+        return true
+    }
+    
+    /// Takes what the server printed to stderr since the last call
+    /// - Returns: The text, possibly empty
+    private func takeServerErrors() -> String {
+        serverErrorLock.lock()
+        defer { serverErrorLock.unlock() }
+        let text = serverErrorText
+        serverErrorText = ""
+        return text
+    }
+    
+    /// Stops the compile server if it is running
+    private func stopServer() {
+        if let process = serverProcess, process.isRunning {
+            serverInput?.closeFile()
+            process.terminate()
+        }
+        serverError?.readabilityHandler = nil
+        serverProcess = nil
+        serverInput = nil
+        serverOutput = nil
+        serverError = nil
+    }
+    
+    /// Reads one line from the compile server
+    /// - Returns: The line without its newline, or nil at end of output
+    private func readServerLine() -> Data? {
+        guard let output = serverOutput else {
+            return nil
+        }
+        
+        while true {
+            if let newline = serverBuffer.firstIndex(of: 0x0A) {
+                let line = serverBuffer.subdata(in: serverBuffer.startIndex..<newline)
+                serverBuffer.removeSubrange(serverBuffer.startIndex...newline)
+                return line
+            }
+            
+            let chunk = output.availableData
+            if chunk.isEmpty {
+                return nil
+            }
+            serverBuffer.append(chunk)
+        }
+    }
+    
+    /// Formats server diagnostics the way the command-line compiler prints them
+    /// - Parameter value: The "diagnostics" array of a response
+    /// - Returns: One "file:line:column: severity: message" line per diagnostic
+    private func formatDiagnostics(_ value: Any?) -> String {
+        guard let diagnostics = value as? [[String: Any]] else {
+            return ""
+        }
+        
+        return diagnostics.map { diagnostic in
+            let file = diagnostic["file"] as? String ?? ""
+            let line = diagnostic["line"] as? Int ?? 0
+            let column = diagnostic["column"] as? Int ?? 0
+            let severity = diagnostic["severity"] as? String ?? "error"
+            let message = diagnostic["message"] as? String ?? ""
+            return "\(file):\(line):\(column): \(severity): \(message)\n"
+        }.joined()
+    }
+    
+    /// Collects everything a server response has to say besides success
+    /// - Parameter response: The decoded response
+    /// - Returns: Diagnostics, code generation messages, stderr output and
+    ///   the error, in that order
+    private func describeResponse(_ response: [String: Any]) -> String {
+        var message = formatDiagnostics(response["diagnostics"])
+        if let log = response["log"] as? String {
+            message += log
+        }
+        message += takeServerErrors()
+        if let error = response["error"] as? String {
+            message += "\(error)\n"
+        }
+        return message
+    }
+    
     // MARK: - Compilation Methods
     
     /// Compiles a dsLang file
     /// - Parameters:
     ///   - file: The URL of the file to compile
-    ///   - completion: Completion handler with result
-    func compile(file: URL, completion: @escaping (Result<String, Error>) -> Void) {
+    ///   - text: The editor's contents, if they may differ from the file
+    ///   - completion: Completion handler with result, called on a background queue
+    func compile(file: URL, text: String? = nil, completion: @escaping (Result<String, Error>) -> Void) {
         // Check if compiler exists
         let fileManager = FileManager.default
         if !fileManager.fileExists(atPath: compilerPath) {
@@ -71,6 +248,65 @@ class CompilerService {
             }
         }
         
+        serverQueue.async { [weak self] in
+            guard let self = self else {
+                return
+            }
+            
+            // Prefer the resident compile server; fall back to a one-shot process
+            var request: [String: Any] = ["method": "compile", "file": file.path, "output": outputPath.path]
+            if let text = text {
+                request["text"] = text
+            }
+            if let response = self.sendServerRequest(request) {
+                let details = self.describeResponse(response)
+                
+                if response["ok"] as? Bool == true {
+                    let result = """
+                    Compilation successful.
+                    Output file: \(outputPath.path)
+                    
+                    \(details)
+                    """
+                    completion(.success(result))
+                } else {
+                    completion(.failure(CompilationError.compilationFailed(details)))
+                }
+                return
+            }
+            
+            self.compileWithProcess(file: file, outputPath: outputPath, completion: completion)
+        }
+    }
+    
+    /// Checks unsaved editor contents for errors without writing output
+    /// - Parameters:
+    ///   - file: The URL of the file being edited
+    ///   - text: The editor's contents
+    ///   - completion: Called on a background queue with the diagnostics, one
+    ///     per line, or nil if the compile server is unavailable
+    func check(file: URL, text: String, completion: @escaping (String?) -> Void) {
+        guard FileManager.default.fileExists(atPath: compilerPath) else {
+            completion(nil)
+            return
+        }
+        
+        serverQueue.async { [weak self] in
+            guard let self = self,
+                  let response = self.sendServerRequest(["method": "check", "file": file.path, "text": text]) else {
+                completion(nil)
+                return
+            }
+            completion(self.describeResponse(response))
+        }
+    }
+    
+    /// Compiles a dsLang file by launching a separate compiler process
+    /// - Parameters:
+    ///   - file: The URL of the file to compile
+    ///   - outputPath: The object file to write
+    ///   - completion: Completion handler with result
+    private func compileWithProcess(file: URL, outputPath: URL, completion: @escaping (Result<String, Error>) -> Void) {
         // Create the compilation process
         let process = Process()
         let stdout = Pipe()
@@ -115,9 +351,9 @@ class CompilerService {
     /// - Parameters:
     ///   - file: The URL of the file to compile and run
     ///   - completion: Completion handler with result
-    func compileAndRun(file: URL, completion: @escaping (Result<String, Error>) -> Void) {
+    func compileAndRun(file: URL, text: String? = nil, completion: @escaping (Result<String, Error>) -> Void) {
         // First compile the file
-        compile(file: file) { [weak self] result in
+        compile(file: file, text: text) { [weak self] result in
             switch result {
             case .success:
                 // Now run the file
@@ -23,6 +23,10 @@ class ViewController: NSViewController {
     private var documentContent: String = ""
     private var documentIsModified: Bool = false
     
+    // Checking unsaved edits with the compile server
+    private var pendingCheck: DispatchWorkItem?
+    private var lastCheckDiagnostics: String?
+    
     override func viewDidLoad() {
         super.viewDidLoad()
         
@@ -75,6 +79,7 @@ class ViewController: NSViewController {
                         window.title = title + " *"
                     }
                 }
+                self?.scheduleCheck()
             }
         }
     }
@@ -221,7 +226,7 @@ class ViewController: NSViewController {
         consoleViewController?.appendText("Compiling \(url.lastPathComponent)...\n")
         
         // Compile the document
-        compilerService.compile(file: url) { [weak self] result in
+        compilerService.compile(file: url, text: documentContent) { [weak self] result in
             DispatchQueue.main.async {
                 switch result {
                 case .success(let output):
@@ -253,7 +258,7 @@ class ViewController: NSViewController {
         consoleViewController?.appendText("Running \(url.lastPathComponent)...\n")
         
         // Compile and run the document
-        compilerService.compileAndRun(file: url) { [weak self] result in
+        compilerService.compileAndRun(file: url, text: documentContent) { [weak self] result in
             DispatchQueue.main.async {
                 switch result {
                 case .success(let output):
@@ -304,6 +309,37 @@ class ViewController: NSViewController {
     
     // MARK: - Helper Methods
     
+    /// Checks the editor's contents once typing pauses and shows any
+    /// change in the diagnostics in the console
+    private func scheduleCheck() {
+        pendingCheck?.cancel()
+        guard let url = currentDocument else {
+            return
+        }
+        
+        let text = documentContent
+        let work = DispatchWorkItem { [weak self] in
+            self?.compilerService.check(file: url, text: text) { diagnostics in
+                DispatchQueue.main.async {
+                    // Ignore results for text that has since been edited
+                    guard let self = self, let diagnostics = diagnostics,
+                          self.documentContent == text, diagnostics != self.lastCheckDiagnostics else {
+                        return
+                    }
+                    self.lastCheckDiagnostics = diagnostics
+                    self.consoleViewController?.clearConsole()
+                    if diagnostics.isEmpty {
+                        self.consoleViewController?.appendText("No problems found.\n")
+                    } else {
+                        self.consoleViewController?.appendCompilerOutput(diagnostics)
+                    }
+                }
+            }
+        }
+        pendingCheck = work
+        DispatchQueue.main.asyncAfter(deadline: .now() + 0.5, execute: work)
+    }
+    
     private func saveBeforeCompileOrRun() -> Bool {
         if documentIsModified {
             let alert = NSAlert()